@@ -4,8 +4,8 @@
 #include "window.h"
 #include <iostream>
 
-Camera::Camera(glm::vec3 position, float near, float far, float movementSpeed, float mouseSensitivity)
-    : mPosition(position), mMovementSpeed(movementSpeed), mMouseSensitivity(mouseSensitivity), mNear(near), mFar(far)
+Camera::Camera(glm::vec3 position, float near, float movementSpeed, float mouseSensitivity)
+    : mPosition(position), mMovementSpeed(movementSpeed), mMouseSensitivity(mouseSensitivity), mNear(near)
 {
     UpdateCameraVectors();
 }
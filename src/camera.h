@@ -8,17 +8,29 @@ constexpr glm::vec3 UP_DIRECTION = glm::vec3(0.f, 1.f, 0.f);
 class Window;
 struct Camera
 {
+    // NOTE: There is no far plane; the projection is reverse-Z with the far plane at infinity
     Camera(
         glm::vec3 position,
         float near = 0.1f,
-        float far = 1000.f,
         float movementSpeed = 10000.f,
         float mouseSensitivity = 0.1f
     );
 
     inline glm::mat4 GetViewProjectionMatrix(float aspectRatio) const
     {
-        return glm::perspective(glm::radians(mFovY), aspectRatio, mNear, mFar) * glm::lookAt(mPosition, mPosition + mFront, mUp);
+        return GetProjectionMatrix(aspectRatio) * glm::lookAt(mPosition, mPosition + mFront, mUp);
+    }
+
+    // Maps the near plane to depth 1 and infinity to depth 0, which spreads the float precision evenly over distance
+    inline glm::mat4 GetProjectionMatrix(float aspectRatio) const
+    {
+        const float focalLength = 1.0f / glm::tan(0.5f * glm::radians(mFovY));
+        glm::mat4 projection = glm::mat4(0.0f);
+        projection[0][0] = focalLength / aspectRatio;
+        projection[1][1] = focalLength;
+        projection[2][3] = -1.0f;
+        projection[3][2] = mNear;
+        return projection;
     }
 
     inline glm::vec3 GetPosition() const { return mPosition; }
@@ -43,5 +55,5 @@ private:
     float mYaw = -90.f; // Y
     float mFovY = 60.f;
 
-    float mNear, mFar;
+    float mNear;
 };
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "cpu_profiler.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_set>
+
+#include "utils.h"
+
+struct ProfileEvent {
+    const char* name;
+    int64_t startNs;
+    int64_t endNs;
+};
+
+// Slot of a track's ring buffer. It's written by the track's owner while traces may be read from any thread,
+// so the fields are atomics and `sequence` tells readers whether they read one event as a whole.
+struct ProfileEventSlot {
+    std::atomic<uint64_t> sequence = 0u; // Index of the event in the slot plus 1, or 0 while it's written
+    std::atomic<const char*> name = nullptr;
+    std::atomic<int64_t> startNs = 0;
+    std::atomic<int64_t> endNs = 0;
+};
+
+struct CpuProfilerTrack {
+    std::string name;
+    std::unique_ptr<ProfileEventSlot[]> events = std::make_unique<ProfileEventSlot[]>(CpuProfiler::kEventCapacityPerTrack);
+    // Events ever recorded; only the last kEventCapacityPerTrack are kept
+    std::atomic<uint64_t> eventCount = 0u;
+};
+
+static std::mutex sMutex;
+static std::deque<CpuProfilerTrack> sTracks; // Tracks are never removed, and a deque doesn't move them
+static std::unordered_set<std::string> sNames;
+static thread_local CpuProfilerTrack* tThreadTrack = nullptr;
+
+static CpuProfilerTrack& CreateTrackLocked(std::string name)
+{
+    CpuProfilerTrack& track = sTracks.emplace_back();
+    track.name = std::move(name);
+    return track;
+}
+
+static CpuProfilerTrack& GetThreadTrack()
+{
+    if (tThreadTrack == nullptr) {
+        std::lock_guard lock(sMutex);
+        tThreadTrack = &CreateTrackLocked(fmt::format("thread {}", sTracks.size()));
+    }
+    return *tThreadTrack;
+}
+
+static void RecordTrackEvent(CpuProfilerTrack& track, const char* name, int64_t startNs, int64_t endNs)
+{
+    const uint64_t eventIdx = track.eventCount.load(std::memory_order_relaxed);
+    ProfileEventSlot& slot = track.events[eventIdx % CpuProfiler::kEventCapacityPerTrack];
+    // Readers that see the cleared sequence, or a changed one after reading, drop what they read
+    slot.sequence.store(0u, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.startNs.store(startNs, std::memory_order_relaxed);
+    slot.endNs.store(endNs, std::memory_order_relaxed);
+    slot.sequence.store(eventIdx + 1, std::memory_order_release);
+    track.eventCount.store(eventIdx + 1, std::memory_order_release);
+}
+
+// False if the event was overwritten, or is being overwritten, while it was read
+static bool ReadTrackEvent(const CpuProfilerTrack& track, uint64_t eventIdx, ProfileEvent& event)
+{
+    const ProfileEventSlot& slot = track.events[eventIdx % CpuProfiler::kEventCapacityPerTrack];
+    if (slot.sequence.load(std::memory_order_acquire) != eventIdx + 1) return false;
+    event = {
+        .name = slot.name.load(std::memory_order_relaxed),
+        .startNs = slot.startNs.load(std::memory_order_relaxed),
+        .endNs = slot.endNs.load(std::memory_order_relaxed),
+    };
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == eventIdx + 1;
+}
+
+void CpuProfiler::SetThreadName(std::string name)
+{
+    CpuProfilerTrack& track = GetThreadTrack();
+    std::lock_guard lock(sMutex);
+    track.name = std::move(name);
+}
+
+CpuProfilerTrack* CpuProfiler::CreateTrack(std::string name)
+{
+    std::lock_guard lock(sMutex);
+    return &CreateTrackLocked(std::move(name));
+}
+
+const char* CpuProfiler::InternName(std::string_view name)
+{
+    std::lock_guard lock(sMutex);
+    return sNames.emplace(name).first->c_str();
+}
+
+void CpuProfiler::RecordEvent(const char* name, int64_t startNs, int64_t endNs)
+{
+    RecordTrackEvent(GetThreadTrack(), name, startNs, endNs);
+}
+
+void CpuProfiler::RecordEvent(CpuProfilerTrack* track, const char* name, int64_t startNs, int64_t endNs)
+{
+    RecordTrackEvent(*track, name, startNs, endNs);
+}
+
+bool CpuProfiler::WriteChromeTrace(const std::string& path, float seconds)
+{
+    const int64_t endNs = GetProfilerTimeNs();
+    const int64_t startNs = endNs - int64_t(double(seconds) * 1e9);
+
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    uint64_t writtenEventCount = 0;
+    {
+        std::lock_guard lock(sMutex);
+        for (auto [trackIdx, track] : enumerate(sTracks)) {
+            json += fmt::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}},\n",
+                trackIdx, EscapeJson(track.name));
+            json += fmt::format("{{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"sort_index\":{}}}}},\n",
+                trackIdx, trackIdx);
+
+            const uint64_t eventCount = track.eventCount.load(std::memory_order_acquire);
+            const uint64_t firstEventIdx = eventCount > kEventCapacityPerTrack ? eventCount - kEventCapacityPerTrack : 0u;
+            for (uint64_t eventIdx = firstEventIdx; eventIdx < eventCount; ++eventIdx) {
+                ProfileEvent event;
+                if (!ReadTrackEvent(track, eventIdx, event) || event.endNs < startNs) continue;
+                json += fmt::format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}},\n",
+                    EscapeJson(event.name), trackIdx, double(event.startNs - startNs) * 1e-3, double(event.endNs - event.startNs) * 1e-3);
+                ++writtenEventCount;
+            }
+        }
+    }
+    json.resize(json.size() - 2); // Trailing comma and newline
+    json += "\n]}\n";
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write(json.data(), json.size())) {
+        LOG_ERROR("Failed to write the trace to '{}'", path);
+        return false;
+    }
+    LOG_INFO("Wrote {} events of the last {:.1f} s to '{}'", writtenEventCount, seconds, path);
+    return true;
+}
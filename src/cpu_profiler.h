@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+
+// Time of the steady clock in nanoseconds. On Linux that's CLOCK_MONOTONIC, which device timestamps can be calibrated
+// against, see GpuProfiler.
+inline int64_t GetProfilerTimeNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct CpuProfilerTrack;
+// Records the CPU time of scoped zones, so a trace of the last seconds can be written at any time.
+// Every thread records into its own fixed-size ring buffer that only it writes to, so recording takes no locks.
+// While disabled, a zone costs a relaxed atomic load.
+class CpuProfiler {
+public:
+    static constexpr uint32_t kEventCapacityPerTrack = 1u << 16;
+
+    static void SetEnabled(bool isEnabled) { sIsEnabled.store(isEnabled, std::memory_order_relaxed); }
+    static bool IsEnabled() { return sIsEnabled.load(std::memory_order_relaxed); }
+
+    // Names the track of the calling thread in traces
+    static void SetThreadName(std::string name);
+    // Track for events that don't happen on a CPU thread, e.g. GPU work. Only one thread may record into it at a time.
+    // Tracks live as long as the program, so recording into one through the returned pointer takes no locks.
+    static CpuProfilerTrack* CreateTrack(std::string name);
+    // Copies `name` into storage that lives as long as the program, for event names that aren't literals
+    static const char* InternName(std::string_view name);
+
+    // `name` must live as long as the program, e.g. a string literal
+    static void RecordEvent(const char* name, int64_t startNs, int64_t endNs);
+    static void RecordEvent(CpuProfilerTrack* track, const char* name, int64_t startNs, int64_t endNs);
+
+    // Writes the events of all tracks that ended in the last `seconds` in the Chrome trace event format,
+    // which chrome://tracing and Perfetto load. Recording can go on meanwhile; events overwritten while they're read are skipped.
+    static bool WriteChromeTrace(const std::string& path, float seconds);
+
+private:
+    static inline std::atomic<bool> sIsEnabled = false;
+};
+
+// Profiles the time between its construction and destruction, if the profiler was enabled when it was constructed
+class CpuProfileZone {
+public:
+    explicit CpuProfileZone(const char* name)
+        : mName(name), mStartNs(CpuProfiler::IsEnabled() ? GetProfilerTimeNs() : -1)
+    {
+    }
+    ~CpuProfileZone()
+    {
+        if (mStartNs >= 0) CpuProfiler::RecordEvent(mName, mStartNs, GetProfilerTimeNs());
+    }
+
+    CpuProfileZone(const CpuProfileZone&) = delete;
+    CpuProfileZone& operator=(const CpuProfileZone&) = delete;
+
+private:
+    const char* mName;
+    int64_t mStartNs;
+};
+
+#define _PROFILE_CONCAT_IMPL(a, b) a##b
+#define _PROFILE_CONCAT(a, b) _PROFILE_CONCAT_IMPL(a, b)
+// Profiles the rest of the enclosing scope; `name` must be a string literal
+#define PROFILE_ZONE(name) const CpuProfileZone _PROFILE_CONCAT(_profileZone, __LINE__)(name)
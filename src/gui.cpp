@@ -12,13 +12,13 @@
 #include "vk/pipeline.h"
 #include "vk/swapchain.h"
 #include "vk/descs.h"
+#include "vk/pipeline_registry.h"
+
+#include "shaders/shader_layouts.h"
 
 #include <imgui.h>
 
-struct PushConstantData {
-    glm::vec2 scale;
-    glm::vec2 translate;
-};
+using PushConstantData = imgui_vs::PushConstants;
 
 GUI::GUI(const Device& device, const Swapchain& swapchain, const Window& window)
     : mDevice(device), mWindow(window), mSwapchain(swapchain)
@@ -56,7 +56,7 @@ GUI::GUI(const Device& device, const Swapchain& swapchain, const Window& window)
             { .name = "COLOR0", .format = Format::RGBA8_UNORM,   .offset = offsetof(ImDrawVert, col), .stride = sizeof(ImDrawVert) },
         },
     };
-    mPipeline = CreateHandle<Pipeline>(device, pipelineDesc);
+    mPipeline = device.GetPipelineRegistry().GetOrCreatePipeline(pipelineDesc);
 }
 
 void GUI::CreateFontTexture()
@@ -67,7 +67,12 @@ void GUI::CreateFontTexture()
     io.Fonts->GetTexDataAsRGBA32(&fontData, &textureWidth, &textureHeight, &bytesPerPixel);
 
     const uint64_t uploadSizeInBytes = textureWidth * textureHeight * bytesPerPixel;
-    Buffer stagingBuffer = Buffer(mDevice, { .byteSize = uploadSizeInBytes, .access = MemoryAccess::HOST });
+    Buffer stagingBuffer = Buffer(mDevice, {
+        .byteSize = uploadSizeInBytes,
+        .access = MemoryAccess::HOST,
+        .debugName = "Font upload",
+        .category = MemoryCategory::STAGING,
+    });
     memcpy(stagingBuffer.GetMappedData(), fontData, uploadSizeInBytes);
 
     Handle<CommandList> cmdList = mDevice.CreateCommandList();
@@ -77,6 +82,8 @@ void GUI::CreateFontTexture()
         .dimensions = { textureWidth, textureHeight, 1u },
         .format = Format::RGBA8_UNORM,
         .usage = TextureUsageBits::SAMPLED,
+        .debugName = "Font",
+        .category = MemoryCategory::GUI,
     };
     mFontTexture = CreateHandle<Texture>(mDevice, texDesc);
 
@@ -90,7 +97,6 @@ void GUI::CreateFontTexture()
 
 GUI::~GUI()
 {
-    mDevice.WaitIdle();
     ImGui::DestroyContext();
 }
 
@@ -124,6 +130,7 @@ void GUI::NewFrame()
     ImGui::NewFrame();
 
     ImGui::Checkbox("Wireframe Mode", &mGuiParams.isInWireframeMode);
+    ImGui::Checkbox("Unbounded Ocean", &mGuiParams.isOceanUnbounded);
 
     ImGui::SliderFloat("Choppiness", &mGuiParams.choppiness, 0.f, 2.5f);
     ImGui::SliderInt("Sun Elevation", &mGuiParams.sunElevation, 0, 89);
@@ -135,6 +142,49 @@ void GUI::NewFrame()
     mHasWindParamsChanged |= ImGui::SliderFloat("Wind Magnitude", &mGuiParams.windMagnitude, 10.0f, 50.0f);
     mHasWindParamsChanged |= ImGui::SliderFloat("Wind Angle", &mGuiParams.windAngle, 0, 359);
 
+    ImGui::Separator();
+    ImGui::Checkbox("Dynamic Resolution", &mGuiParams.isDynamicResolutionEnabled);
+    if (mGuiParams.isDynamicResolutionEnabled) {
+        ImGui::SliderFloat("GPU Budget (ms)", &mGuiParams.gpuBudgetMs, 1.0f, 33.0f);
+    }
+    else {
+        ImGui::SliderFloat("Render Scale", &mGuiParams.renderScale, 0.5f, 1.0f);
+    }
+    ImGui::Text("Render scale: %.2f, ocean GPU time: %.2f ms", mGuiStats.renderScale, mGuiStats.oceanGpuTimeMs);
+
+    ImGui::Separator();
+    ImGui::Checkbox("Optimized Index Order", &mGuiParams.shouldUseOptimizedIndexOrder);
+    ImGui::Checkbox("Front-to-back Tile Order", &mGuiParams.shouldSortTilesFrontToBack);
+    ImGui::Text("Simulated ACMR: %.3f", mGuiStats.vertexCacheACMR);
+    ImGui::Text("VS invocations: %llu", (unsigned long long)mGuiStats.vertexShaderInvocations);
+    ImGui::Text("PS invocations: %llu", (unsigned long long)mGuiStats.fragmentShaderInvocations);
+
+    if (ImGui::CollapsingHeader("GPU Profiler")) {
+        ImGui::Text("%-16s %8s %8s %8s", "Pass (ms)", "avg", "median", "p95");
+        float totalMs = 0.0f;
+        for (const GpuScopeStats& scope : mGuiStats.gpuScopes) {
+            ImGui::Text("%-16s %8.3f %8.3f %8.3f", scope.name.c_str(), scope.averageMs, scope.medianMs, scope.p95Ms);
+            totalMs += scope.averageMs;
+        }
+        ImGui::Text("%-16s %8.3f", "total", totalMs);
+    }
+
+    if (ImGui::CollapsingHeader("Memory")) {
+        constexpr float kMiB = 1024.0f * 1024.0f;
+        ImGui::Text("%-16s %10s %6s", "Category", "MiB", "count");
+        for (auto [categoryIdx, category] : enumerate(mGuiStats.memory.categories)) {
+            ImGui::Text("%-16s %10.2f %6u", GetMemoryCategoryName(MemoryCategory(categoryIdx)), category.byteSize / kMiB, category.allocationCount);
+        }
+        ImGui::Text("Heap budgets are %s", mGuiStats.memory.isBudgetFromDriver ? "reported by the driver" : "estimated");
+        for (auto [heapIdx, heap] : enumerate(mGuiStats.memory.heaps)) {
+            if (heap.budgetBytes == 0u) continue;
+            const std::string overlay = fmt::format("{:.0f} / {:.0f} MiB", heap.usageBytes / kMiB, heap.budgetBytes / kMiB);
+            ImGui::Text("Heap %zu (%s)", heapIdx, heap.isDeviceLocal ? "device" : "host");
+            ImGui::ProgressBar(float(heap.usageBytes) / float(heap.budgetBytes), ImVec2(-1.0f, 0.0f), overlay.c_str());
+            ImGui::Text("  %u blocks, %u allocations, %.1f%% fragmented", heap.blockCount, heap.allocationCount, 100.0f * heap.fragmentation);
+        }
+    }
+
     ImGui::Render();
 }
 
@@ -152,7 +202,9 @@ void GUI::UpdateBuffers(uint32_t frameIndex)
         const BufferDesc desc = {
             .byteSize = GetAlignedSize(vertexBufferSize, 32'000ull),
             .access = MemoryAccess::HOST,
-            .usage = BufferUsageBits::VERTEX
+            .usage = BufferUsageBits::VERTEX,
+            .debugName = "GUI vertices",
+            .category = MemoryCategory::GUI,
         };
         vertexBuffer = CreateHandle<Buffer>(mDevice, desc);
     }
@@ -160,7 +212,9 @@ void GUI::UpdateBuffers(uint32_t frameIndex)
         const BufferDesc desc = {
             .byteSize = GetAlignedSize(indexBufferSize, 16'000ull),
             .access = MemoryAccess::HOST,
-            .usage = BufferUsageBits::INDEX
+            .usage = BufferUsageBits::INDEX,
+            .debugName = "GUI indices",
+            .category = MemoryCategory::GUI,
         };
         indexBuffer = CreateHandle<Buffer>(mDevice, desc);
     }
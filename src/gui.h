@@ -1,4 +1,7 @@
-#pragma on
+#pragma once
+
+#include "vk/gpu_profiler.h"
+#include "vk/memory_tracker.h"
 
 class Device;
 class Window;
@@ -10,7 +13,7 @@ class Swapchain;
 class CommandList;
 
 struct GUIParams {
-    float choppiness;
+    float choppiness = 1.5f;
     float displacementScaleFactor = 8.0f;
     float tipScaleFactor = 2.5f;
     float exposure = 0.35f;
@@ -19,10 +22,28 @@ struct GUIParams {
     float windAngle = 45.f;
 
     // In degrees
-    int sunElevation;
-    int sunAzimuth;
+    int sunElevation = 0;
+    int sunAzimuth = 90;
 
     bool isInWireframeMode = false;
+    bool isOceanUnbounded = true;
+    bool shouldSortTilesFrontToBack = true;
+    bool shouldUseOptimizedIndexOrder = true;
+
+    bool isDynamicResolutionEnabled = true;
+    float renderScale = 1.0f;    // Used when dynamic resolution is disabled
+    float gpuBudgetMs = 8.0f;    // GPU time budget of the scaled ocean passes
+};
+
+// Read-only statistics displayed by the GUI
+struct GUIStats {
+    float vertexCacheACMR = 0.0f;
+    uint64_t vertexShaderInvocations = 0u;
+    uint64_t fragmentShaderInvocations = 0u;
+    float renderScale = 1.0f;
+    float oceanGpuTimeMs = 0.0f;
+    std::vector<GpuScopeStats> gpuScopes;
+    MemoryReport memory;
 };
 
 class GUI {
@@ -33,6 +54,7 @@ public:
     void NewFrame();
     GUIParams GetParams() const { return mGuiParams; }
     bool hasWindParamsChanged() const { return mHasWindParamsChanged; }
+    void SetStats(const GUIStats& stats) { mGuiStats = stats; }
     void DrawFrame(Handle<CommandList> cmdList, const Texture& renderTarget, uint32_t frameIndex);
 
 private:
@@ -43,7 +65,8 @@ private:
     Handle<Texture> mFontTexture;
     std::array<Handle<Buffer>, 2> mVertexBuffers;
     std::array<Handle<Buffer>, 2> mIndexBuffers;
-    GUIParams mGuiParams = { .choppiness = 1.5f, .sunElevation = 0, .sunAzimuth = 90, .windMagnitude = 14.142135f, .windAngle = 45.f };
+    GUIParams mGuiParams = {};
+    GUIStats mGuiStats = {};
     bool mHasWindParamsChanged = false;
 
     const Device& mDevice;
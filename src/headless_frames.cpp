@@ -0,0 +1,66 @@
+#include "headless_frames.h"
+
+#include "timer.h"
+#include "cpu_profiler.h"
+
+#include "vk/device.h"
+#include "vk/command_list.h"
+#include "vk/texture.h"
+#include "vk/frame_pacing.h"
+#include "vk/offscreen_target.h"
+#include "vk/gpu_profiler.h"
+#include "vk/readback_queue.h"
+
+// Opens the command list of the frame, collecting the results of the frame that last used the same frame in flight
+static void BeginFrame(CommandList& cmdList, uint32_t frameIdx, uint32_t frameIndex, GpuProfiler& gpuProfiler,
+    ReadbackQueue* readbackQueue, const HeadlessFramesDesc& desc)
+{
+    cmdList.Open();
+    if (gpuProfiler.BeginFrame(cmdList, frameIndex) && desc.onGpuTimesCollected) {
+        desc.onGpuTimesCollected(frameIdx - kMaxFramesInFlightCount);
+    }
+    if (readbackQueue != nullptr) readbackQueue->BeginFrame();
+}
+
+float RunHeadlessFrames(
+    const Device& device,
+    FramePacingState& framePacingState,
+    OffscreenTarget& offscreenTarget,
+    GpuProfiler& gpuProfiler,
+    ReadbackQueue* readbackQueue,
+    const HeadlessFramesDesc& desc
+)
+{
+    const Timer timer;
+    uint32_t frameIndex = 0;
+    for (uint32_t frameIdx = 0; frameIdx < desc.frameCount; ++frameIdx) {
+        PROFILE_ZONE("Frame");
+        const Timer frameTimer;
+        framePacingState.WaitForFrameInFlight(frameIndex);
+        const Timer recordTimer;
+        const FrameState frameState = framePacingState.GetFrameState(frameIndex);
+        CommandList& cmdList = *frameState.commandList;
+        BeginFrame(cmdList, frameIdx, frameIndex, gpuProfiler, readbackQueue, desc);
+
+        Texture& targetTexture = *offscreenTarget.GetTexture(offscreenTarget.AcquireNextImage());
+        desc.recordFrame({ .frameIdx = frameIdx, .frameIndex = frameIndex, .cmdList = &cmdList, .target = &targetTexture });
+        cmdList.SetResourceState(targetTexture, ResourceStateBits::SHADER_RESOURCE);
+
+        cmdList.Close();
+        offscreenTarget.Submit(frameState.commandList, frameState);
+        if (desc.onFrameSubmitted) desc.onFrameSubmitted(frameIdx, frameTimer.Elapsed(), recordTimer.Elapsed());
+        frameIndex = (frameIndex + 1) % kMaxFramesInFlightCount;
+    }
+    device.WaitIdle();
+    const float elapsedMs = timer.Elapsed();
+
+    // Collect the frames still in flight; their command lists only reset the queries and are never submitted
+    for (uint32_t drainIdx = 0; drainIdx < kMaxFramesInFlightCount; ++drainIdx) {
+        framePacingState.WaitForFrameInFlight(frameIndex);
+        CommandList& cmdList = *framePacingState.GetFrameState(frameIndex).commandList;
+        BeginFrame(cmdList, desc.frameCount + drainIdx, frameIndex, gpuProfiler, readbackQueue, desc);
+        cmdList.Close();
+        frameIndex = (frameIndex + 1) % kMaxFramesInFlightCount;
+    }
+    return elapsedMs;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+class Device;
+class Texture;
+class CommandList;
+class GpuProfiler;
+class ReadbackQueue;
+class OffscreenTarget;
+class FramePacingState;
+
+struct HeadlessFrame {
+    uint32_t frameIdx = 0u;          // Number of frames recorded before this one
+    uint32_t frameIndex = 0u;        // Index of the frame in flight
+    CommandList* cmdList = nullptr;
+    Texture* target = nullptr;       // Image of the offscreen target; it's put back in the SHADER_RESOURCE state afterwards
+};
+
+struct HeadlessFramesDesc {
+    uint32_t frameCount = 0u;
+    std::function<void(const HeadlessFrame& frame)> recordFrame;
+    // [Optional] Called once the GPU profiler collected the pass times of a frame, with the frameIdx of that frame
+    std::function<void(uint32_t frameIdx)> onGpuTimesCollected;
+    // [Optional] Called once a frame was submitted, with the CPU time of the whole frame, including the wait for its
+    // frame in flight, and of recording and submitting it
+    std::function<void(uint32_t frameIdx, float frameMs, float recordMs)> onFrameSubmitted;
+};
+
+// Records and submits `desc.frameCount` frames into the offscreen target; the frame loop of the headless mode and of
+// the benchmark. Then waits for the GPU and collects the frames still in flight, so the GPU profiler and the readback
+// queue deliver the results of every frame. Returns the milliseconds from the first frame until the GPU was idle.
+float RunHeadlessFrames(
+    const Device& device,
+    FramePacingState& framePacingState,
+    OffscreenTarget& offscreenTarget,
+    GpuProfiler& gpuProfiler,
+    ReadbackQueue* readbackQueue,
+    const HeadlessFramesDesc& desc
+);
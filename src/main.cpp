@@ -1,11 +1,11 @@
-#include <cstddef>
-#include <random>
-
 #include "window.h"
 
 #include "gui.h"
 #include "camera.h"
 #include "timer.h"
+#include "cpu_profiler.h"
+#include "resolution_scaler.h"
+#include "headless_frames.h"
 
 #include "vk/command_list.h"
 #include "vk/device.h"
@@ -13,61 +13,132 @@
 #include "vk/texture.h"
 #include "vk/frame_pacing.h"
 #include "vk/swapchain.h"
-#include "vk/shader.h"
-#include "vk/pipeline.h"
-#include "vk/buffer.h"
+#include "vk/offscreen_target.h"
+#include "vk/gpu_profiler.h"
+#include "vk/readback_queue.h"
+#include "vk/memory_tracker.h"
 
-#include "ocean/grid.h"
-#include "ocean/ocean.h"
+#include "ocean/ocean_renderer.h"
 
 constexpr int kWindowWidth = 1280;
 constexpr int kWindowHeight = 720;
-constexpr int kGridSize = 1024;
-constexpr int kTextureSize = 512;
-constexpr int kWorkGroupDim = 32;
-
-static glm::vec3 GetSunDirection(const GUIParams& params)
+// Length of the traces written with F11
+constexpr float kTraceDurationSeconds = 5.0f;
+// Simulated time step of headless runs, so they're reproducible whatever the frame rate
+constexpr float kHeadlessDt = 1.0f / 60.0f;
+// The last frame of headless runs is written there, to check what was rendered
+constexpr const char* kHeadlessCapturePath = "waves_headless.ppm";
+// Written with F9, and at the end of headless runs
+constexpr const char* kMemoryReportPath = "waves_memory.json";
+// The memory report walks all memory blocks, so the GUI only refreshes it every so often
+constexpr float kMemoryReportIntervalMs = 500.0f;
+
+// Writes a BGRA8 image as a binary PPM, dropping the alpha channel
+static void WritePPM(const std::string& path, std::span<const std::byte> bgraData, uint32_t width, uint32_t height)
 {
-    const float sunElevationRad = glm::radians((float)params.sunElevation);
-    const float sunAzimuthRad = glm::radians((float)params.sunAzimuth);
-    return glm::vec3(
-        -glm::cos(sunElevationRad) * glm::cos(sunAzimuthRad),
-        -glm::sin(sunElevationRad),
-        -glm::cos(sunElevationRad) * glm::sin(sunAzimuthRad)
-    );
+    std::string ppm = fmt::format("P6\n{} {}\n255\n", width, height);
+    ppm.reserve(ppm.size() + 3 * size_t(width) * height);
+    for (size_t texelIdx = 0; texelIdx < size_t(width) * height; ++texelIdx) {
+        const std::byte* bgra = &bgraData[4 * texelIdx];
+        ppm += { char(bgra[2]), char(bgra[1]), char(bgra[0]) };
+    }
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write(ppm.data(), ppm.size())) {
+        LOG_ERROR("Failed to write '{}'", path);
+        return;
+    }
+    LOG_INFO("Wrote the last frame to '{}'", path);
 }
 
-static glm::vec2 GetWindDirection(const GUIParams& params)
+// Compares the heights of the CPU wave evaluator to those the GPU queries returned for the same field
+static void CompareWaveEvaluator(const WaveEvaluator& waveEvaluator, std::span<const glm::vec2> positions, double time, std::span<const WaveQueryResult> results)
 {
-    const float windAngleRad = glm::radians(params.windAngle);
-    return params.windMagnitude * glm::vec2(glm::cos(windAngleRad), glm::sin(windAngleRad));
+    std::vector<float> heights(positions.size());
+    const Timer timer;
+    waveEvaluator.EvaluateHeights(positions, time, heights);
+    const float elapsedMs = timer.Elapsed();
+    float maxError = 0.0f;
+    for (auto [pointIdx, result] : enumerate(results)) maxError = std::max(maxError, std::abs(result.height - heights[pointIdx]));
+    LOG_INFO("CPU wave evaluator: {} waves, {:.3f} m max difference to the GPU heights (bound {:.3f} m), {:.2f} M points/s",
+        waveEvaluator.GetComponentCount(), maxError, waveEvaluator.GetHeightErrorBound(), float(positions.size()) / (1000.0f * elapsedMs));
 }
 
-static Handle<Pipeline> CreateOceanPipeline(const Device& device, const Swapchain& swapchain, bool isInWireframeMode = false)
+// Renders `frameCount` frames into an offscreen target on a headless device, e.g. on a server or in CI without a
+// display, then logs the GPU time of every pass
+static int RunHeadless(uint32_t frameCount)
 {
-    Shader oceanVS = Shader(device, "ocean.vs.spv");
-    Shader oceanPS = Shader(device, "ocean.ps.spv");
-    return CreateHandle<Pipeline>(
-        device , PipelineDesc{
-        .type = PipelineType::GRAPHICS,
-        .shaders = { &oceanVS, &oceanPS },
-        .attachmentLayout = {
-            .colorAttachments = {{
-                .format = swapchain.GetFormat(),
-                .shouldEnableBlend = true
-            }},
-        },
-        .rasterization = { .cullMode = CullMode::NONE, .fillMode = isInWireframeMode ? RasterFillMode::WIREFRAME : RasterFillMode::SOLID},
-        .attributeDescs = {
-            { .name = "POSITION0", .format = Format::RGB32_FLOAT, .offset = offsetof(GridVertex, pos), .stride = sizeof(GridVertex) },
-            { .name = "TEXCOORD0", .format = Format::RG32_FLOAT, .offset = offsetof(GridVertex, uv), .stride = sizeof(GridVertex) },
+    const Timer startupTimer;
+    Device device = Device(false);
+    FramePacingState framePacingState = FramePacingState(device);
+    OffscreenTarget offscreenTarget = OffscreenTarget(device, { .width = kWindowWidth, .height = kWindowHeight });
+
+    const GUIParams params = { .isDynamicResolutionEnabled = false };
+    OceanRenderer oceanRenderer = OceanRenderer(device, OceanRendererDesc{
+        .colorFormat = offscreenTarget.GetFormat(),
+        .depthFormat = offscreenTarget.GetDepthFormat(),
+        .params = params,
+    });
+    GpuProfiler gpuProfiler = GpuProfiler(device);
+    ReadbackQueue readbackQueue = ReadbackQueue(device, 4ull * kWindowWidth * kWindowHeight);
+    const Camera camera = Camera(glm::vec3(0.f, 10.f, 0.f), 0.1f, 1000.f);
+    const float aspectRatio = float(kWindowWidth) / float(kWindowHeight);
+
+    // The heights of a grid of points are queried on the GPU a few frames before the end, so they arrive in time
+    const WaveEvaluator waveEvaluator = oceanRenderer.CreateWaveEvaluator(params);
+    std::vector<glm::vec2> waveQueryPositions;
+    for (uint32_t z = 0; z < 64u; ++z) {
+        for (uint32_t x = 0; x < 64u; ++x) waveQueryPositions.push_back(glm::vec2(x, z) * 8.0f);
+    }
+    double waveQueryTime = 0.0;
+    LOG_INFO("Rendering {} frames headless after {:.1f} ms of startup", frameCount, startupTimer.Elapsed());
+
+    const float elapsedMs = RunHeadlessFrames(device, framePacingState, offscreenTarget, gpuProfiler, &readbackQueue, {
+        .frameCount = frameCount,
+        .recordFrame = [&](const HeadlessFrame& frame) {
+            const bool shouldQueryWaves = frame.frameIdx + 1 + kMaxFramesInFlightCount == frameCount;
+            if (shouldQueryWaves) {
+                oceanRenderer.GetWaveQueries().Query(waveQueryPositions, [&](std::span<const WaveQueryResult> results) {
+                    CompareWaveEvaluator(waveEvaluator, waveQueryPositions, waveQueryTime, results);
+                });
+            }
+
+            oceanRenderer.RecordFrame(*frame.cmdList, OceanFrameDesc{
+                .frameIndex = frame.frameIndex,
+                .dt = kHeadlessDt,
+                .renderScale = params.renderScale,
+                .worldToClip = camera.GetViewProjectionMatrix(aspectRatio),
+                .cameraPosition = camera.GetPosition(),
+                .params = params,
+                .colorTarget = frame.target,
+                .depthTarget = offscreenTarget.GetDepthTexture(),
+            }, &gpuProfiler);
+            if (shouldQueryWaves) waveQueryTime = oceanRenderer.GetSimulatedTime();
+            if (frame.frameIdx + 1 == frameCount) {
+                readbackQueue.ReadTexture(*frame.cmdList, *frame.target, [](std::span<const std::byte> data) {
+                    WritePPM(kHeadlessCapturePath, data, kWindowWidth, kWindowHeight);
+                });
+            }
         },
-        .depthStencil = { .shouldEnableDepthTesting = true, .depthCompareOp = CompareOp::LESS_OR_EQUAL  },
     });
+    LOG_INFO("Rendered {} frames in {:.1f} ms ({:.3f} ms per frame)", frameCount, elapsedMs, elapsedMs / float(std::max(frameCount, 1u)));
+    for (const GpuScopeStats& scope : gpuProfiler.GetStats()) {
+        LOG_INFO("  {:<16} avg {:.3f} ms, median {:.3f} ms, p95 {:.3f} ms", scope.name, scope.averageMs, scope.medianMs, scope.p95Ms);
+    }
+    device.GetMemoryTracker().WriteJson(kMemoryReportPath);
+    return 0;
 }
 
 int main()
 {
+    // Recording can also be toggled with F10; F11 writes a trace of the last seconds, F9 a memory report
+    CpuProfiler::SetThreadName("main");
+    CpuProfiler::SetEnabled(std::getenv("WAVES_PROFILE") != nullptr);
+    // WAVES_HEADLESS=<frame count> renders that many frames without a window and exits
+    if (const char* headlessFrameCount = std::getenv("WAVES_HEADLESS")) {
+        return RunHeadless(uint32_t(std::max(0, std::atoi(headlessFrameCount))));
+    }
+
+    const Timer startupTimer;
     Window window = Window(kWindowWidth, kWindowHeight, "waves", false);
     Device device = Device(window, true);
     FramePacingState framePacingState = FramePacingState(device);
@@ -78,350 +149,118 @@ int main()
         .framebufferHeight = framebufferHeight
     };
     Swapchain swapchain = Swapchain(device, swapchainDesc);
+
     GUI gui = GUI(device, swapchain, window);
 
-    Camera camera = Camera(glm::vec3(0.f, 10.f, 0.f), 0.1f, 10000.f, 1000.f);
+    Camera camera = Camera(glm::vec3(0.f, 10.f, 0.f), 0.1f, 1000.f);
 
-    Shader blitVS = Shader(device, "blit.vs.spv");
-    Shader blitPS = Shader(device, "blit.ps.spv");
-    auto blitPipeline = CreateHandle<Pipeline>(
-        device , PipelineDesc{
-        .type = PipelineType::GRAPHICS,
-        .shaders = { &blitVS, &blitPS },
-        .attachmentLayout = { .colorAttachments = {{ .format = swapchain.GetFormat(), .shouldEnableBlend = true }} },
-        .rasterization = { .primitiveType = PrimitiveType::TRIANGLE_STRIP },
-        .depthStencil = { .shouldEnableDepthTesting = true }
-    });
+    ResolutionScaler resolutionScaler;
+    GpuProfiler gpuProfiler = GpuProfiler(device);
 
-    // Set up ocean rendering pipeline
-    const Grid& grid = MakeGrid(kGridSize);
-    const GridMesh& gridMesh = MakeGridMesh(device, grid);
+    OceanRenderer oceanRenderer = OceanRenderer(device, OceanRendererDesc{
+        .colorFormat = swapchain.GetFormat(),
+        .depthFormat = swapchain.GetDepthFormat(),
+        .params = gui.GetParams(),
+    });
+    GUIStats guiStats = {};
+    oceanRenderer.UpdateStats(0, guiStats);
+    gui.SetStats(guiStats);
 
-    auto oceanPipeline = CreateOceanPipeline(device, swapchain, false);
     auto [width, height] = window.GetWindowSize();
     const float aspectRatio = float(width) / float(height);
-    const glm::mat4 worldToClip = camera.GetViewProjectionMatrix(aspectRatio);
-    OceanPushConstantData oceanPushConstantData = {
-        .worldToClip = worldToClip,
-        .cameraPosition = camera.GetPosition(),
-        .sunDirection = GetSunDirection(gui.GetParams()),
-        .displacementScaleFactor = (float)kTextureSize / kGridSize,
-    };
-
-    // Set up normal map pipeline
-    Shader normalMapCS = Shader(device, "normal_map.cs.spv");
-    auto normalMapPipeline = CreateHandle<Pipeline>( device, PipelineDesc{ .type = PipelineType::COMPUTE, .shaders = { &normalMapCS } });
-    auto normalMapTexture = CreateHandle<Texture>(device, TextureDesc{
-        .dimensions = { kTextureSize, kTextureSize, 1u },
-        .sampler = { .filter = Filter::TRILINEAR, .wrapMode = WrapMode::WRAP },
-        .format = Format::RGBA32_FLOAT,
-        .usage = TextureUsageBits::SAMPLED | TextureUsageBits::STORAGE,
-    });
-    NormalMapPushConstantData normalMapPushConstantData = { .texSize = kTextureSize, .oceanSize = kGridSize };
-
-    // Set up initial spectrum pipeline
-    Shader initialSpectrumCS = Shader(device, "initial_spectrum.cs.spv");
-    auto initialSpectrumPipeline = CreateHandle<Pipeline>(
-        device, PipelineDesc{
-        .type = PipelineType::COMPUTE,
-        .shaders = { &initialSpectrumCS }
-    });
-    auto initialSpectrumTexture = CreateHandle<Texture>(device, TextureDesc{
-        .dimensions = { kTextureSize, kTextureSize, 1u },
-        .format = Format::R32_FLOAT,
-        .usage = TextureUsageBits::STORAGE | TextureUsageBits::SAMPLED,
-    });
-    InitialSpectrumPushConstantData initialSpectrumPushConstantData = {
-        .texSize = kTextureSize,
-        .oceanSize = kGridSize,
-    };
-
-    // Set up phase pipeline
-    Shader phaseCS = Shader(device, "phase.cs.spv");
-    auto phasePipeline = CreateHandle<Pipeline>(
-        device, PipelineDesc{ .type = PipelineType::COMPUTE, .shaders = { &phaseCS }
-    });
-    PhasePushConstantData phasePushConstantData = {
-        .dt = 0.0f,
-        .texSize = kTextureSize,
-        .oceanSize = kGridSize
-    };
-    // Store phases separately to ensure continuity of waves during parameter editing
-    auto pingPhaseTexture = CreateHandle<Texture>(device, TextureDesc{
-        .dimensions = { kTextureSize, kTextureSize, 1u },
-        .format = Format::R32_FLOAT,
-        .sampler = { .filter = Filter::TRILINEAR, .wrapMode = WrapMode::CLAMP_TO_BORDER },
-        .usage = TextureUsageBits::STORAGE | TextureUsageBits::SAMPLED,
-    });
-    auto pongPhaseTexture = CreateHandle<Texture>(device, TextureDesc{
-        .dimensions = { kTextureSize, kTextureSize, 1u },
-        .format = Format::R32_FLOAT,
-        .usage = TextureUsageBits::STORAGE | TextureUsageBits::SAMPLED,
-    });
-
-    std::vector<float> pingPhaseArray(kTextureSize * kTextureSize);
-    std::random_device dev;
-    std::mt19937 rng(dev());
-    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-    for (int i = 0; i < pingPhaseArray.size(); ++i) pingPhaseArray[i] = 2.0f * M_PI * dist(rng);
-
-    Buffer pingPhaseArrayStagingBuffer = Buffer(
-        device, { 
-        .byteSize = pingPhaseArray.size() * sizeof(float),
-        .access = MemoryAccess::HOST,
-        .data = pingPhaseArray.data() 
-    });
-    {
-        auto cmdList = device.CreateCommandList();
-        cmdList->Open();
-        cmdList->SetResourceState(*pingPhaseTexture, ResourceStateBits::COPY_DEST);
-        cmdList->WriteTexture(pingPhaseTexture.get(), pingPhaseArrayStagingBuffer);
-        cmdList->SetResourceState(*pingPhaseTexture, ResourceStateBits::UNORDERED_ACCESS);
-        cmdList->Close();
-        device.ExecuteCommandList(cmdList);
-    }
-
-
-    // Set up spectrum pipeline
-    Shader spectrumCS = Shader(device, "spectrum.cs.spv");
-    auto spectrumPipeline = CreateHandle<Pipeline>(
-        device, PipelineDesc{ .type = PipelineType::COMPUTE, .shaders = { &spectrumCS }
-    });
-    SpectrumPushConstantData spectrumPushConstantData = {
-        .choppiness = gui.GetParams().choppiness,
-        .oceanSize = kGridSize,
-        .texSize = kTextureSize
-    };
-    auto spectrumTexture = CreateHandle<Texture>(device, TextureDesc{
-        .dimensions = { kTextureSize, kTextureSize, 1u },
-        .format = Format::RGBA32_FLOAT,
-        .sampler = { .wrapMode = WrapMode::WRAP, .filter = Filter::TRILINEAR },
-        .usage = TextureUsageBits::STORAGE | TextureUsageBits::SAMPLED,
-    });
-
-    // Set up FFT pipelines
-    Shader fftHorizontalCS = Shader(device, "fft_horizontal.cs.spv");
-    Shader fftVerticalCS = Shader(device, "fft_vertical.cs.spv");
-    auto fftHorizontalPipeline = CreateHandle<Pipeline>(
-        device, PipelineDesc{ .type = PipelineType::COMPUTE, .shaders = { &fftHorizontalCS }
-    });
-    auto fftVerticalPipeline = CreateHandle<Pipeline>(
-        device, PipelineDesc{ .type = PipelineType::COMPUTE, .shaders = { &fftVerticalCS }
-    });
-    auto tempTexture = CreateHandle<Texture>(device, TextureDesc{
-        .dimensions = { kTextureSize, kTextureSize, 1u },
-        .format = Format::RGBA32_FLOAT,
-        .usage = TextureUsageBits::STORAGE | TextureUsageBits::SAMPLED,
-    });
-    FFTPushConstantData fftPushConstantData = { .totalCount = kTextureSize };
-
-    // Flags
-    bool shouldUpdateInitialSpectrum = true;
-    bool isPingPhase = true;
-    bool prevWireframeMode = false;
 
     Timer timer;
     float dt = 0.0f;;
     uint32_t frameIndex = 0;
+    bool hasPresentedFirstFrame = false;
+    bool wasProfilerKeyPressed = false, wasTraceKeyPressed = false, wasMemoryReportKeyPressed = false;
+    Timer memoryReportTimer;
+    guiStats.memory = device.GetMemoryTracker().GetReport();
     while (!window.ShouldClose()) {
-        window.PollEvents();
+        PROFILE_ZONE("Frame");
+        {
+            PROFILE_ZONE("PollEvents");
+            window.PollEvents();
+        }
         camera.ProcessKeyboard(window, dt);
-        gui.NewFrame();
-
-        const auto params = gui.GetParams();
-        shouldUpdateInitialSpectrum = shouldUpdateInitialSpectrum || gui.hasWindParamsChanged();
-
-        // Generate initial spectrum
-        if (shouldUpdateInitialSpectrum) {
-            initialSpectrumPushConstantData.windDirection = GetWindDirection(params);
-
-            auto cmdList = device.CreateCommandList();
-            cmdList->Open();
-            cmdList->SetResourceState(*initialSpectrumTexture, ResourceStateBits::UNORDERED_ACCESS);
-            cmdList->SetComputeState({ 
-                .pipeline = initialSpectrumPipeline,
-                .bindings = { Binding(*initialSpectrumTexture) },
-                .pushConstants = { .byteSize = sizeof(InitialSpectrumPushConstantData), .data = (void*)&initialSpectrumPushConstantData }
-            });
-            cmdList->Dispatch(kTextureSize / kWorkGroupDim, kTextureSize / kWorkGroupDim);
-            cmdList->Close();
-            device.ExecuteCommandList(cmdList);
-
-            shouldUpdateInitialSpectrum = false;
+        if (window.Pressed(KEY_F10) && !wasProfilerKeyPressed) {
+            CpuProfiler::SetEnabled(!CpuProfiler::IsEnabled());
+            LOG_INFO("CPU profiler {}", CpuProfiler::IsEnabled() ? "enabled" : "disabled");
         }
-
-        auto& phaseTexture      = isPingPhase ? pingPhaseTexture : pongPhaseTexture;
-        auto& outPhaseTexture   = isPingPhase ? pongPhaseTexture : pingPhaseTexture;
-        // Generate phase
-        {
-            auto cmdList = device.CreateCommandList();
-            cmdList->Open();
-
-            cmdList->SetResourceState(*phaseTexture, ResourceStateBits::SHADER_RESOURCE);
-            cmdList->SetResourceState(*initialSpectrumTexture, ResourceStateBits::SHADER_RESOURCE);
-            cmdList->SetResourceState(*outPhaseTexture, ResourceStateBits::UNORDERED_ACCESS);
-
-            phasePushConstantData.dt = dt;
-            cmdList->SetComputeState({ 
-                .pipeline = phasePipeline,
-                .bindings = { Binding(*phaseTexture), Binding(*outPhaseTexture) },
-                .pushConstants = { .byteSize = sizeof(PhasePushConstantData), .data = (void*)&phasePushConstantData }
-            });
-            cmdList->Dispatch(kTextureSize / kWorkGroupDim, kTextureSize / kWorkGroupDim);
-            cmdList->Close();
-            device.ExecuteCommandList(cmdList);
+        if (window.Pressed(KEY_F11) && !wasTraceKeyPressed) {
+            CpuProfiler::WriteChromeTrace("waves_trace.json", kTraceDurationSeconds);
         }
-
-        // Generate spectrum
-        {
-            spectrumPushConstantData.choppiness = params.choppiness;
-
-            auto cmdList = device.CreateCommandList();
-            cmdList->Open();
-            cmdList->SetResourceState(*outPhaseTexture, ResourceStateBits::SHADER_RESOURCE);
-            cmdList->SetResourceState(*spectrumTexture, ResourceStateBits::UNORDERED_ACCESS);
-            cmdList->SetComputeState({ 
-                .pipeline = spectrumPipeline,
-                .bindings = { 
-                    Binding(*outPhaseTexture),
-                    Binding(*initialSpectrumTexture),
-                    Binding(*spectrumTexture)
-                },
-                .pushConstants = { .byteSize = sizeof(SpectrumPushConstantData), .data = (void*)&spectrumPushConstantData }
-            });
-            cmdList->Dispatch(kTextureSize / kWorkGroupDim, kTextureSize / kWorkGroupDim);
-            cmdList->Close();
-            device.ExecuteCommandList(cmdList);
+        if (window.Pressed(KEY_F9) && !wasMemoryReportKeyPressed) {
+            device.GetMemoryTracker().WriteJson(kMemoryReportPath);
         }
-
-        // FFT Horizontal step
-        bool shouldUseTempTextureAsInput = false;
+        wasProfilerKeyPressed = window.Pressed(KEY_F10);
+        wasTraceKeyPressed = window.Pressed(KEY_F11);
+        wasMemoryReportKeyPressed = window.Pressed(KEY_F9);
         {
-            for (int p = 1; p < kTextureSize; p <<= 1) {
-                fftPushConstantData.subseqCount = p;
-
-                auto cmdList = device.CreateCommandList();
-                cmdList->Open();
-
-                auto& input = shouldUseTempTextureAsInput ? tempTexture : spectrumTexture;
-                auto& output = shouldUseTempTextureAsInput ? spectrumTexture : tempTexture;
-
-                cmdList->SetResourceState(*input, ResourceStateBits::SHADER_RESOURCE);
-                cmdList->SetResourceState(*output, ResourceStateBits::UNORDERED_ACCESS);
-
-                cmdList->SetComputeState({ 
-                    .pipeline = fftHorizontalPipeline,
-                    .bindings = { Binding(*input), Binding(*output) },
-                    .pushConstants = { .byteSize = sizeof(FFTPushConstantData), .data = (void*)&fftPushConstantData }
-                });
-
-                cmdList->Dispatch(kTextureSize);
-                cmdList->Close();
-                device.ExecuteCommandList(cmdList);
-            
-                shouldUseTempTextureAsInput = !shouldUseTempTextureAsInput;
-            }
+            PROFILE_ZONE("GUI::NewFrame");
+            gui.NewFrame();
         }
 
-        // FFT Vertical step
-        {
-            for (int p = 1; p < kTextureSize; p <<= 1) {
-                fftPushConstantData.subseqCount = p;
-
-                auto cmdList = device.CreateCommandList();
-                cmdList->Open();
-
-                auto& input = shouldUseTempTextureAsInput ? tempTexture : spectrumTexture;
-                auto& output = shouldUseTempTextureAsInput ? spectrumTexture : tempTexture;
-
-                cmdList->SetResourceState(*input, ResourceStateBits::SHADER_RESOURCE);
-                cmdList->SetResourceState(*output, ResourceStateBits::UNORDERED_ACCESS);
-
-                cmdList->SetComputeState({ 
-                    .pipeline = fftVerticalPipeline,
-                    .bindings = { Binding(*input), Binding(*output) },
-                    .pushConstants = { .byteSize = sizeof(FFTPushConstantData), .data = (void*)&fftPushConstantData }
-                });
-
-                cmdList->Dispatch(kTextureSize);
-                cmdList->Close();
-                device.ExecuteCommandList(cmdList);
-            
-                shouldUseTempTextureAsInput = !shouldUseTempTextureAsInput;
-            }
-        }
+        const auto params = gui.GetParams();
 
-        // Generate normal map
         {
-            auto cmdList = device.CreateCommandList();
-            cmdList->Open();
-            cmdList->SetResourceState(*spectrumTexture, ResourceStateBits::SHADER_RESOURCE);
-            cmdList->SetResourceState(*normalMapTexture, ResourceStateBits::UNORDERED_ACCESS);
-            cmdList->SetComputeState({ 
-                .pipeline = normalMapPipeline,
-                .bindings = { Binding(*spectrumTexture), Binding(*normalMapTexture) },
-                .pushConstants = { .byteSize = sizeof(NormalMapPushConstantData), .data = (void*)&normalMapPushConstantData }
-            });
-            cmdList->Dispatch(kTextureSize / kWorkGroupDim, kTextureSize / kWorkGroupDim);
-            cmdList->Close();
-            device.ExecuteCommandList(cmdList);
+            PROFILE_ZONE("WaitForFrameInFlight");
+            framePacingState.WaitForFrameInFlight(frameIndex);
         }
-
-
-        framePacingState.WaitForFrameInFlight(frameIndex);
         auto frameState = framePacingState.GetFrameState(frameIndex);
-
         auto cmdList = frameState.commandList;
         cmdList->Open();
 
-        const uint32_t swapchainImageIndex = swapchain.AcquireNextImage(UINT64_MAX, frameState);
-        Texture& swapchainTexture = *swapchain.GetTexture(swapchainImageIndex);
-
-        cmdList->SetResourceState(swapchainTexture, ResourceStateBits::RENDER_TARGET);
+        oceanRenderer.UpdateStats(frameIndex, guiStats);
+        // The scaled passes are the ocean and its upscale
+        if (gpuProfiler.BeginFrame(*cmdList, frameIndex)) {
+            guiStats.oceanGpuTimeMs = gpuProfiler.GetLastTimeMs("ocean") + gpuProfiler.GetLastTimeMs("blit");
+            if (params.isDynamicResolutionEnabled) resolutionScaler.Update(guiStats.oceanGpuTimeMs, params.gpuBudgetMs);
+            guiStats.gpuScopes = gpuProfiler.GetStats();
+        }
+        const float renderScale = params.isDynamicResolutionEnabled ? resolutionScaler.scale : params.renderScale;
+        guiStats.renderScale = renderScale;
+        if (memoryReportTimer.Elapsed() > kMemoryReportIntervalMs) {
+            guiStats.memory = device.GetMemoryTracker().GetReport();
+            memoryReportTimer.Reset();
+        }
+        gui.SetStats(guiStats);
 
-        // Ocean shading
-        oceanPushConstantData.cameraPosition = camera.GetPosition();
-        oceanPushConstantData.worldToClip = camera.GetViewProjectionMatrix(aspectRatio);
-        oceanPushConstantData.sunDirection = GetSunDirection(params);
-        oceanPushConstantData.displacementScaleFactor = params.displacementScaleFactor;
-        oceanPushConstantData.tipScaleFactor = params.tipScaleFactor;
-        oceanPushConstantData.exposure = params.exposure;
-        auto& displacementMap = shouldUseTempTextureAsInput ? tempTexture : spectrumTexture;
-        cmdList->SetResourceState(*displacementMap, ResourceStateBits::SHADER_RESOURCE);
-        cmdList->SetResourceState(*normalMapTexture, ResourceStateBits::SHADER_RESOURCE);
-        cmdList->SetGraphicsState({
-            .pipeline = oceanPipeline,
-            .viewport = swapchain.GetViewport(),
-            .colorAttachments = {{
-                .texture = &swapchainTexture,
-                .loadOp = LoadOp::CLEAR,
-                .clearColor = glm::vec4(0.674f, 0.966f, 0.988f, 1.f)
-            }},
-            .bindings = { Binding(*displacementMap), Binding(*normalMapTexture) },
-            .vertexBuffer = gridMesh.vertexBuffer,
-            .indexBuffer = {.buffer = gridMesh.indexBuffer, .format = Format::R32_UINT },
-            .pushConstants = { .byteSize = sizeof(OceanPushConstantData), .data = (void*)&oceanPushConstantData },
-        });
-        cmdList->DrawIndexed({ .vertexCount = (uint32_t)grid.indices.size() });
+        uint32_t swapchainImageIndex;
+        {
+            PROFILE_ZONE("AcquireNextImage");
+            swapchainImageIndex = swapchain.AcquireNextImage(UINT64_MAX, frameState);
+        }
+        Texture& swapchainTexture = *swapchain.GetTexture(swapchainImageIndex);
 
+        oceanRenderer.RecordFrame(*cmdList, OceanFrameDesc{
+            .frameIndex = frameIndex,
+            .dt = dt,
+            .renderScale = renderScale,
+            .worldToClip = camera.GetViewProjectionMatrix(aspectRatio),
+            .cameraPosition = camera.GetPosition(),
+            .params = params,
+            .colorTarget = &swapchainTexture,
+            .depthTarget = swapchain.GetDepthTexture(),
+            .drawOverlay = [&](CommandList&) { gui.DrawFrame(cmdList, swapchainTexture, frameIndex); },
+        }, &gpuProfiler);
         cmdList->SetResourceState(swapchainTexture, ResourceStateBits::PRESENT);
-        gui.DrawFrame(cmdList, swapchainTexture, frameIndex);
 
         cmdList->Close();
-        swapchain.SubmitAndPresent(cmdList, swapchainImageIndex, frameState);
+        {
+            PROFILE_ZONE("SubmitAndPresent");
+            swapchain.SubmitAndPresent(cmdList, swapchainImageIndex, frameState);
+        }
+        if (!hasPresentedFirstFrame) {
+            LOG_INFO("Time to first frame: {:.1f} ms ({} pipeline cache)",
+                startupTimer.Elapsed(), device.HasLoadedPipelineCache() ? "warm" : "cold");
+            hasPresentedFirstFrame = true;
+        }
 
         frameIndex = (frameIndex + 1) % kMaxFramesInFlightCount;
 
         dt = timer.Elapsed() / 1000.0f;
         timer.Reset();
-
-        isPingPhase = !isPingPhase;
-        if (prevWireframeMode != params.isInWireframeMode) {
-            prevWireframeMode = params.isInWireframeMode;
-            device.WaitIdle();
-            oceanPipeline = CreateOceanPipeline(device, swapchain, params.isInWireframeMode);
-            prevWireframeMode = params.isInWireframeMode;
-        }
     }
     device.WaitIdle();
 
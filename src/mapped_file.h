@@ -0,0 +1,42 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <span>
+
+// Read-only memory mapping of a whole file. The data is empty if the file couldn't be opened or mapped.
+// NOTE: POSIX only, like the rest of the platform code (see logger.h)
+class MappedFile {
+public:
+    inline explicit MappedFile(const std::string& path)
+    {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+            void* data = mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                mData = data;
+                mSize = size_t(fileStat.st_size);
+            }
+        }
+        close(fd); // The mapping stays valid after the descriptor is closed
+    }
+    inline ~MappedFile()
+    {
+        if (mData != nullptr) munmap(mData, mSize);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    template<typename T>
+    std::span<const T> GetData() const { return { (const T*)mData, mSize / sizeof(T) }; }
+    bool IsValid() const { return mData != nullptr; }
+
+private:
+    void* mData = nullptr;
+    size_t mSize = 0;
+};
@@ -11,43 +11,80 @@
 #include <cstddef>
 #include <iostream>
 
-constexpr float kUvScale = 2.0f;
+// Emits the two triangles of the quad whose bottom-left vertex is (x, y)
+// NOTE: Clockwise winding of triangle
+static void AppendQuadIndices(std::vector<uint32_t>& indices, int vertexCount, int x, int y)
+{
+    indices.push_back((vertexCount * y) + x);
+    indices.push_back((vertexCount * (y + 1)) + x);
+    indices.push_back((vertexCount * y) + x + 1);
+
+    indices.push_back((vertexCount * y) + x + 1);
+    indices.push_back((vertexCount * (y + 1)) + x);
+    indices.push_back((vertexCount * (y + 1)) + x + 1);
+}
 
-Grid MakeGrid(int32_t gridSize)
+// Walks the grid in vertical strips that are `stripWidth` quads wide, row by row within each strip.
+// As long as both vertex rows of a strip fit in the post-transform cache, the shared row is still
+// cached when the next row is emitted, so every vertex is shaded about once instead of twice.
+static std::vector<uint32_t> GenerateGridIndices(int32_t gridSize, int32_t stripWidth)
 {
     const int vertexCount = gridSize + 1;
-    std::vector<GridVertex> vertices(vertexCount * vertexCount);
     // 2 triangles per quad and 3 vertices per triangle
-    std::vector<uint32_t> indices(gridSize * gridSize * 2 * 3);
+    std::vector<uint32_t> indices;
+    indices.reserve(gridSize * gridSize * 2 * 3);
+
+    // Generate triangle indices for the grid – from the bottom-left corner
+    for (int stripStart = 0; stripStart < gridSize; stripStart += stripWidth) {
+        const int stripEnd = std::min(stripStart + stripWidth, gridSize);
+        for (int y = 0; y < gridSize; ++y) {
+            for (int x = stripStart; x < stripEnd; ++x) {
+                AppendQuadIndices(indices, vertexCount, x, y);
+            }
+        }
+    }
+    assert(indices.size() == gridSize * gridSize * 2 * 3);
+    return indices;
+}
+
+Grid MakeGrid(int32_t gridSize, float tileSize, bool shouldOptimizeVertexCache)
+{
+    const int vertexCount = gridSize + 1;
+    const float vertexSpacing = tileSize / gridSize;
+    std::vector<GridVertex> vertices(vertexCount * vertexCount);
 
     int currentIdx = 0;
     for (int z = -gridSize / 2; z <= gridSize / 2; ++z) {
         for (int x = -gridSize / 2; x <= gridSize / 2; ++x) {
-            vertices[currentIdx].pos = glm::vec3(float(x), 0.0f, float(z));
+            vertices[currentIdx].pos = glm::vec3(float(x), 0.0f, float(z)) * vertexSpacing;
 
             const float u = (float(x) / gridSize) + 0.5f;
             const float v = (float(z) / gridSize) + 0.5f;
-            vertices[currentIdx++].uv = glm::vec2(u, v) * kUvScale;
+            vertices[currentIdx++].uv = glm::vec2(u, v) * kGridUvScale;
         }
     }
     assert(currentIdx == vertices.size());
 
-    // Generate triangle indices for the grid – from the bottom-left corner
-    // NOTE: Clockwise winding of triangle
-    currentIdx = 0;
-    for (int y = 0; y < gridSize; ++y) {
-        for (int x = 0; x < gridSize; ++x) {
-            indices[currentIdx++] = (vertexCount * y) + x;
-            indices[currentIdx++] = (vertexCount * (y + 1)) + x;
-            indices[currentIdx++] = (vertexCount * y) + x + 1;
-    
-            indices[currentIdx++] = (vertexCount * y) + x + 1;
-            indices[currentIdx++] = (vertexCount * (y + 1)) + x;
-            indices[currentIdx++] = (vertexCount * (y + 1)) + x + 1;
-        }
+    // One row of quads in a strip touches (stripWidth + 1) vertices on each of its two vertex rows
+    const int32_t stripWidth = shouldOptimizeVertexCache ? int32_t(kVertexCacheSize / 2 - 1) : gridSize;
+    return { .vertices = vertices, .indices = GenerateGridIndices(gridSize, stripWidth) };
+}
+
+float ComputeACMR(const std::vector<uint32_t>& indices, uint32_t cacheSize)
+{
+    if (indices.empty()) return 0.0f;
+
+    // FIFO cache: a hit doesn't change the order of the entries
+    std::vector<uint32_t> cache(cacheSize, ~0u);
+    uint32_t cacheHead = 0u;
+    uint64_t missCount = 0u;
+    for (uint32_t index : indices) {
+        if (std::find(cache.begin(), cache.end(), index) != cache.end()) continue;
+        cache[cacheHead] = index;
+        cacheHead = (cacheHead + 1) % cacheSize;
+        ++missCount;
     }
-    assert(currentIdx == indices.size());
-    return { .vertices = vertices, .indices = indices };
+    return float(missCount) / float(indices.size() / 3);
 }
 
 
@@ -57,13 +94,17 @@ GridMesh MakeGridMesh(const Device& device, const Grid& grid)
         .byteSize = grid.vertices.size() * sizeof(GridVertex),
         .access = MemoryAccess::HOST, // TODO: Should this be DEVICE?
         .usage = BufferUsageBits::VERTEX,
-        .data = grid.vertices.data()
+        .data = grid.vertices.data(),
+        .debugName = "Grid vertices",
+        .category = MemoryCategory::MESH,
     });
     auto indexBuffer = CreateHandle<Buffer>(device, BufferDesc{
         .byteSize = grid.indices.size() * sizeof(uint32_t),
         .access = MemoryAccess::HOST, // TODO: Should this be DEVICE?
         .usage = BufferUsageBits::INDEX,
-        .data = grid.indices.data()
+        .data = grid.indices.data(),
+        .debugName = "Grid indices",
+        .category = MemoryCategory::MESH,
     });
-    return { .vertexBuffer = vertexBuffer, .indexBuffer = indexBuffer };
+    return { .vertexBuffer = vertexBuffer, .indexBuffer = indexBuffer, .indexCount = uint32_t(grid.indices.size()) };
 }
\ No newline at end of file
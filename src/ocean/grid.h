@@ -2,6 +2,12 @@
 
 #include "vk/pipeline.h"
 
+// Number of entries in the simulated post-transform vertex cache. We pick a conservative
+// size so the index order still pays off on GPUs with small (or batch-based) caches.
+constexpr uint32_t kVertexCacheSize = 16;
+// Texture coordinates spanned by a grid, i.e. how many periods of the simulation textures it repeats
+constexpr float kGridUvScale = 2.0f;
+
 // TODO: We probably don't need this struct; texture coordinates can be computed on the fly, right?
 struct GridVertex {
     glm::vec3 pos;
@@ -16,7 +22,12 @@ struct Grid {
 struct GridMesh {
     Handle<Buffer> vertexBuffer;
     Handle<Buffer> indexBuffer;
+    uint32_t indexCount = 0u;
 };
 
-Grid MakeGrid(int32_t gridSize);
-GridMesh MakeGridMesh(const Device& device, const Grid& grid);
\ No newline at end of file
+// Makes a grid of `gridSize` x `gridSize` quads spanning `tileSize` world units, centered at the origin
+Grid MakeGrid(int32_t gridSize, float tileSize, bool shouldOptimizeVertexCache = true);
+GridMesh MakeGridMesh(const Device& device, const Grid& grid);
+
+// Average cache miss ratio (shaded vertices per triangle) of a FIFO post-transform cache
+float ComputeACMR(const std::vector<uint32_t>& indices, uint32_t cacheSize = kVertexCacheSize);
@@ -1,41 +1,23 @@
 #pragma once
 
-struct OceanPushConstantData {
-    glm::mat4 worldToClip;
+#include "shaders/shader_layouts.h"
 
-    glm::vec3 cameraPosition;
-    float displacementScaleFactor;
-
-    glm::vec3 sunDirection;
-    float tipScaleFactor;
-
-    float exposure;
-};
-
-struct InitialSpectrumPushConstantData {
-    glm::vec2 windDirection;
-    int texSize;
-    int oceanSize;
-};
-
-struct PhasePushConstantData {
-    float dt;
-    int texSize;
-    int oceanSize;
-};
-
-struct SpectrumPushConstantData {
-    int texSize;
-    int oceanSize;
-    float choppiness;
-};
-
-struct NormalMapPushConstantData {
-    int texSize;
-    int oceanSize;
+// IDs of the specialization constants declared in shaders/simulation.hlsli
+enum class SimulationConstantId : uint32_t {
+    TEX_SIZE = 0,
+    OCEAN_SIZE = 1,
 };
 
-struct FFTPushConstantData {
-    int totalCount;
-    int subseqCount;
-};
\ No newline at end of file
+// Push constants of the ocean passes, generated from the shaders at build time so they can't drift apart
+using OceanPushConstantData = ocean_vs::PushConstants;
+using InitialSpectrumPushConstantData = initial_spectrum_cs::PushConstants;
+using PhasePushConstantData = phase_cs::PushConstants;
+using SpectrumPushConstantData = spectrum_cs::PushConstants;
+using FFTPushConstantData = fft_horizontal_cs::PushConstants;
+using NormalMapPushConstantData = normal_map_cs::PushConstants;
+using WaveQueryPushConstantData = wave_query_cs::PushConstants;
+using BlitPushConstantData = blit_ps::PushConstants;
+
+// Both FFT passes share the same push constants, as do both ocean stages
+static_assert(sizeof(fft_horizontal_cs::PushConstants) == sizeof(fft_vertical_cs::PushConstants));
+static_assert(sizeof(ocean_vs::PushConstants) == sizeof(ocean_ps::PushConstants));
@@ -0,0 +1,539 @@
+#include "ocean/ocean_renderer.h"
+
+#include <cstddef>
+#include <random>
+
+#include "timer.h"
+#include "cpu_profiler.h"
+
+#include "vk/command_list.h"
+#include "vk/device.h"
+#include "vk/common.h"
+#include "vk/texture.h"
+#include "vk/shader.h"
+#include "vk/pipeline.h"
+#include "vk/buffer.h"
+#include "vk/gpu_profiler.h"
+
+constexpr int kGridSize = 1024;
+constexpr int kTextureSize = 512;
+// Workgroup sizes the simulation kernels are compiled with, see shaders/CMakeLists.txt. The last one is the
+// default from shaders/simulation.hlsli, which is compiled without a suffix.
+constexpr std::array<uint32_t, 3> kWorkGroupDims = { 8u, 16u, 32u };
+constexpr std::array<uint32_t, 3> kFFTWorkGroupSizes = { 64u, 128u, 256u };
+static_assert(std::ranges::all_of(kWorkGroupDims, [](uint32_t dim) { return kTextureSize % dim == 0; }));
+
+static std::vector<KernelVariant> GetWorkGroupVariants(const std::string& shaderName, std::span<const uint32_t> workGroupSizes)
+{
+    std::vector<KernelVariant> variants;
+    for (uint32_t workGroupSize : workGroupSizes) {
+        const bool isDefault = workGroupSize == workGroupSizes.back();
+        variants.push_back({
+            .shaderFilename = isDefault ? fmt::format("{}.spv", shaderName) : fmt::format("{}.wg{}.spv", shaderName, workGroupSize),
+            .workGroupSize = workGroupSize,
+        });
+    }
+    return variants;
+}
+
+static glm::vec3 GetSunDirection(const GUIParams& params)
+{
+    const float sunElevationRad = glm::radians((float)params.sunElevation);
+    const float sunAzimuthRad = glm::radians((float)params.sunAzimuth);
+    return glm::vec3(
+        -glm::cos(sunElevationRad) * glm::cos(sunAzimuthRad),
+        -glm::sin(sunElevationRad),
+        -glm::cos(sunElevationRad) * glm::sin(sunAzimuthRad)
+    );
+}
+
+static glm::vec2 GetWindDirection(const GUIParams& params)
+{
+    const float windAngleRad = glm::radians(params.windAngle);
+    return params.windMagnitude * glm::vec2(glm::cos(windAngleRad), glm::sin(windAngleRad));
+}
+
+static std::shared_future<Handle<Pipeline>> CreateOceanPipelineAsync(const Device& device, Format colorFormat, Format depthFormat)
+{
+    return device.CreatePipelineAsync(PipelineDesc{
+        .type = PipelineType::GRAPHICS,
+        .attachmentLayout = {
+            .colorAttachments = {{
+                .format = colorFormat,
+                .shouldEnableBlend = true
+            }},
+            .depthStencilFormat = depthFormat,
+        },
+        // The wireframe toggle switches the fill mode per draw, so it never has to rebuild the pipeline
+        .rasterization = { .cullMode = CullMode::NONE, .isFillModeDynamic = true },
+        .attributeDescs = {
+            { .name = "POSITION0", .format = Format::RGB32_FLOAT, .offset = offsetof(GridVertex, pos), .stride = sizeof(GridVertex) },
+            { .name = "TEXCOORD0", .format = Format::RG32_FLOAT, .offset = offsetof(GridVertex, uv), .stride = sizeof(GridVertex) },
+            {
+                .name = "TEXCOORD1", .format = Format::RG32_FLOAT, .binding = 1,
+                .offset = offsetof(OceanTileInstance, offset), .stride = sizeof(OceanTileInstance), .isInstanced = true
+            },
+        },
+        // Reverse-Z: closer fragments have greater depth
+        .depthStencil = { .shouldEnableDepthTesting = true, .shouldEnableDepthWrite = true, .depthCompareOp = CompareOp::GREATER_OR_EQUAL },
+    }, { "ocean.vs.spv", "ocean.ps.spv" });
+}
+
+OceanRenderer::OceanRenderer(const Device& device, const OceanRendererDesc& desc)
+    : mDevice(device)
+    , mOceanTiles(device, (float)kGridSize)
+    , mStatisticsQueryPool(device, { .type = QueryType::PIPELINE_STATISTICS, .queryCount = kMaxFramesInFlightCount })
+    , mRenderGraph(device)
+{
+    const Timer startupTimer;
+    // Compile all pipelines concurrently in the background; they're joined right before the kernels are tuned
+    auto blitPipelineFuture = mDevice.CreatePipelineAsync(PipelineDesc{
+        .type = PipelineType::GRAPHICS,
+        .attachmentLayout = { .colorAttachments = {{ .format = desc.colorFormat }} },
+        .rasterization = { .cullMode = CullMode::NONE, .primitiveType = PrimitiveType::TRIANGLE_STRIP },
+    }, { "blit.vs.spv", "blit.ps.spv" });
+    auto oceanPipelineFuture = CreateOceanPipelineAsync(mDevice, desc.colorFormat, desc.depthFormat);
+    // The simulation sizes are baked into the compute pipelines so the shaders can fold them
+    const PipelineDesc simulationPipelineDesc = {
+        .type = PipelineType::COMPUTE,
+        .specializationConstants = {
+            { .id = uint32_t(SimulationConstantId::TEX_SIZE), .value = uint32_t(kTextureSize) },
+            { .id = uint32_t(SimulationConstantId::OCEAN_SIZE), .value = uint32_t(kGridSize) },
+        },
+    };
+    // Every workgroup shape of the kernels is compiled and timed, unless the fastest ones were cached by a previous run
+    WorkgroupTuner workgroupTuner = WorkgroupTuner(mDevice, simulationPipelineDesc, desc.workgroupPicks);
+    workgroupTuner.AddKernel("normal_map", GetWorkGroupVariants("normal_map.cs", kWorkGroupDims));
+    workgroupTuner.AddKernel("initial_spectrum", GetWorkGroupVariants("initial_spectrum.cs", kWorkGroupDims));
+    workgroupTuner.AddKernel("phase", GetWorkGroupVariants("phase.cs", kWorkGroupDims));
+    workgroupTuner.AddKernel("spectrum", GetWorkGroupVariants("spectrum.cs", kWorkGroupDims));
+    workgroupTuner.AddKernel("fft_horizontal", GetWorkGroupVariants("fft_horizontal.cs", kFFTWorkGroupSizes));
+    workgroupTuner.AddKernel("fft_vertical", GetWorkGroupVariants("fft_vertical.cs", kFFTWorkGroupSizes));
+    auto waveQueryPipelineFuture = mDevice.CreatePipelineAsync(simulationPipelineDesc, { "wave_query.cs.spv" });
+
+    // Set up ocean rendering
+    {
+        for (auto [lod, gridSize] : enumerate(kOceanTileLodGridSizes)) {
+            const Grid grid = MakeGrid(gridSize, (float)kGridSize);
+            mLodGridMeshes[lod] = MakeGridMesh(mDevice, grid);
+            if (lod == 0) mVertexCacheACMR = ComputeACMR(grid.indices);
+        }
+        const Grid rowMajorGrid = MakeGrid(kOceanTileLodGridSizes[0], (float)kGridSize, false);
+        mRowMajorGridMesh = MakeGridMesh(mDevice, rowMajorGrid);
+
+        LOG_INFO("Simulated ACMR with a {}-entry vertex cache: {:.3f} (row-major: {:.3f})",
+            kVertexCacheSize, mVertexCacheACMR, ComputeACMR(rowMajorGrid.indices));
+    }
+    mOceanPushConstantData = {
+        .sunDirection = GetSunDirection(desc.params),
+        .displacementScaleFactor = (float)kTextureSize / kGridSize,
+    };
+
+    mSpectrumTextureDesc = {
+        .dimensions = { kTextureSize, kTextureSize, 1u },
+        .format = Format::RGBA32_FLOAT,
+        .usage = TextureUsageBits::STORAGE | TextureUsageBits::SAMPLED,
+        .sampler = { .filter = Filter::TRILINEAR, .wrapMode = WrapMode::WRAP },
+    };
+    mNormalMapTextureDesc = {
+        .dimensions = { kTextureSize, kTextureSize, 1u },
+        .format = Format::RGBA32_FLOAT,
+        .usage = TextureUsageBits::SAMPLED | TextureUsageBits::STORAGE,
+        .sampler = { .filter = Filter::TRILINEAR, .wrapMode = WrapMode::WRAP },
+    };
+    // The ocean is rendered into the top-left corner of this texture at a fraction of the target resolution,
+    // then upscaled to the target. It's allocated at full size so rescaling is free; see RecordFrame.
+    mOceanColorTextureDesc = {
+        .format = desc.colorFormat,
+        .usage = TextureUsageBits::RENDER_TARGET | TextureUsageBits::SAMPLED,
+        .sampler = { .filter = Filter::BILINEAR, .wrapMode = WrapMode::CLAMP_TO_EDGE },
+    };
+
+    // Set up initial spectrum
+    mInitialSpectrumTexture = CreateHandle<Texture>(mDevice, TextureDesc{
+        .dimensions = { kTextureSize, kTextureSize, 1u },
+        .format = Format::R32_FLOAT,
+        .usage = TextureUsageBits::STORAGE | TextureUsageBits::SAMPLED,
+        .debugName = "Initial spectrum",
+        .category = MemoryCategory::SIMULATION,
+    });
+    mInitialSpectrumPushConstantData = {
+        .outInitialSpectrumIndex = mInitialSpectrumTexture->GetStorageIndex(),
+    };
+
+    // Set up phase
+    mPingPhaseTexture = CreateHandle<Texture>(mDevice, TextureDesc{
+        .dimensions = { kTextureSize, kTextureSize, 1u },
+        .format = Format::R32_FLOAT,
+        .sampler = { .filter = Filter::TRILINEAR, .wrapMode = WrapMode::CLAMP_TO_BORDER },
+        .usage = TextureUsageBits::STORAGE | TextureUsageBits::SAMPLED,
+        .debugName = "Ping phase",
+        .category = MemoryCategory::SIMULATION,
+    });
+    mPongPhaseTexture = CreateHandle<Texture>(mDevice, TextureDesc{
+        .dimensions = { kTextureSize, kTextureSize, 1u },
+        .format = Format::R32_FLOAT,
+        .usage = TextureUsageBits::STORAGE | TextureUsageBits::SAMPLED,
+        .debugName = "Pong phase",
+        .category = MemoryCategory::SIMULATION,
+    });
+
+    std::vector<float> pingPhaseArray(kTextureSize * kTextureSize);
+    std::random_device dev;
+    std::mt19937 rng(desc.phaseSeed != 0u ? desc.phaseSeed : dev());
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    for (int i = 0; i < pingPhaseArray.size(); ++i) pingPhaseArray[i] = 2.0f * M_PI * dist(rng);
+
+    Buffer pingPhaseArrayStagingBuffer = Buffer(
+        mDevice, {
+        .byteSize = pingPhaseArray.size() * sizeof(float),
+        .access = MemoryAccess::HOST,
+        .data = pingPhaseArray.data(),
+        .debugName = "Phase upload",
+        .category = MemoryCategory::STAGING,
+    });
+    {
+        auto cmdList = mDevice.CreateCommandList();
+        cmdList->Open();
+        cmdList->SetResourceState(*mPingPhaseTexture, ResourceStateBits::COPY_DEST);
+        cmdList->WriteTexture(mPingPhaseTexture.get(), pingPhaseArrayStagingBuffer);
+        cmdList->SetResourceState(*mPingPhaseTexture, ResourceStateBits::UNORDERED_ACCESS);
+        cmdList->Close();
+        mDevice.ExecuteCommandList(cmdList);
+    }
+    mInitialPhases = std::move(pingPhaseArray);
+
+    // Set up spectrum
+    mSpectrumPushConstantData = {
+        .choppiness = desc.params.choppiness,
+        .initialSpectrumIndex = mInitialSpectrumTexture->GetSampledIndex(),
+    };
+
+    // Join the pipelines before their first use
+    mBlitPipeline = blitPipelineFuture.get();
+    mOceanPipeline = oceanPipelineFuture.get();
+    mWaveQueries = CreateHandle<WaveQueries>(mDevice, waveQueryPipelineFuture.get(), (float)kGridSize);
+    LOG_INFO("Pipelines were ready after {:.1f} ms", startupTimer.Elapsed());
+
+    mWindDirection = GetWindDirection(desc.params);
+    this->TuneKernels(workgroupTuner);
+    mWorkgroupPicks = workgroupTuner.GetPicks();
+    LOG_INFO("Simulation kernels were ready after {:.1f} ms", startupTimer.Elapsed());
+}
+
+void OceanRenderer::TuneKernels(WorkgroupTuner& workgroupTuner)
+{
+    // Pick the fastest variant of every simulation kernel, timing a representative dispatch of each one.
+    // The transient simulation textures don't exist outside the render graph, so the kernels write to scratch textures.
+    Texture spectrumTexture = Texture(mDevice, mSpectrumTextureDesc);
+    Texture tempTexture = Texture(mDevice, mSpectrumTextureDesc);
+    Texture normalMapTexture = Texture(mDevice, mNormalMapTextureDesc);
+
+    mInitialSpectrumPushConstantData.windDirection = mWindDirection;
+    mInitialSpectrumKernel = workgroupTuner.Resolve("initial_spectrum", [&](CommandList& cmdList, const TunedKernel& kernel) {
+        cmdList.SetResourceState(*mInitialSpectrumTexture, ResourceStateBits::UNORDERED_ACCESS);
+        cmdList.SetComputeState({
+            .pipeline = kernel.pipeline,
+            .pushConstants = { .byteSize = sizeof(InitialSpectrumPushConstantData), .data = (void*)&mInitialSpectrumPushConstantData }
+        });
+        cmdList.Dispatch(kTextureSize / kernel.workGroupSize, kTextureSize / kernel.workGroupSize);
+    });
+    mPhaseKernel = workgroupTuner.Resolve("phase", [&](CommandList& cmdList, const TunedKernel& kernel) {
+        cmdList.SetResourceState(*mPingPhaseTexture, ResourceStateBits::SHADER_RESOURCE);
+        cmdList.SetResourceState(*mPongPhaseTexture, ResourceStateBits::UNORDERED_ACCESS);
+        mPhasePushConstantData.phaseIndex = mPingPhaseTexture->GetSampledIndex();
+        mPhasePushConstantData.outDeltaPhaseIndex = mPongPhaseTexture->GetStorageIndex();
+        cmdList.SetComputeState({
+            .pipeline = kernel.pipeline,
+            .pushConstants = { .byteSize = sizeof(PhasePushConstantData), .data = (void*)&mPhasePushConstantData }
+        });
+        cmdList.Dispatch(kTextureSize / kernel.workGroupSize, kTextureSize / kernel.workGroupSize);
+    });
+    mSpectrumKernel = workgroupTuner.Resolve("spectrum", [&](CommandList& cmdList, const TunedKernel& kernel) {
+        cmdList.SetResourceState(*mPongPhaseTexture, ResourceStateBits::SHADER_RESOURCE);
+        cmdList.SetResourceState(*mInitialSpectrumTexture, ResourceStateBits::SHADER_RESOURCE);
+        cmdList.SetResourceState(spectrumTexture, ResourceStateBits::UNORDERED_ACCESS);
+        mSpectrumPushConstantData.phaseIndex = mPongPhaseTexture->GetSampledIndex();
+        mSpectrumPushConstantData.outSpectrumIndex = spectrumTexture.GetStorageIndex();
+        cmdList.SetComputeState({
+            .pipeline = kernel.pipeline,
+            .pushConstants = { .byteSize = sizeof(SpectrumPushConstantData), .data = (void*)&mSpectrumPushConstantData }
+        });
+        cmdList.Dispatch(kTextureSize / kernel.workGroupSize, kTextureSize / kernel.workGroupSize);
+    });
+    // Each FFT pass dispatches a workgroup per row (or column), whatever its size
+    const auto recordFFTPass = [&](CommandList& cmdList, const TunedKernel& kernel) {
+        FFTPushConstantData pushConstantData = {
+            .subseqCount = 1,
+            .inputIndex = spectrumTexture.GetSampledIndex(),
+            .outputIndex = tempTexture.GetStorageIndex(),
+        };
+        cmdList.SetResourceState(spectrumTexture, ResourceStateBits::SHADER_RESOURCE);
+        cmdList.SetResourceState(tempTexture, ResourceStateBits::UNORDERED_ACCESS);
+        cmdList.SetComputeState({
+            .pipeline = kernel.pipeline,
+            .pushConstants = { .byteSize = sizeof(FFTPushConstantData), .data = (void*)&pushConstantData }
+        });
+        cmdList.Dispatch(kTextureSize);
+    };
+    mFFTHorizontalKernel = workgroupTuner.Resolve("fft_horizontal", recordFFTPass);
+    mFFTVerticalKernel = workgroupTuner.Resolve("fft_vertical", recordFFTPass);
+    mNormalMapKernel = workgroupTuner.Resolve("normal_map", [&](CommandList& cmdList, const TunedKernel& kernel) {
+        const NormalMapPushConstantData pushConstantData = {
+            .displacementMapIndex = spectrumTexture.GetSampledIndex(),
+            .outNormalMapIndex = normalMapTexture.GetStorageIndex(),
+        };
+        cmdList.SetResourceState(spectrumTexture, ResourceStateBits::SHADER_RESOURCE);
+        cmdList.SetResourceState(normalMapTexture, ResourceStateBits::UNORDERED_ACCESS);
+        cmdList.SetComputeState({
+            .pipeline = kernel.pipeline,
+            .pushConstants = { .byteSize = sizeof(NormalMapPushConstantData), .data = (void*)&pushConstantData }
+        });
+        cmdList.Dispatch(kTextureSize / kernel.workGroupSize, kTextureSize / kernel.workGroupSize);
+    });
+    workgroupTuner.Save();
+}
+
+std::map<std::string, uint32_t> OceanRenderer::GetWorkGroupSizes() const
+{
+    return {
+        { "initial_spectrum", mInitialSpectrumKernel.workGroupSize },
+        { "phase", mPhaseKernel.workGroupSize },
+        { "spectrum", mSpectrumKernel.workGroupSize },
+        { "fft_horizontal", mFFTHorizontalKernel.workGroupSize },
+        { "fft_vertical", mFFTVerticalKernel.workGroupSize },
+        { "normal_map", mNormalMapKernel.workGroupSize },
+    };
+}
+
+void OceanRenderer::UpdateStats(uint32_t frameIndex, GUIStats& stats)
+{
+    stats.vertexCacheACMR = mVertexCacheACMR;
+    std::array<uint64_t, size_t(PipelineStatistic::COUNT)> statistics;
+    if (mIsStatisticsQueryPending[frameIndex] && mStatisticsQueryPool.GetResults(frameIndex, 1, statistics.data())) {
+        stats.vertexShaderInvocations = statistics[size_t(PipelineStatistic::VERTEX_SHADER_INVOCATIONS)];
+        stats.fragmentShaderInvocations = statistics[size_t(PipelineStatistic::FRAGMENT_SHADER_INVOCATIONS)];
+    }
+}
+
+WaveEvaluator OceanRenderer::CreateWaveEvaluator(const GUIParams& params, const WaveEvaluatorDesc& desc) const
+{
+    return WaveEvaluator(WaveSpectrumDesc{
+        .textureSize = kTextureSize,
+        .oceanSize = (float)kGridSize,
+        .tileSize = (float)kGridSize,
+        .initialPhases = mInitialPhases,
+        .windDirection = GetWindDirection(params),
+        .choppiness = params.choppiness,
+        .displacementScaleFactor = params.displacementScaleFactor,
+    }, desc);
+}
+
+void OceanRenderer::RecordFrame(CommandList& cmdList, const OceanFrameDesc& frame, GpuProfiler* profiler)
+{
+    PROFILE_ZONE("OceanRenderer::RecordFrame");
+    assert(frame.colorTarget != nullptr && frame.depthTarget != nullptr);
+    const GUIParams& params = frame.params;
+    mWaveQueries->BeginFrame();
+    mSimulatedTime += frame.dt;
+
+    // Generate initial spectrum, whenever the wind changes
+    const glm::vec2 windDirection = GetWindDirection(params);
+    if (mShouldUpdateInitialSpectrum || windDirection != mWindDirection) {
+        if (profiler) profiler->BeginScope(cmdList, "initial_spectrum");
+        mInitialSpectrumPushConstantData.windDirection = windDirection;
+        cmdList.SetResourceState(*mInitialSpectrumTexture, ResourceStateBits::UNORDERED_ACCESS);
+        cmdList.SetComputeState({
+            .pipeline = mInitialSpectrumKernel.pipeline,
+            .pushConstants = { .byteSize = sizeof(InitialSpectrumPushConstantData), .data = (void*)&mInitialSpectrumPushConstantData }
+        });
+        cmdList.Dispatch(kTextureSize / mInitialSpectrumKernel.workGroupSize, kTextureSize / mInitialSpectrumKernel.workGroupSize);
+        if (profiler) profiler->EndScope(cmdList);
+
+        mWindDirection = windDirection;
+        mShouldUpdateInitialSpectrum = false;
+    }
+
+    RenderGraph& renderGraph = mRenderGraph;
+    renderGraph.Reset();
+    const RenderGraphTexture phase = renderGraph.ImportTexture("phase", mIsPingPhase ? *mPingPhaseTexture : *mPongPhaseTexture);
+    const RenderGraphTexture outPhase = renderGraph.ImportTexture("out_phase", mIsPingPhase ? *mPongPhaseTexture : *mPingPhaseTexture);
+    const RenderGraphTexture initialSpectrum = renderGraph.ImportTexture("initial_spectrum", *mInitialSpectrumTexture);
+    const RenderGraphTexture depth = renderGraph.ImportTexture("depth", *frame.depthTarget);
+    const RenderGraphTexture target = renderGraph.ImportTexture("target", *frame.colorTarget);
+    const RenderGraphTexture spectrum = renderGraph.CreateTexture("spectrum", mSpectrumTextureDesc);
+    const RenderGraphTexture temp = renderGraph.CreateTexture("fft_temp", mSpectrumTextureDesc);
+    const RenderGraphTexture normalMap = renderGraph.CreateTexture("normal_map", mNormalMapTextureDesc);
+    const Viewport targetViewport = Viewport(float(frame.colorTarget->GetWidth()), float(frame.colorTarget->GetHeight()));
+    TextureDesc oceanColorTextureDesc = mOceanColorTextureDesc;
+    oceanColorTextureDesc.dimensions = { frame.colorTarget->GetWidth(), frame.colorTarget->GetHeight(), 1u };
+    const RenderGraphTexture oceanColor = renderGraph.CreateTexture("ocean_color", oceanColorTextureDesc);
+
+    // Generate phase
+    renderGraph.AddPass("phase", RenderGraphQueue::COMPUTE, {
+        { .texture = phase, .state = ResourceStateBits::SHADER_RESOURCE },
+        { .texture = outPhase, .state = ResourceStateBits::UNORDERED_ACCESS },
+    }, [&](CommandList& cmdList) {
+        mPhasePushConstantData.dt = frame.dt;
+        mPhasePushConstantData.phaseIndex = renderGraph.GetTexture(phase).GetSampledIndex();
+        mPhasePushConstantData.outDeltaPhaseIndex = renderGraph.GetTexture(outPhase).GetStorageIndex();
+        cmdList.SetComputeState({
+            .pipeline = mPhaseKernel.pipeline,
+            .pushConstants = { .byteSize = sizeof(PhasePushConstantData), .data = (void*)&mPhasePushConstantData }
+        });
+        cmdList.Dispatch(kTextureSize / mPhaseKernel.workGroupSize, kTextureSize / mPhaseKernel.workGroupSize);
+    });
+
+    // Generate spectrum
+    renderGraph.AddPass("spectrum", RenderGraphQueue::COMPUTE, {
+        { .texture = outPhase, .state = ResourceStateBits::SHADER_RESOURCE },
+        { .texture = initialSpectrum, .state = ResourceStateBits::SHADER_RESOURCE },
+        { .texture = spectrum, .state = ResourceStateBits::UNORDERED_ACCESS },
+    }, [&](CommandList& cmdList) {
+        mSpectrumPushConstantData.choppiness = params.choppiness;
+        mSpectrumPushConstantData.phaseIndex = renderGraph.GetTexture(outPhase).GetSampledIndex();
+        mSpectrumPushConstantData.outSpectrumIndex = renderGraph.GetTexture(spectrum).GetStorageIndex();
+        cmdList.SetComputeState({
+            .pipeline = mSpectrumKernel.pipeline,
+            .pushConstants = { .byteSize = sizeof(SpectrumPushConstantData), .data = (void*)&mSpectrumPushConstantData }
+        });
+        cmdList.Dispatch(kTextureSize / mSpectrumKernel.workGroupSize, kTextureSize / mSpectrumKernel.workGroupSize);
+    });
+
+    // FFT, horizontal then vertical steps, ping-ponging between the spectrum and a temporary texture
+    RenderGraphTexture fftInput = spectrum;
+    RenderGraphTexture fftOutput = temp;
+    for (const TunedKernel* fftKernel : { &mFFTHorizontalKernel, &mFFTVerticalKernel }) {
+        for (int p = 1; p < kTextureSize; p <<= 1) {
+            renderGraph.AddPass(fftKernel == &mFFTHorizontalKernel ? "fft_horizontal" : "fft_vertical", RenderGraphQueue::COMPUTE, {
+                { .texture = fftInput, .state = ResourceStateBits::SHADER_RESOURCE },
+                { .texture = fftOutput, .state = ResourceStateBits::UNORDERED_ACCESS },
+            }, [&renderGraph, fftKernel, p, fftInput, fftOutput](CommandList& cmdList) {
+                const FFTPushConstantData fftPushConstantData = {
+                    .subseqCount = p,
+                    .inputIndex = renderGraph.GetTexture(fftInput).GetSampledIndex(),
+                    .outputIndex = renderGraph.GetTexture(fftOutput).GetStorageIndex(),
+                };
+                cmdList.SetComputeState({
+                    .pipeline = fftKernel->pipeline,
+                    .pushConstants = { .byteSize = sizeof(FFTPushConstantData), .data = (void*)&fftPushConstantData }
+                });
+                cmdList.Dispatch(kTextureSize);
+            });
+            std::swap(fftInput, fftOutput);
+        }
+    }
+    const RenderGraphTexture displacementMap = fftInput;
+
+    // Generate normal map
+    renderGraph.AddPass("normal_map", RenderGraphQueue::COMPUTE, {
+        { .texture = displacementMap, .state = ResourceStateBits::SHADER_RESOURCE },
+        { .texture = normalMap, .state = ResourceStateBits::UNORDERED_ACCESS },
+    }, [&](CommandList& cmdList) {
+        const NormalMapPushConstantData normalMapPushConstantData = {
+            .displacementMapIndex = renderGraph.GetTexture(displacementMap).GetSampledIndex(),
+            .outNormalMapIndex = renderGraph.GetTexture(normalMap).GetStorageIndex(),
+        };
+        cmdList.SetComputeState({
+            .pipeline = mNormalMapKernel.pipeline,
+            .pushConstants = { .byteSize = sizeof(NormalMapPushConstantData), .data = (void*)&normalMapPushConstantData }
+        });
+        cmdList.Dispatch(kTextureSize / mNormalMapKernel.workGroupSize, kTextureSize / mNormalMapKernel.workGroupSize);
+    });
+
+    // Answer the wave queries of the frame; their results are read back kMaxFramesInFlightCount frames later
+    if (mWaveQueries->HasPendingQueries()) {
+        renderGraph.AddPass("wave_query", RenderGraphQueue::COMPUTE, {
+            { .texture = displacementMap, .state = ResourceStateBits::SHADER_RESOURCE },
+            { .texture = normalMap, .state = ResourceStateBits::SHADER_RESOURCE },
+        }, [&](CommandList& cmdList) {
+            mWaveQueries->Record(cmdList, frame.frameIndex, renderGraph.GetTexture(displacementMap),
+                renderGraph.GetTexture(normalMap), params.displacementScaleFactor);
+        }, true);
+    }
+
+    // Ocean shading
+    mOceanPushConstantData.cameraPosition = frame.cameraPosition;
+    mOceanPushConstantData.worldToClip = frame.worldToClip;
+    mOceanPushConstantData.sunDirection = GetSunDirection(params);
+    mOceanPushConstantData.displacementScaleFactor = params.displacementScaleFactor;
+    mOceanPushConstantData.tipScaleFactor = params.tipScaleFactor;
+    mOceanPushConstantData.exposure = params.exposure;
+
+    const uint32_t renderWidth = std::max(1u, uint32_t(targetViewport.width() * frame.renderScale));
+    const uint32_t renderHeight = std::max(1u, uint32_t(targetViewport.height() * frame.renderScale));
+
+    // Draw the tiles around the camera, one instanced draw per level of detail
+    mOceanTiles.Update(frame.cameraPosition, params.isOceanUnbounded, params.shouldSortTilesFrontToBack, frame.frameIndex);
+    renderGraph.AddPass("ocean", RenderGraphQueue::GRAPHICS, {
+        { .texture = displacementMap, .state = ResourceStateBits::SHADER_RESOURCE },
+        { .texture = normalMap, .state = ResourceStateBits::SHADER_RESOURCE },
+        { .texture = oceanColor, .state = ResourceStateBits::RENDER_TARGET },
+        { .texture = depth, .state = ResourceStateBits::DEPTH_WRITE },
+    }, [&](CommandList& cmdList) {
+        cmdList.ResetQueries(mStatisticsQueryPool, frame.frameIndex, 1);
+        cmdList.BeginQuery(mStatisticsQueryPool, frame.frameIndex);
+        for (auto [drawIdx, draw] : enumerate(mOceanTiles.GetDraws())) {
+            const bool shouldUseRowMajorMesh = draw.lod == 0 && !params.shouldUseOptimizedIndexOrder;
+            const GridMesh& mesh = shouldUseRowMajorMesh ? mRowMajorGridMesh : mLodGridMeshes[draw.lod];
+            cmdList.SetGraphicsState({
+                .pipeline = mOceanPipeline,
+                .fillMode = params.isInWireframeMode ? RasterFillMode::WIREFRAME : RasterFillMode::SOLID,
+                .viewport = Viewport(float(renderWidth), float(renderHeight)),
+                .colorAttachments = {{
+                    .texture = &renderGraph.GetTexture(oceanColor),
+                    .loadOp = drawIdx == 0 ? LoadOp::CLEAR : LoadOp::LOAD,
+                    .clearColor = glm::vec4(0.674f, 0.966f, 0.988f, 1.f)
+                }},
+                .depthStencilAttachment = {
+                    .texture = &renderGraph.GetTexture(depth),
+                    .loadOp = drawIdx == 0 ? LoadOp::CLEAR : LoadOp::LOAD,
+                },
+                .bindings = { Binding(renderGraph.GetTexture(displacementMap)), Binding(renderGraph.GetTexture(normalMap)) },
+                .vertexBuffer = mesh.vertexBuffer,
+                .instanceBuffer = mOceanTiles.GetInstanceBuffer(frame.frameIndex),
+                .indexBuffer = {.buffer = mesh.indexBuffer, .format = Format::R32_UINT },
+                .pushConstants = { .byteSize = sizeof(OceanPushConstantData), .data = (void*)&mOceanPushConstantData },
+            });
+            cmdList.DrawIndexed({
+                .vertexCount = mesh.indexCount,
+                .instanceCount = draw.instanceCount,
+                .startInstanceLocation = draw.firstInstance,
+            });
+        }
+        cmdList.EndQuery(mStatisticsQueryPool, frame.frameIndex);
+    });
+    mIsStatisticsQueryPending[frame.frameIndex] = true;
+
+    // Upscale the ocean to the target resolution; the overlay is drawn on top at native resolution
+    renderGraph.AddPass("blit", RenderGraphQueue::GRAPHICS, {
+        { .texture = oceanColor, .state = ResourceStateBits::SHADER_RESOURCE },
+        { .texture = target, .state = ResourceStateBits::RENDER_TARGET },
+    }, [&](CommandList& cmdList) {
+        const Texture& oceanColorTexture = renderGraph.GetTexture(oceanColor);
+        const glm::vec2 uvScale = glm::vec2(renderWidth, renderHeight) / glm::vec2(oceanColorTexture.GetWidth(), oceanColorTexture.GetHeight());
+        const BlitPushConstantData blitPushConstantData = {
+            .uvScale = uvScale,
+            .maxUv = uvScale - 0.5f / glm::vec2(oceanColorTexture.GetWidth(), oceanColorTexture.GetHeight()),
+        };
+        cmdList.SetGraphicsState({
+            .pipeline = mBlitPipeline,
+            .viewport = targetViewport,
+            .colorAttachments = {{ .texture = frame.colorTarget, .loadOp = LoadOp::DONT_CARE }},
+            .bindings = { Binding(oceanColorTexture) },
+            .pushConstants = { .byteSize = sizeof(BlitPushConstantData), .data = (void*)&blitPushConstantData },
+        });
+        cmdList.Draw({ .vertexCount = 4 });
+    });
+
+    if (frame.drawOverlay) {
+        renderGraph.AddPass("gui", RenderGraphQueue::GRAPHICS, {
+            { .texture = target, .state = ResourceStateBits::RENDER_TARGET },
+        }, frame.drawOverlay);
+    }
+
+    renderGraph.Compile();
+    renderGraph.Execute(cmdList, profiler);
+
+    mIsPingPhase = !mIsPingPhase;
+}
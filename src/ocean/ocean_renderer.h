@@ -0,0 +1,106 @@
+#pragma once
+
+#include "gui.h"
+#include "render_graph.h"
+#include "workgroup_tuner.h"
+
+#include "vk/query_pool.h"
+#include "vk/frame_pacing.h"
+
+#include "ocean/grid.h"
+#include "ocean/ocean.h"
+#include "ocean/tiles.h"
+#include "ocean/wave_queries.h"
+#include "ocean/wave_evaluator.h"
+
+#include <map>
+
+struct OceanRendererDesc {
+    Format colorFormat = Format::NONE;       // Format of the targets the frames are rendered into.
+    Format depthFormat = Format::NONE;       // Format of the depth target.
+    GUIParams params = {};                   // Parameters the simulation kernels are tuned with.
+    uint32_t phaseSeed = 0u;                 // Seed of the initial wave phases; 0 picks a random one.
+    const WorkgroupPicks* workgroupPicks = nullptr; // [Optional] Variants of the simulation kernels to use instead of tuning them.
+};
+
+struct OceanFrameDesc {
+    uint32_t frameIndex = 0u;                // Index of the frame in flight.
+    float dt = 0.0f;                         // Simulated time since the previous frame, in seconds.
+    float renderScale = 1.0f;                // Fraction of the target resolution the ocean is rendered at.
+    glm::mat4 worldToClip = glm::mat4(1.0f);
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    GUIParams params = {};
+    Texture* colorTarget = nullptr;          // Left in the RENDER_TARGET state; the ocean is rendered at a fraction of its size.
+    Texture* depthTarget = nullptr;          // Must stay in the DEPTH_WRITE state.
+    RenderGraph::ExecuteFn drawOverlay;      // [Optional] Drawn on top of the upscaled ocean at full resolution, e.g. the GUI.
+};
+
+class Device;
+class Pipeline;
+class CommandList;
+class GpuProfiler;
+// Simulates the ocean and renders it into a target, independently of where that target is presented.
+// The whole frame, from the phase update to the overlay, is a render graph recorded into one command list.
+class OceanRenderer {
+public:
+    // Compiles the pipelines and picks the workgroup sizes of the simulation kernels; returns once they're ready
+    OceanRenderer(const Device& device, const OceanRendererDesc& desc);
+
+    void RecordFrame(CommandList& cmdList, const OceanFrameDesc& frame, GpuProfiler* profiler = nullptr);
+    // Reads back the statistics of the frame last recorded with `frameIndex`, which must have finished executing
+    void UpdateStats(uint32_t frameIndex, GUIStats& stats);
+
+    const RenderGraph& GetRenderGraph() const { return mRenderGraph; }
+    // Queries added before RecordFrame are answered from the displacement field of that frame
+    WaveQueries& GetWaveQueries() { return *mWaveQueries; }
+    // Evaluates the waves of the simulation on the CPU, for the wind, choppiness and displacement scale of `params`
+    WaveEvaluator CreateWaveEvaluator(const GUIParams& params, const WaveEvaluatorDesc& desc = {}) const;
+    // Time the displacement field of the last recorded frame was simulated at, in seconds
+    double GetSimulatedTime() const { return mSimulatedTime; }
+    // Variants the simulation kernels use, e.g. to pin them in another renderer
+    const WorkgroupPicks& GetWorkgroupPicks() const { return mWorkgroupPicks; }
+    // Workgroup size of every simulation kernel, by kernel name
+    std::map<std::string, uint32_t> GetWorkGroupSizes() const;
+
+private:
+    void TuneKernels(WorkgroupTuner& workgroupTuner);
+
+    const Device& mDevice;
+    Handle<Pipeline> mBlitPipeline;
+    Handle<Pipeline> mOceanPipeline;
+    Handle<WaveQueries> mWaveQueries;
+    TunedKernel mInitialSpectrumKernel, mPhaseKernel, mSpectrumKernel, mFFTHorizontalKernel, mFFTVerticalKernel, mNormalMapKernel;
+    WorkgroupPicks mWorkgroupPicks;
+
+    // Transient textures, see the render graph
+    TextureDesc mSpectrumTextureDesc;
+    TextureDesc mNormalMapTextureDesc;
+    TextureDesc mOceanColorTextureDesc;
+    // Store phases separately to ensure continuity of waves during parameter editing
+    Handle<Texture> mInitialSpectrumTexture;
+    Handle<Texture> mPingPhaseTexture;
+    Handle<Texture> mPongPhaseTexture;
+    bool mIsPingPhase = true;
+    std::vector<float> mInitialPhases; // Kept for the CPU wave evaluator
+    double mSimulatedTime = 0.0;
+    bool mShouldUpdateInitialSpectrum = true;
+    glm::vec2 mWindDirection = glm::vec2(0.0f); // Of the current initial spectrum
+
+    // Every level of detail spans a whole tile, so all tiles sample the simulation textures identically
+    std::array<GridMesh, kOceanTileLodCount> mLodGridMeshes;
+    // Row-major layout of the finest level, to compare the vertex shader invocations against
+    GridMesh mRowMajorGridMesh;
+    float mVertexCacheACMR = 0.0f;
+    OceanTiles mOceanTiles;
+
+    // Pipeline statistics of the ocean draw, one query per frame in flight
+    QueryPool mStatisticsQueryPool;
+    std::array<bool, kMaxFramesInFlightCount> mIsStatisticsQueryPending = {};
+
+    InitialSpectrumPushConstantData mInitialSpectrumPushConstantData = {};
+    PhasePushConstantData mPhasePushConstantData = {};
+    SpectrumPushConstantData mSpectrumPushConstantData = {};
+    OceanPushConstantData mOceanPushConstantData = {};
+
+    RenderGraph mRenderGraph;
+};
@@ -0,0 +1,61 @@
+#include "ocean/tiles.h"
+
+#include "vk/device.h"
+#include "vk/buffer.h"
+
+constexpr uint32_t kMaxOceanTileCount = (2 * kOceanTileRingCount + 1) * (2 * kOceanTileRingCount + 1);
+
+OceanTiles::OceanTiles(const Device& device, float tileSize)
+    : mTileSize(tileSize)
+{
+    for (auto& instanceBuffer : mInstanceBuffers) {
+        instanceBuffer = CreateHandle<Buffer>(device, BufferDesc{
+            .byteSize = kMaxOceanTileCount * sizeof(OceanTileInstance),
+            .access = MemoryAccess::HOST,
+            .usage = BufferUsageBits::VERTEX,
+            .debugName = "Ocean tile instances",
+            .category = MemoryCategory::MESH,
+        });
+    }
+}
+
+void OceanTiles::Update(glm::vec3 cameraPosition, bool isUnbounded, bool shouldSortFrontToBack, uint32_t frameIndex)
+{
+    const int32_t ringCount = isUnbounded ? kOceanTileRingCount : 0;
+    // Tiles are centered on multiples of the tile size, so find the one the camera is above
+    const glm::ivec2 cameraTile = isUnbounded
+        ? glm::ivec2(glm::floor(glm::vec2(cameraPosition.x, cameraPosition.z) / mTileSize + 0.5f))
+        : glm::ivec2(0);
+
+    // Group the tiles by level of detail so every level is a single instanced draw
+    std::array<std::vector<OceanTileInstance>, kOceanTileLodCount> lodInstances;
+    for (int32_t z = -ringCount; z <= ringCount; ++z) {
+        for (int32_t x = -ringCount; x <= ringCount; ++x) {
+            const uint32_t ring = std::max(std::abs(x), std::abs(z));
+            const uint32_t lod = std::min(ring, kOceanTileLodCount - 1);
+            lodInstances[lod].push_back({ .offset = glm::vec2(cameraTile + glm::ivec2(x, z)) * mTileSize });
+        }
+    }
+
+    // Finer levels are always closer to the camera, so sorting within each level orders all tiles
+    const glm::vec2 cameraPositionXZ = glm::vec2(cameraPosition.x, cameraPosition.z);
+    const auto isCloser = [&](const OceanTileInstance& a, const OceanTileInstance& b) {
+        const float distanceA = glm::dot(a.offset - cameraPositionXZ, a.offset - cameraPositionXZ);
+        const float distanceB = glm::dot(b.offset - cameraPositionXZ, b.offset - cameraPositionXZ);
+        return shouldSortFrontToBack ? distanceA < distanceB : distanceA > distanceB;
+    };
+    for (auto& tiles : lodInstances) std::sort(tiles.begin(), tiles.end(), isCloser);
+    if (!shouldSortFrontToBack) std::reverse(lodInstances.begin(), lodInstances.end());
+
+    mDraws.clear();
+    auto* instances = (OceanTileInstance*)mInstanceBuffers[frameIndex]->GetMappedData();
+    uint32_t instanceCount = 0u;
+    for (auto [idx, tiles] : enumerate(lodInstances)) {
+        if (tiles.empty()) continue;
+        const uint32_t lod = shouldSortFrontToBack ? uint32_t(idx) : kOceanTileLodCount - 1 - uint32_t(idx);
+        mDraws.push_back({ .lod = lod, .firstInstance = instanceCount, .instanceCount = uint32_t(tiles.size()) });
+        memcpy(instances + instanceCount, tiles.data(), tiles.size() * sizeof(OceanTileInstance));
+        instanceCount += tiles.size();
+    }
+    assert(instanceCount <= kMaxOceanTileCount);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "vk/frame_pacing.h"
+
+// Number of rings of tiles drawn around the tile containing the camera
+constexpr int32_t kOceanTileRingCount = 4;
+// Grid size of the tile mesh of every level of detail; ring `r` is drawn with LOD min(r, kOceanTileLodCount - 1).
+// NOTE: Coarser grids are subsets of the finer ones, but their edges can still open small cracks under displacement.
+constexpr std::array<int32_t, 3> kOceanTileLodGridSizes = { 1024, 256, 64 };
+constexpr uint32_t kOceanTileLodCount = kOceanTileLodGridSizes.size();
+
+struct OceanTileInstance {
+    glm::vec2 offset; // World-space XZ offset of the tile
+};
+
+// One instanced draw of all the tiles sharing a level of detail
+struct OceanTileDraw {
+    uint32_t lod = 0u;
+    uint32_t firstInstance = 0u;
+    uint32_t instanceCount = 0u;
+};
+
+class Device;
+class Buffer;
+class OceanTiles {
+public:
+    // NOTE: `tileSize` must be a multiple of the period of the simulation textures to tile seamlessly
+    OceanTiles(const Device& device, float tileSize);
+
+    // Places the tiles around the camera and writes their offsets into the instance buffer of the frame.
+    // If the ocean isn't unbounded, only a single tile is placed at the origin.
+    // Tiles and draws are ordered front to back so early depth testing rejects hidden fragments;
+    // `shouldSortFrontToBack` = false orders them back to front instead, the worst case for overdraw.
+    void Update(glm::vec3 cameraPosition, bool isUnbounded, bool shouldSortFrontToBack, uint32_t frameIndex);
+
+    Handle<Buffer> GetInstanceBuffer(uint32_t frameIndex) const { return mInstanceBuffers[frameIndex]; }
+    const std::vector<OceanTileDraw>& GetDraws() const { return mDraws; }
+
+private:
+    float mTileSize;
+    std::array<Handle<Buffer>, kMaxFramesInFlightCount> mInstanceBuffers;
+    std::vector<OceanTileDraw> mDraws;
+};
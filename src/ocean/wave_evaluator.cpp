@@ -0,0 +1,309 @@
+#include "ocean/wave_evaluator.h"
+
+#include <cmath>
+#include <numeric>
+
+#include "logger.h"
+#include "thread_pool.h"
+#include "cpu_profiler.h"
+
+#include "ocean/grid.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define WAVE_EVALUATOR_SSE2 1
+#endif
+
+// Points evaluated by every task of the thread pool; large enough that submitting them is negligible
+constexpr size_t kPointsPerTask = 16u * 1024u;
+
+// Constants of the spectrum and dispersion, as in shaders/initial_spectrum.cs.hlsl
+constexpr float kGravity = 9.81f;
+constexpr float kKM = 370.0f;
+constexpr float kCM = 0.23f;
+
+static float Square(float x)
+{
+    return x * x;
+}
+
+static float Omega(float k)
+{
+    return std::sqrt(kGravity * k * (1.0f + Square(k) / Square(kKM)));
+}
+
+// Amplitude of the wave vector in the initial spectrum; must match shaders/initial_spectrum.cs.hlsl
+static float ComputeInitialSpectrum(glm::vec2 waveVector, glm::vec2 windDirection, float oceanSize)
+{
+    const float k = glm::length(waveVector);
+    if (k == 0.0f) return 0.0f;
+    const float U10 = glm::length(windDirection);
+
+    const float inverseWaveAge = 0.84f;
+    const float kp = kGravity * Square(inverseWaveAge / U10);
+
+    const float c = Omega(k) / k;
+    const float cp = Omega(kp) / kp;
+
+    const float Lpm = std::exp(-1.25f * Square(kp / k));
+    const float gamma = 1.7f;
+    const float sigma = 0.08f * (1.0f + 4.0f * std::pow(inverseWaveAge, -3.0f));
+    const float Gamma = std::exp(-Square(std::sqrt(k / kp) - 1.0f) / (2.0f * Square(sigma)));
+    const float Jp = std::pow(gamma, Gamma);
+    const float Fp = Lpm * Jp * std::exp(-inverseWaveAge / std::sqrt(10.0f) * (std::sqrt(k / kp) - 1.0f));
+    const float alphap = 0.006f * std::sqrt(inverseWaveAge);
+    const float Bl = 0.5f * alphap * cp / c * Fp;
+
+    const float z0 = 0.000037f * Square(U10) / kGravity * std::pow(U10 / cp, 0.9f);
+    const float uStar = 0.41f * U10 / std::log(10.0f / z0);
+    const float alpham = 0.01f * ((uStar < kCM) ? (1.0f + std::log(uStar / kCM)) : (1.0f + 3.0f * std::log(uStar / kCM)));
+    const float Fm = std::exp(-0.25f * Square(k / kKM - 1.0f));
+    const float Bh = 0.5f * alpham * kCM / c * Fm * Lpm;
+
+    const float a0 = std::log(2.0f) / 4.0f;
+    const float am = 0.13f * uStar / kCM;
+    const float Delta = std::tanh(a0 + 4.0f * std::pow(c / cp, 2.5f) + am * std::pow(kCM / c, 2.5f));
+
+    const float cosPhi = glm::dot(glm::normalize(windDirection), glm::normalize(waveVector));
+
+    const float S = (1.0f / (2.0f * float(M_PI))) * std::pow(k, -4.0f) * (Bl + Bh) * (1.0f + Delta * (2.0f * cosPhi * cosPhi - 1.0f));
+
+    const float dk = 2.0f * float(M_PI) / oceanSize;
+    return std::sqrt(S / 2.0f) * dk;
+}
+
+// The evaluation is written once for a lane type F, which is either a float or four floats in an SSE register
+static void SinCos(float x, float& outSin, float& outCos)
+{
+    outSin = std::sin(x);
+    outCos = std::cos(x);
+}
+
+// Brings `x` into [-period / 2, period / 2], where the phases of all waves are small enough to keep their precision
+static float WrapPeriod(float x, float period)
+{
+    return x - std::nearbyint(x / period) * period;
+}
+
+#if WAVE_EVALUATOR_SSE2
+struct Float4 {
+    __m128 v;
+    Float4(__m128 v) : v(v) {}
+    Float4(float s) : v(_mm_set1_ps(s)) {}
+};
+static inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+static inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+static inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+
+// Reduces x to r in [-pi/4, pi/4] around the nearest multiple j of pi/2, evaluates the sine and cosine of r with the
+// minimax polynomials of Cephes, then swaps and negates them by the quadrant of j. Accurate to a few ulps.
+static inline void SinCos(Float4 x, Float4& outSin, Float4& outCos)
+{
+    const __m128i j = _mm_cvtps_epi32(_mm_mul_ps(x.v, _mm_set1_ps(float(M_2_PI))));
+    const Float4 jf = _mm_cvtepi32_ps(j);
+    // pi/2 split into three parts (Cody-Waite), so the reduction stays exact for large x
+    const Float4 r = x - jf * 1.5703125f - jf * 4.837512969970703125e-4f - jf * 7.54978995489188216e-8f;
+    const Float4 r2 = r * r;
+    const Float4 s = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+    const Float4 c = Float4(1.0f) - r2 * 0.5f + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+
+    const __m128 isSwapped = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    const __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), 30));
+    const __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+    outSin = _mm_xor_ps(_mm_or_ps(_mm_and_ps(isSwapped, c.v), _mm_andnot_ps(isSwapped, s.v)), sinSign);
+    outCos = _mm_xor_ps(_mm_or_ps(_mm_and_ps(isSwapped, s.v), _mm_andnot_ps(isSwapped, c.v)), cosSign);
+}
+
+static inline Float4 WrapPeriod(Float4 x, float period)
+{
+    const Float4 periodCount = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x.v, _mm_set1_ps(1.0f / period))));
+    return x - periodCount * period;
+}
+#endif
+
+struct WaveArrays {
+    const float* phases;
+    const float* waveVectorsX;
+    const float* waveVectorsZ;
+    const float* amplitudesX;
+    const float* amplitudesY;
+    const float* amplitudesZ;
+    uint32_t count;
+};
+
+template<typename F>
+static void EvaluateDisplacement(const WaveArrays& waves, F x, F z, F& outX, F& outY, F& outZ)
+{
+    F dx = 0.0f, dy = 0.0f, dz = 0.0f;
+    for (uint32_t waveIdx = 0; waveIdx < waves.count; ++waveIdx) {
+        F sinPsi = 0.0f, cosPsi = 0.0f;
+        SinCos(F(waves.phases[waveIdx]) + F(waves.waveVectorsX[waveIdx]) * x + F(waves.waveVectorsZ[waveIdx]) * z, sinPsi, cosPsi);
+        dx = dx + F(waves.amplitudesX[waveIdx]) * sinPsi;
+        dy = dy + F(waves.amplitudesY[waveIdx]) * cosPsi;
+        dz = dz + F(waves.amplitudesZ[waveIdx]) * sinPsi;
+    }
+    outX = dx;
+    outY = dy;
+    outZ = dz;
+}
+
+// Finds the grid point that's displaced onto (x, z) by fixed-point iteration, then returns its height
+template<typename F>
+static F EvaluateHeight(const WaveArrays& waves, uint32_t inversionIterationCount, F x, F z)
+{
+    F gridX = x, gridZ = z;
+    F dx = 0.0f, dy = 0.0f, dz = 0.0f;
+    for (uint32_t iteration = 0; iteration < inversionIterationCount; ++iteration) {
+        EvaluateDisplacement(waves, gridX, gridZ, dx, dy, dz);
+        gridX = x - dx;
+        gridZ = z - dz;
+    }
+    EvaluateDisplacement(waves, gridX, gridZ, dx, dy, dz);
+    return dy;
+}
+
+WaveEvaluator::WaveEvaluator(const WaveSpectrumDesc& spectrum, const WaveEvaluatorDesc& desc)
+    : mInversionIterationCount(desc.inversionIterationCount)
+    , mPeriod(spectrum.tileSize / kGridUvScale)
+{
+    PROFILE_ZONE("WaveEvaluator::WaveEvaluator");
+    const int32_t n = int32_t(spectrum.textureSize);
+    assert(spectrum.initialPhases.size() == size_t(n) * n);
+    std::vector<float> initialSpectrum(size_t(n) * n);
+    for (int32_t y = 0; y < n; ++y) {
+        for (int32_t x = 0; x < n; ++x) {
+            const glm::vec2 waveVector = 2.0f * float(M_PI) * glm::vec2(x, y) / spectrum.oceanSize;
+            initialSpectrum[y * n + x] = ComputeInitialSpectrum(waveVector, spectrum.windDirection, spectrum.oceanSize);
+        }
+    }
+
+    // Every texel of the spectrum holds two waves, h0(k) e^(i phase) + h0(k*) e^(-i phase), which the FFT of
+    // shaders/spectrum.cs.hlsl turns into the displacement packed as (x, height) and z. Unpacked per wave, that is
+    // height = (1 - choppiness kx/|k|) h0 cos(psi), and sines for the horizontal displacement.
+    struct Wave {
+        double phase;
+        double omega;
+        glm::vec2 waveVector;
+        glm::vec3 amplitude;
+    };
+    std::vector<Wave> waves;
+    waves.reserve(2 * size_t(n) * n);
+    const float c = spectrum.choppiness;
+    const float scale = spectrum.displacementScaleFactor;
+    for (int32_t y = 0; y < n; ++y) {
+        for (int32_t x = 0; x < n; ++x) {
+            const glm::vec2 waveVector = 2.0f * float(M_PI) * glm::vec2(x, y) / spectrum.oceanSize;
+            const float k = glm::length(waveVector);
+            if (k == 0.0f) continue; // No DC term
+            const glm::vec2 direction = waveVector / k;
+            // The conjugate index, as computed by shaders/spectrum.cs.hlsl
+            const glm::ivec2 conjugateTexel = (glm::ivec2(n) - glm::ivec2(x, y)) % (n - 1);
+            const float h0 = initialSpectrum[y * n + x];
+            const float h0Conjugate = initialSpectrum[conjugateTexel.y * n + conjugateTexel.x];
+
+            // Texel t of the displacement map is sampled at world position (t + 0.5) / N * period; indices past N / 2
+            // are the negative frequencies they alias to, which is what bilinear filtering between texels follows
+            const glm::vec2 frequency = glm::vec2(x < n / 2 ? x : x - n, y < n / 2 ? y : y - n);
+            const glm::vec2 worldWaveVector = 2.0f * float(M_PI) * frequency / mPeriod;
+            const double texelCenterPhase = M_PI * double(frequency.x + frequency.y) / double(n);
+            const double phase = spectrum.initialPhases[y * n + x];
+            const double omega = Omega(k);
+            const float heightFactor = scale * (1.0f - c * direction.x);
+            const glm::vec2 horizontalFactor = scale * glm::vec2(c * direction.x - 1.0f, c * direction.y);
+            waves.push_back({
+                .phase = phase + texelCenterPhase,
+                .omega = omega,
+                .waveVector = -worldWaveVector,
+                .amplitude = glm::vec3(horizontalFactor.x * h0, heightFactor * h0, horizontalFactor.y * h0),
+            });
+            waves.push_back({
+                .phase = phase - texelCenterPhase,
+                .omega = omega,
+                .waveVector = worldWaveVector,
+                .amplitude = glm::vec3(-horizontalFactor.x * h0Conjugate, heightFactor * h0Conjugate, -horizontalFactor.y * h0Conjugate),
+            });
+        }
+    }
+
+    // Keep the waves with the largest height amplitudes; the dropped ones bound the error
+    std::sort(waves.begin(), waves.end(), [](const Wave& a, const Wave& b) { return std::abs(a.amplitude.y) > std::abs(b.amplitude.y); });
+    std::vector<double> droppedAmplitudeSums(waves.size() + 1, 0.0), droppedEnergySums(waves.size() + 1, 0.0);
+    for (size_t waveIdx = waves.size(); waveIdx-- > 0;) {
+        droppedAmplitudeSums[waveIdx] = droppedAmplitudeSums[waveIdx + 1] + std::abs(waves[waveIdx].amplitude.y);
+        droppedEnergySums[waveIdx] = droppedEnergySums[waveIdx + 1] + 0.5 * Square(waves[waveIdx].amplitude.y);
+    }
+    size_t componentCount = std::min<size_t>(desc.maxComponentCount, waves.size());
+    while (componentCount > 0 && droppedAmplitudeSums[componentCount - 1] <= desc.heightErrorTolerance) --componentCount;
+    mHeightErrorBound = float(droppedAmplitudeSums[componentCount]);
+    mHeightErrorRms = float(std::sqrt(droppedEnergySums[componentCount]));
+
+    for (const Wave& wave : std::span(waves).first(componentCount)) {
+        mPhases.push_back(wave.phase);
+        mOmegas.push_back(wave.omega);
+        mWaveVectorsX.push_back(wave.waveVector.x);
+        mWaveVectorsZ.push_back(wave.waveVector.y);
+        mAmplitudesX.push_back(wave.amplitude.x);
+        mAmplitudesY.push_back(wave.amplitude.y);
+        mAmplitudesZ.push_back(wave.amplitude.z);
+    }
+    LOG_INFO("Wave evaluator: {} of {} waves, height error at most {:.3f} m (RMS {:.3f} m)",
+        componentCount, waves.size(), mHeightErrorBound, mHeightErrorRms);
+}
+
+std::vector<float> WaveEvaluator::ComputePhases(double time) const
+{
+    // In double precision, since the phases grow without bound over time
+    std::vector<float> phases(mPhases.size());
+    for (size_t waveIdx = 0; waveIdx < phases.size(); ++waveIdx) {
+        phases[waveIdx] = float(std::fmod(mPhases[waveIdx] + mOmegas[waveIdx] * time, 2.0 * M_PI));
+    }
+    return phases;
+}
+
+void WaveEvaluator::EvaluateRange(const float* phases, std::span<const glm::vec2> positions, std::span<float> outHeights) const
+{
+    const WaveArrays waves = {
+        .phases = phases,
+        .waveVectorsX = mWaveVectorsX.data(),
+        .waveVectorsZ = mWaveVectorsZ.data(),
+        .amplitudesX = mAmplitudesX.data(),
+        .amplitudesY = mAmplitudesY.data(),
+        .amplitudesZ = mAmplitudesZ.data(),
+        .count = this->GetComponentCount(),
+    };
+    size_t pointIdx = 0;
+#if WAVE_EVALUATOR_SSE2
+    for (; pointIdx + 4 <= positions.size(); pointIdx += 4) {
+        // Deinterleave four XZ positions
+        const __m128 xz01 = _mm_loadu_ps(&positions[pointIdx].x);
+        const __m128 xz23 = _mm_loadu_ps(&positions[pointIdx + 2].x);
+        const Float4 x = WrapPeriod(Float4(_mm_shuffle_ps(xz01, xz23, _MM_SHUFFLE(2, 0, 2, 0))), mPeriod);
+        const Float4 z = WrapPeriod(Float4(_mm_shuffle_ps(xz01, xz23, _MM_SHUFFLE(3, 1, 3, 1))), mPeriod);
+        _mm_storeu_ps(&outHeights[pointIdx], EvaluateHeight(waves, mInversionIterationCount, x, z).v);
+    }
+#endif
+    for (; pointIdx < positions.size(); ++pointIdx) {
+        const float x = WrapPeriod(positions[pointIdx].x, mPeriod);
+        const float z = WrapPeriod(positions[pointIdx].y, mPeriod);
+        outHeights[pointIdx] = EvaluateHeight(waves, mInversionIterationCount, x, z);
+    }
+}
+
+void WaveEvaluator::EvaluateHeights(std::span<const glm::vec2> positions, double time, std::span<float> outHeights, ThreadPool* threadPool) const
+{
+    PROFILE_ZONE("WaveEvaluator::EvaluateHeights");
+    assert(outHeights.size() >= positions.size());
+    const std::vector<float> phases = this->ComputePhases(time);
+    if (!threadPool || positions.size() <= kPointsPerTask) {
+        this->EvaluateRange(phases.data(), positions, outHeights);
+        return;
+    }
+    std::vector<std::future<void>> tasks;
+    for (size_t firstPoint = 0; firstPoint < positions.size(); firstPoint += kPointsPerTask) {
+        const size_t pointCount = std::min(kPointsPerTask, positions.size() - firstPoint);
+        tasks.push_back(threadPool->Submit([this, &phases, positions, outHeights, firstPoint, pointCount]() {
+            this->EvaluateRange(phases.data(), positions.subspan(firstPoint, pointCount), outHeights.subspan(firstPoint, pointCount));
+        }));
+    }
+    for (auto& task : tasks) task.get();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <span>
+
+// Everything the GPU simulation derives its displacement field from, see OceanRenderer::CreateWaveEvaluator
+struct WaveSpectrumDesc {
+    uint32_t textureSize = 0u;               // Resolution N of the simulation textures.
+    float oceanSize = 0.0f;                  // Patch size the spectrum is computed for, as in shaders/simulation.hlsli.
+    float tileSize = 0.0f;                   // World-space size of an ocean tile, see OceanTiles.
+    std::span<const float> initialPhases;    // N x N phases at time 0, row-major.
+    glm::vec2 windDirection = glm::vec2(0.0f); // Scaled by the wind speed.
+    float choppiness = 0.0f;
+    float displacementScaleFactor = 1.0f;
+};
+
+struct WaveEvaluatorDesc {
+    uint32_t maxComponentCount = 64u;        // Number of waves evaluated at most; each one costs a sine and a cosine per point.
+    float heightErrorTolerance = 0.0f;       // [Optional] Keeps fewer waves if the height error bound stays below it, in meters.
+    uint32_t inversionIterationCount = 4u;   // Iterations inverting the horizontal displacement, as in shaders/wave_query.cs.hlsl.
+};
+
+class ThreadPool;
+// Evaluates ocean heights on the CPU, for consumers that can't wait for the GPU, e.g. AI or server-side physics.
+// The GPU field is a sum of N x N * 2 waves; this keeps the ones with the largest height amplitudes and sums them as
+// Gerstner waves, four points at a time with SSE2. Since every wave is bounded by its amplitude, the height at a grid
+// point differs from the full FFT field by at most the sum of the dropped amplitudes, see GetHeightErrorBound.
+class WaveEvaluator {
+public:
+    WaveEvaluator(const WaveSpectrumDesc& spectrum, const WaveEvaluatorDesc& desc = {});
+
+    // Height of the surface right above every world-space XZ position at simulated time `time`, in seconds; like the
+    // GPU queries, the horizontal displacement is inverted first. With a thread pool, chunks of points run in parallel.
+    void EvaluateHeights(std::span<const glm::vec2> positions, double time, std::span<float> outHeights, ThreadPool* threadPool = nullptr) const;
+
+    uint32_t GetComponentCount() const { return uint32_t(mAmplitudesY.size()); }
+    // Maximum difference to the heights of the full field at the same grid point, from the dropped waves
+    float GetHeightErrorBound() const { return mHeightErrorBound; }
+    // Root mean square of that difference, assuming the dropped waves are uncorrelated
+    float GetHeightErrorRms() const { return mHeightErrorRms; }
+
+private:
+    std::vector<float> ComputePhases(double time) const;
+    void EvaluateRange(const float* phases, std::span<const glm::vec2> positions, std::span<float> outHeights) const;
+
+    // Wave i displaces by (amplitudeX sin(psi), amplitudeY cos(psi), amplitudeZ sin(psi)),
+    // psi = phase + omega * t + waveVectorX * x + waveVectorZ * z
+    std::vector<double> mPhases;
+    std::vector<double> mOmegas;
+    std::vector<float> mWaveVectorsX, mWaveVectorsZ;
+    std::vector<float> mAmplitudesX, mAmplitudesY, mAmplitudesZ;
+    uint32_t mInversionIterationCount = 0u;
+    float mPeriod = 0.0f; // Of the field in world units
+    float mHeightErrorBound = 0.0f;
+    float mHeightErrorRms = 0.0f;
+};
@@ -0,0 +1,108 @@
+#include "ocean/wave_queries.h"
+
+#include "cpu_profiler.h"
+
+#include "vk/command_list.h"
+#include "vk/common.h"
+#include "vk/device.h"
+#include "vk/buffer.h"
+#include "vk/texture.h"
+#include "vk/pipeline.h"
+
+#include "ocean/grid.h"
+#include "ocean/ocean.h"
+
+// Must match WAVE_QUERY_WORKGROUP_SIZE in shaders/wave_query.cs.hlsl
+constexpr uint32_t kWaveQueryWorkGroupSize = 64u;
+
+WaveQueries::WaveQueries(const Device& device, Handle<Pipeline> pipeline, float tileSize)
+    : mPipeline(std::move(pipeline))
+    , mUvScale(kGridUvScale / tileSize)
+    , mReadbackQueue(device, kMaxQueryCount * sizeof(WaveQueryResult))
+{
+    for (auto& positionBuffer : mPositionBuffers) {
+        positionBuffer = CreateHandle<Buffer>(device, BufferDesc{
+            .byteSize = kMaxQueryCount * sizeof(glm::vec2),
+            .access = MemoryAccess::HOST,
+            .usage = BufferUsageBits::STORAGE,
+            .debugName = "Wave query positions",
+            .category = MemoryCategory::SIMULATION,
+        });
+    }
+    for (auto& resultBuffer : mResultBuffers) {
+        resultBuffer = CreateHandle<Buffer>(device, BufferDesc{
+            .byteSize = kMaxQueryCount * sizeof(WaveQueryResult),
+            .usage = BufferUsageBits::STORAGE,
+            .debugName = "Wave query results",
+            .category = MemoryCategory::SIMULATION,
+        });
+    }
+}
+
+WaveQueries::~WaveQueries() = default;
+
+bool WaveQueries::Query(std::span<const glm::vec2> positions, WaveQueryFn callback)
+{
+    const std::scoped_lock lock(mMutex);
+    if (mPositions.size() + positions.size() > kMaxQueryCount) {
+        if (!mHasWarnedAboutDroppedBatch) {
+            LOG_WARN("Wave query batch of {} positions exceeds the {} queries per frame; it's dropped", positions.size(), kMaxQueryCount);
+            mHasWarnedAboutDroppedBatch = true;
+        }
+        return false;
+    }
+    mBatches.push_back({ .firstQuery = uint32_t(mPositions.size()), .queryCount = uint32_t(positions.size()), .callback = std::move(callback) });
+    mPositions.insert(mPositions.end(), positions.begin(), positions.end());
+    return true;
+}
+
+bool WaveQueries::HasPendingQueries() const
+{
+    const std::scoped_lock lock(mMutex);
+    return !mPositions.empty();
+}
+
+void WaveQueries::BeginFrame()
+{
+    mReadbackQueue.BeginFrame();
+}
+
+void WaveQueries::Record(CommandList& cmdList, uint32_t frameIndex, const Texture& displacementMap, const Texture& normalMap, float displacementScaleFactor)
+{
+    PROFILE_ZONE("WaveQueries::Record");
+    std::vector<Batch> batches;
+    uint32_t queryCount = 0u;
+    {
+        const std::scoped_lock lock(mMutex);
+        queryCount = uint32_t(mPositions.size());
+        memcpy(mPositionBuffers[frameIndex]->GetMappedData(), mPositions.data(), mPositions.size() * sizeof(glm::vec2));
+        mPositions.clear();
+        batches = std::move(mBatches);
+        mBatches.clear();
+    }
+    if (queryCount == 0u) return;
+
+    const WaveQueryPushConstantData pushConstantData = {
+        .queryCount = queryCount,
+        .positionsIndex = mPositionBuffers[frameIndex]->GetStorageIndex(),
+        .outResultsIndex = mResultBuffers[frameIndex]->GetStorageIndex(),
+        .displacementMapIndex = displacementMap.GetSampledIndex(),
+        .normalMapIndex = normalMap.GetSampledIndex(),
+        .displacementScaleFactor = displacementScaleFactor,
+        .uvScale = mUvScale,
+    };
+    cmdList.SetComputeState({
+        .pipeline = mPipeline,
+        .pushConstants = { .byteSize = sizeof(WaveQueryPushConstantData), .data = (void*)&pushConstantData }
+    });
+    cmdList.Dispatch((queryCount + kWaveQueryWorkGroupSize - 1) / kWaveQueryWorkGroupSize);
+
+    // All batches of the frame come back in one copy and are split up on arrival
+    mReadbackQueue.ReadBuffer(cmdList, *mResultBuffers[frameIndex], 0u, queryCount * sizeof(WaveQueryResult),
+        [batches = std::move(batches)](std::span<const std::byte> data) {
+            const auto* results = (const WaveQueryResult*)data.data();
+            for (const Batch& batch : batches) {
+                if (batch.callback) batch.callback({ results + batch.firstQuery, batch.queryCount });
+            }
+        });
+}
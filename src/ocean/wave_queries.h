@@ -0,0 +1,68 @@
+#pragma once
+
+#include <mutex>
+#include <span>
+
+#include "vk/frame_pacing.h"
+#include "vk/readback_queue.h"
+
+// Ocean surface at a world-space XZ position
+struct WaveQueryResult {
+    float height;      // World-space Y of the displaced surface
+    glm::vec3 normal;
+};
+static_assert(sizeof(WaveQueryResult) == 16, "Must match the layout written by shaders/wave_query.cs.hlsl");
+
+// Receives the results of a batch, in the order of its positions; the span is only valid during the call
+using WaveQueryFn = std::function<void(std::span<const WaveQueryResult> results)>;
+
+class Device;
+class Buffer;
+class Texture;
+class Pipeline;
+class CommandList;
+// Answers batches of surface height queries, e.g. the hull sample points of floating objects, on the GPU. The queries
+// of a frame are evaluated by a single dispatch against that frame's displacement field, and their results are copied
+// into one staging range that's delivered to the callbacks kMaxFramesInFlightCount frames later, without stalling.
+// Since the surface is displaced horizontally too, the shader inverts that displacement to find the height right
+// above every position, rather than the height of the grid point below it.
+class WaveQueries {
+public:
+    static constexpr uint32_t kMaxQueryCount = 128u * 1024u; // Per frame
+
+    // `pipeline` runs shaders/wave_query.cs.hlsl; `tileSize` is the size of the ocean grid, see OceanTiles
+    WaveQueries(const Device& device, Handle<Pipeline> pipeline, float tileSize);
+    ~WaveQueries();
+
+    // Adds the positions to the queries of the next recorded frame; can be called from any thread.
+    // Returns false, and drops the batch, if the frame already holds too many queries.
+    bool Query(std::span<const glm::vec2> positions, WaveQueryFn callback);
+
+    // Delivers the results of the frame recorded kMaxFramesInFlightCount frames ago.
+    // NOTE: That frame must have finished executing, see FramePacingState::WaitForFrameInFlight.
+    void BeginFrame();
+    // Evaluates the queries added so far against the simulation textures, which must be in the SHADER_RESOURCE state
+    void Record(CommandList& cmdList, uint32_t frameIndex, const Texture& displacementMap, const Texture& normalMap, float displacementScaleFactor);
+
+    bool HasPendingQueries() const;
+
+private:
+    struct Batch {
+        uint32_t firstQuery = 0u;
+        uint32_t queryCount = 0u;
+        WaveQueryFn callback;
+    };
+
+    Handle<Pipeline> mPipeline;
+    float mUvScale = 0.0f;
+    // Positions are written by the host and read by the dispatch of the same frame in flight
+    std::array<Handle<Buffer>, kMaxFramesInFlightCount> mPositionBuffers;
+    std::array<Handle<Buffer>, kMaxFramesInFlightCount> mResultBuffers;
+    ReadbackQueue mReadbackQueue;
+
+    // Queries of the next recorded frame; staged on the CPU since they may be added before its frame in flight is free
+    mutable std::mutex mMutex;
+    std::vector<glm::vec2> mPositions;
+    std::vector<Batch> mBatches;
+    bool mHasWarnedAboutDroppedBatch = false;
+};
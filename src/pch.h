@@ -14,6 +14,7 @@
 #include <filesystem>
 #include <sstream>
 #include <memory>
+#include <future>
 
 template <typename T>
 using Handle = std::shared_ptr<T>;
@@ -0,0 +1,362 @@
+#include <numeric>
+
+#include "render_graph.h"
+
+#include "vk/device.h"
+#include "vk/common.h"
+#include "vk/command_list.h"
+#include "vk/descs_conversions.h"
+#include "vk/gpu_profiler.h"
+#include "vk/memory_tracker.h"
+#include "vk/deletion_queue.h"
+
+#include "cpu_profiler.h"
+#include "utils.h"
+
+static const char* GetQueueName(RenderGraphQueue queue)
+{
+    switch (queue) {
+        case RenderGraphQueue::GRAPHICS: return "graphics";
+        case RenderGraphQueue::COMPUTE:  return "compute";
+        default:                         return "unknown";
+    }
+}
+
+static const char* GetResourceStateName(ResourceStateBits state)
+{
+    switch (state) {
+        case ResourceStateBits::COMMON:           return "COMMON";
+        case ResourceStateBits::SHADER_RESOURCE:  return "SHADER_RESOURCE";
+        case ResourceStateBits::UNORDERED_ACCESS: return "UNORDERED_ACCESS";
+        case ResourceStateBits::RENDER_TARGET:    return "RENDER_TARGET";
+        case ResourceStateBits::DEPTH_WRITE:      return "DEPTH_WRITE";
+        case ResourceStateBits::DEPTH_READ:       return "DEPTH_READ";
+        case ResourceStateBits::COPY_DEST:        return "COPY_DEST";
+        case ResourceStateBits::COPY_SOURCE:      return "COPY_SOURCE";
+        case ResourceStateBits::PRESENT:          return "PRESENT";
+        default:                                  return "MIXED";
+    }
+}
+
+static float ToMiB(VkDeviceSize byteSize)
+{
+    return float(byteSize) / (1024.0f * 1024.0f);
+}
+
+RenderGraph::RenderGraph(const Device& device)
+    : mDevice(device)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+    this->DestroyTransientTextures();
+}
+
+void RenderGraph::Reset()
+{
+    mPasses.clear();
+    mTextures.clear();
+    mExecutionOrder.clear();
+    mCulledPasses.clear();
+}
+
+RenderGraphTexture RenderGraph::ImportTexture(std::string name, Texture& texture)
+{
+    mTextures.push_back({ .name = std::move(name), .texture = &texture, .isImported = true });
+    return { .index = uint32_t(mTextures.size() - 1) };
+}
+
+RenderGraphTexture RenderGraph::CreateTexture(std::string name, const TextureDesc& desc)
+{
+    assert(desc.resource == nullptr && desc.aliasedMemory == VK_NULL_HANDLE);
+    mTextures.push_back({ .name = std::move(name), .desc = desc });
+    return { .index = uint32_t(mTextures.size() - 1) };
+}
+
+Texture& RenderGraph::GetTexture(RenderGraphTexture texture) const
+{
+    assert(texture.index < mTextures.size() && mTextures[texture.index].texture != nullptr);
+    return *mTextures[texture.index].texture;
+}
+
+void RenderGraph::AddPass(std::string name, RenderGraphQueue queue, std::vector<RenderGraphAccess> accesses, ExecuteFn execute, bool hasSideEffects)
+{
+    for (auto [idx, access] : enumerate(accesses)) {
+        assert(access.texture.index < mTextures.size());
+        assert(std::none_of(accesses.begin(), accesses.begin() + idx, [&](const RenderGraphAccess& other) {
+            return other.texture.index == access.texture.index;
+        }));
+    }
+    mPasses.push_back({ .name = std::move(name), .queue = queue, .accesses = std::move(accesses), .execute = std::move(execute), .hasSideEffects = hasSideEffects });
+}
+
+void RenderGraph::Compile()
+{
+    PROFILE_ZONE("RenderGraph::Compile");
+    // Every pass depends on the last writer of the textures it accesses (read or write after write), and writers also
+    // depend on the readers since that writer (write after read). Only the former make a pass needed by its dependents.
+    const uint32_t passCount = uint32_t(mPasses.size());
+    std::vector<std::vector<uint32_t>> dependencies(passCount);
+    std::vector<std::vector<uint32_t>> producers(passCount);
+    {
+        std::vector<uint32_t> lastWriters(mTextures.size(), ~0u);
+        std::vector<std::vector<uint32_t>> readersSinceWrite(mTextures.size());
+        for (uint32_t passIdx = 0; passIdx < passCount; ++passIdx) {
+            for (const RenderGraphAccess& access : mPasses[passIdx].accesses) {
+                const uint32_t textureIdx = access.texture.index;
+                if (lastWriters[textureIdx] != ~0u) {
+                    dependencies[passIdx].push_back(lastWriters[textureIdx]);
+                    producers[passIdx].push_back(lastWriters[textureIdx]);
+                }
+                if (IsReadOnlyResourceState(access.state)) {
+                    readersSinceWrite[textureIdx].push_back(passIdx);
+                    continue;
+                }
+                for (uint32_t reader : readersSinceWrite[textureIdx]) dependencies[passIdx].push_back(reader);
+                readersSinceWrite[textureIdx].clear();
+                lastWriters[textureIdx] = passIdx;
+            }
+        }
+    }
+
+    // Passes are needed if they write an imported texture, have side effects, or produce something a needed pass accesses.
+    // Dependencies always point to earlier passes, so one sweep from the back finds them all.
+    std::vector<bool> isNeeded(passCount, false);
+    for (uint32_t passIdx = passCount; passIdx-- > 0;) {
+        if (mPasses[passIdx].hasSideEffects) isNeeded[passIdx] = true;
+        for (const RenderGraphAccess& access : mPasses[passIdx].accesses) {
+            if (mTextures[access.texture.index].isImported && !IsReadOnlyResourceState(access.state)) isNeeded[passIdx] = true;
+        }
+        if (!isNeeded[passIdx]) {
+            mCulledPasses.push_back(passIdx);
+            continue;
+        }
+        for (uint32_t producer : producers[passIdx]) isNeeded[producer] = true;
+    }
+    std::reverse(mCulledPasses.begin(), mCulledPasses.end());
+
+    // Topological order of the needed passes. Of the passes that are ready, the ones on the queue of the previous pass
+    // go first so work on the same queue stays together, then the ones that were added first.
+    std::vector<uint32_t> pendingDependencyCounts(passCount, 0u);
+    std::vector<std::vector<uint32_t>> dependents(passCount);
+    for (uint32_t passIdx = 0; passIdx < passCount; ++passIdx) {
+        if (!isNeeded[passIdx]) continue;
+        std::sort(dependencies[passIdx].begin(), dependencies[passIdx].end());
+        dependencies[passIdx].erase(std::unique(dependencies[passIdx].begin(), dependencies[passIdx].end()), dependencies[passIdx].end());
+        for (uint32_t dependency : dependencies[passIdx]) {
+            if (!isNeeded[dependency]) continue;
+            dependents[dependency].push_back(passIdx);
+            ++pendingDependencyCounts[passIdx];
+        }
+    }
+    std::vector<uint32_t> readyPasses;
+    for (uint32_t passIdx = 0; passIdx < passCount; ++passIdx) {
+        if (isNeeded[passIdx] && pendingDependencyCounts[passIdx] == 0u) readyPasses.push_back(passIdx);
+    }
+    RenderGraphQueue previousQueue = RenderGraphQueue::COUNT;
+    while (!readyPasses.empty()) {
+        const auto next = std::min_element(readyPasses.begin(), readyPasses.end(), [&](uint32_t a, uint32_t b) {
+            const bool isSameQueueA = mPasses[a].queue == previousQueue;
+            const bool isSameQueueB = mPasses[b].queue == previousQueue;
+            return isSameQueueA != isSameQueueB ? isSameQueueA : a < b;
+        });
+        const uint32_t passIdx = *next;
+        readyPasses.erase(next);
+        mExecutionOrder.push_back(passIdx);
+        previousQueue = mPasses[passIdx].queue;
+        for (uint32_t dependent : dependents[passIdx]) {
+            if (--pendingDependencyCounts[dependent] == 0u) readyPasses.push_back(dependent);
+        }
+    }
+    assert(mExecutionOrder.size() + mCulledPasses.size() == passCount);
+
+    // Lifetimes of the transient textures
+    for (auto [position, passIdx] : enumerate(mExecutionOrder)) {
+        for (const RenderGraphAccess& access : mPasses[passIdx].accesses) {
+            TextureResource& resource = mTextures[access.texture.index];
+            if (resource.isImported) continue;
+            resource.firstUse = std::min(resource.firstUse, uint32_t(position));
+            resource.lastUse = std::max(resource.lastUse, uint32_t(position));
+        }
+    }
+
+    // Compared as a whole rather than hashed, so textures with different descs can never be mistaken for each other
+    std::vector<TransientTextureKey> transientKeys;
+    for (const TextureResource& resource : mTextures) {
+        if (resource.isImported) continue;
+        transientKeys.push_back({
+            .dimensions = resource.desc.dimensions,
+            .mipCount = resource.desc.mipCount,
+            .format = resource.desc.format,
+            .usage = resource.desc.usage,
+            .filter = resource.desc.sampler.filter,
+            .wrapMode = resource.desc.sampler.wrapMode,
+            .firstUse = resource.firstUse,
+            .lastUse = resource.lastUse,
+        });
+    }
+    if (transientKeys != mTransientKeys) {
+        this->DestroyTransientTextures();
+        this->AllocateTransientTextures();
+        mTransientKeys = std::move(transientKeys);
+        if (std::getenv("WAVES_DUMP_RENDER_GRAPH") != nullptr) LOG_INFO("{}", this->Dump());
+    }
+
+    uint32_t transientIdx = 0;
+    for (TextureResource& resource : mTextures) {
+        if (resource.isImported) continue;
+        resource.texture = mTransientTextures[transientIdx].get();
+        resource.memoryBlock = mTransientMemoryBlocks[transientIdx];
+        ++transientIdx;
+    }
+}
+
+void RenderGraph::AllocateTransientTextures()
+{
+    struct Occupant {
+        uint32_t firstUse;
+        uint32_t lastUse;
+    };
+    std::vector<std::vector<Occupant>> blockOccupants;
+    std::vector<VkMemoryRequirements> requirements;
+    for (const TextureResource& resource : mTextures) {
+        if (resource.isImported) continue;
+        requirements.push_back(resource.firstUse != ~0u ? Texture::GetMemoryRequirements(mDevice, resource.desc) : VkMemoryRequirements{});
+    }
+    mTransientTextures.resize(requirements.size());
+    mTransientMemoryBlocks.assign(requirements.size(), ~0u);
+
+    // Place the largest textures first, each in the first block whose textures are all dead while it's alive
+    std::vector<const TextureResource*> transients;
+    for (const TextureResource& resource : mTextures) {
+        if (!resource.isImported) transients.push_back(&resource);
+    }
+    std::vector<uint32_t> placementOrder(transients.size());
+    std::iota(placementOrder.begin(), placementOrder.end(), 0u);
+    std::stable_sort(placementOrder.begin(), placementOrder.end(), [&](uint32_t a, uint32_t b) {
+        return requirements[a].size > requirements[b].size;
+    });
+    for (uint32_t transientIdx : placementOrder) {
+        const TextureResource& resource = *transients[transientIdx];
+        if (resource.firstUse == ~0u) continue; // Only accessed by culled passes
+        const VkMemoryRequirements& textureRequirements = requirements[transientIdx];
+
+        uint32_t blockIdx = 0;
+        for (; blockIdx < mMemoryBlocks.size(); ++blockIdx) {
+            if ((mMemoryBlocks[blockIdx].requirements.memoryTypeBits & textureRequirements.memoryTypeBits) == 0u) continue;
+            const bool isOverlapping = std::any_of(blockOccupants[blockIdx].begin(), blockOccupants[blockIdx].end(), [&](const Occupant& occupant) {
+                return occupant.firstUse <= resource.lastUse && resource.firstUse <= occupant.lastUse;
+            });
+            if (!isOverlapping) break;
+        }
+        if (blockIdx == mMemoryBlocks.size()) {
+            mMemoryBlocks.push_back({ .requirements = { .memoryTypeBits = ~0u } });
+            blockOccupants.emplace_back();
+        }
+        VkMemoryRequirements& blockRequirements = mMemoryBlocks[blockIdx].requirements;
+        blockRequirements.size = std::max(blockRequirements.size, textureRequirements.size);
+        blockRequirements.alignment = std::max(blockRequirements.alignment, textureRequirements.alignment);
+        blockRequirements.memoryTypeBits &= textureRequirements.memoryTypeBits;
+        blockOccupants[blockIdx].push_back({ .firstUse = resource.firstUse, .lastUse = resource.lastUse });
+        mTransientMemoryBlocks[transientIdx] = blockIdx;
+    }
+
+    const VmaAllocationCreateInfo allocationCreateInfo = {
+        .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    };
+    for (auto [blockIdx, block] : enumerate(mMemoryBlocks)) {
+        VK_CHECK(vmaAllocateMemory(mDevice.Allocator(), &block.requirements, &allocationCreateInfo, &block.allocation, nullptr));
+        mDevice.GetMemoryTracker().Track(block.allocation, MemoryCategory::RENDER_GRAPH, fmt::format("Render graph block {}", blockIdx).c_str());
+    }
+    for (auto [transientIdx, resource] : enumerate(transients)) {
+        const uint32_t blockIdx = mTransientMemoryBlocks[transientIdx];
+        if (blockIdx == ~0u) continue;
+        TextureDesc desc = resource->desc;
+        desc.aliasedMemory = mMemoryBlocks[blockIdx].allocation;
+        desc.debugName = resource->name.c_str();
+        mTransientTextures[transientIdx] = std::make_unique<Texture>(mDevice, desc);
+    }
+
+    VkDeviceSize aliasedByteSize = 0, unaliasedByteSize = 0;
+    for (const MemoryBlock& block : mMemoryBlocks) aliasedByteSize += block.requirements.size;
+    for (const VkMemoryRequirements& textureRequirements : requirements) unaliasedByteSize += textureRequirements.size;
+    LOG_INFO("Render graph placed {} transient textures in {} memory blocks: {:.1f} MiB ({:.1f} MiB without aliasing)",
+        transients.size(), mMemoryBlocks.size(), ToMiB(aliasedByteSize), ToMiB(unaliasedByteSize));
+}
+
+void RenderGraph::DestroyTransientTextures()
+{
+    if (mMemoryBlocks.empty() && mTransientTextures.empty()) return;
+    // Previous frames may still be using them, so the textures and then their memory are destroyed once they're done
+    mTransientTextures.clear();
+    mTransientMemoryBlocks.clear();
+    for (const MemoryBlock& block : mMemoryBlocks) {
+        mDevice.GetDeletionQueue().Push([&device = mDevice, allocation = block.allocation]() {
+            device.GetMemoryTracker().Untrack(allocation);
+            vmaFreeMemory(device.Allocator(), allocation);
+        });
+    }
+    mMemoryBlocks.clear();
+}
+
+void RenderGraph::Execute(CommandList& cmdList, GpuProfiler* profiler)
+{
+    PROFILE_ZONE("RenderGraph::Execute");
+    for (auto [position, passIdx] : enumerate(mExecutionOrder)) {
+        const Pass& pass = mPasses[passIdx];
+        for (const RenderGraphAccess& access : pass.accesses) {
+            const TextureResource& resource = mTextures[access.texture.index];
+            if (!resource.isImported && resource.firstUse == position) {
+                MemoryBlock& block = mMemoryBlocks[resource.memoryBlock];
+                cmdList.AliasTexture(*resource.texture, block.lastTexture);
+                block.lastTexture = resource.texture;
+            }
+            cmdList.SetResourceState(*resource.texture, access.state);
+        }
+        if (profiler != nullptr) profiler->BeginScope(cmdList, pass.name);
+        pass.execute(cmdList);
+        if (profiler != nullptr) profiler->EndScope(cmdList);
+    }
+}
+
+std::string RenderGraph::Dump() const
+{
+    std::string dump = fmt::format("Render graph: {} passes, {} culled\n", mExecutionOrder.size(), mCulledPasses.size());
+    for (auto [position, passIdx] : enumerate(mExecutionOrder)) {
+        const Pass& pass = mPasses[passIdx];
+        dump += fmt::format("  {:>3} {} [{}]\n", position, pass.name, GetQueueName(pass.queue));
+        for (const RenderGraphAccess& access : pass.accesses) {
+            const TextureResource& resource = mTextures[access.texture.index];
+            dump += fmt::format("        {} {} ({})\n",
+                IsReadOnlyResourceState(access.state) ? "reads " : "writes", resource.name, GetResourceStateName(access.state));
+        }
+    }
+    for (uint32_t passIdx : mCulledPasses) {
+        dump += fmt::format("  culled {} [{}]\n", mPasses[passIdx].name, GetQueueName(mPasses[passIdx].queue));
+    }
+
+    dump += "Transient textures:\n";
+    VkDeviceSize unaliasedByteSize = 0;
+    uint32_t transientIdx = 0;
+    for (const TextureResource& resource : mTextures) {
+        if (resource.isImported) continue;
+        const uint32_t blockIdx = transientIdx < mTransientMemoryBlocks.size() ? mTransientMemoryBlocks[transientIdx] : ~0u;
+        ++transientIdx;
+        if (blockIdx == ~0u) {
+            dump += fmt::format("  {} is unused\n", resource.name);
+            continue;
+        }
+        const VkDeviceSize byteSize = Texture::GetMemoryRequirements(mDevice, resource.desc).size;
+        unaliasedByteSize += byteSize;
+        dump += fmt::format("  {} {}x{}: {:.2f} MiB in block {}, alive in passes {}-{}\n",
+            resource.name, resource.desc.dimensions.x, resource.desc.dimensions.y, ToMiB(byteSize), blockIdx, resource.firstUse, resource.lastUse);
+    }
+    VkDeviceSize aliasedByteSize = 0;
+    for (auto [blockIdx, block] : enumerate(mMemoryBlocks)) {
+        dump += fmt::format("  block {}: {:.2f} MiB\n", blockIdx, ToMiB(block.requirements.size));
+        aliasedByteSize += block.requirements.size;
+    }
+    dump += fmt::format("Transient memory: {:.2f} MiB, {:.2f} MiB without aliasing", ToMiB(aliasedByteSize), ToMiB(unaliasedByteSize));
+    return dump;
+}
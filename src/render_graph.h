@@ -0,0 +1,119 @@
+#pragma once
+
+#include "vk/texture.h"
+
+// Handle of a texture declared in a RenderGraph; only valid until the graph is reset
+struct RenderGraphTexture {
+    uint32_t index = ~0u;
+};
+
+// Queue a pass is submitted to. The device currently exposes a single queue that supports both, so the queue only
+// groups passes when they're ordered; it's where passes would be split up once there's an async compute queue.
+enum class RenderGraphQueue : uint8_t {
+    GRAPHICS,
+    COMPUTE,
+    COUNT
+};
+
+// Texture a pass accesses, in the state the pass needs it in. Passes that access a texture in a writing state
+// (see IsReadOnlyResourceState) are its writers.
+struct RenderGraphAccess {
+    RenderGraphTexture texture;
+    ResourceStateBits state = ResourceStateBits::SHADER_RESOURCE;
+};
+
+class CommandList;
+class Device;
+class GpuProfiler;
+// Frame graph: passes declare the textures they access, and the graph orders them, culls those whose results are
+// never used and records the barriers between them. Transient textures only live during the frame, so textures whose
+// lifetimes don't overlap share memory.
+// The graph is meant to be rebuilt every frame; the transient textures and their memory are kept while they don't change.
+class RenderGraph {
+public:
+    using ExecuteFn = std::function<void(CommandList& cmdList)>;
+
+    explicit RenderGraph(const Device& device);
+    ~RenderGraph();
+
+    // Removes all passes and textures, but keeps the transient memory for the next compile
+    void Reset();
+
+    // Texture that outlives the frame; it's never aliased, and passes writing it are never culled
+    RenderGraphTexture ImportTexture(std::string name, Texture& texture);
+    // Texture that only lives during the frame. Its memory may be shared with other transient textures,
+    // so its contents are undefined before its first access in every frame.
+    RenderGraphTexture CreateTexture(std::string name, const TextureDesc& desc);
+    // NOTE: Transient textures only exist after the graph was compiled
+    Texture& GetTexture(RenderGraphTexture texture) const;
+
+    // Passes with side effects outside the graph, e.g. writing buffers that are read back, are never culled
+    void AddPass(std::string name, RenderGraphQueue queue, std::vector<RenderGraphAccess> accesses, ExecuteFn execute, bool hasSideEffects = false);
+
+    // Orders and culls the passes and places the transient textures in memory.
+    // NOTE: If the transient textures changed since the last compile, the previous ones and their memory are destroyed
+    // through the device's DeletionQueue once the frames in flight that use them have finished.
+    void Compile();
+    // Records the passes, transitioning the textures into the states the passes declared right before each one.
+    // With a profiler, every pass is timed in a scope named after it.
+    void Execute(CommandList& cmdList, GpuProfiler* profiler = nullptr);
+
+    // Describes the compiled graph: the passes in execution order, and the lifetime and memory of the transient textures
+    std::string Dump() const;
+
+private:
+    struct Pass {
+        std::string name;
+        RenderGraphQueue queue = RenderGraphQueue::GRAPHICS;
+        std::vector<RenderGraphAccess> accesses;
+        ExecuteFn execute;
+        bool hasSideEffects = false;
+    };
+
+    struct TextureResource {
+        std::string name;
+        TextureDesc desc = {};
+        Texture* texture = nullptr;        // Imported texture, or the transient texture once compiled
+        bool isImported = false;
+        // Lifetime, as positions in the execution order; only set for transient textures that aren't culled
+        uint32_t firstUse = ~0u;
+        uint32_t lastUse = 0u;
+        uint32_t memoryBlock = ~0u;
+    };
+
+    // Memory shared by transient textures with disjoint lifetimes
+    struct MemoryBlock {
+        VkMemoryRequirements requirements = {};
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        const Texture* lastTexture = nullptr; // Texture that accessed the memory last, also in previous frames
+    };
+
+    // Everything the transient textures are created and placed in memory from
+    struct TransientTextureKey {
+        glm::uvec3 dimensions = glm::uvec3(0u);
+        uint32_t mipCount = 0u;
+        Format format = Format::NONE;
+        TextureUsageBits usage = TextureUsageBits::NONE;
+        Filter filter = Filter::TRILINEAR;
+        WrapMode wrapMode = WrapMode::CLAMP_TO_EDGE;
+        uint32_t firstUse = ~0u;
+        uint32_t lastUse = 0u;
+
+        bool operator==(const TransientTextureKey&) const = default;
+    };
+
+    void AllocateTransientTextures();
+    void DestroyTransientTextures();
+
+    const Device& mDevice;
+    std::vector<Pass> mPasses;
+    std::vector<TextureResource> mTextures;
+    std::vector<uint32_t> mExecutionOrder; // Indices of the passes that aren't culled
+    std::vector<uint32_t> mCulledPasses;
+
+    // Kept across frames while the transient textures and their lifetimes stay the same
+    std::vector<TransientTextureKey> mTransientKeys;
+    std::vector<MemoryBlock> mMemoryBlocks;
+    std::vector<std::unique_ptr<Texture>> mTransientTextures; // In the order the transient textures were created
+    std::vector<uint32_t> mTransientMemoryBlocks;              // Memory block of every transient texture
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+constexpr float kMinRenderScale = 0.5f;
+constexpr float kMaxRenderScale = 1.0f;
+
+// Picks the render resolution scale that keeps the GPU time of the scaled passes within a budget.
+// The cost of those passes is assumed to be proportional to their pixel count, i.e. the scale squared.
+struct ResolutionScaler {
+    float scale = kMaxRenderScale;
+
+    // Relative deviation from the budget that is tolerated before rescaling, so the scale doesn't oscillate
+    static constexpr float kHysteresis = 0.1f;
+    // Largest change of the scale per update, so single slow frames don't cause visible jumps
+    static constexpr float kMaxScaleStep = 0.05f;
+    // Weight of the newest sample in the smoothed GPU time
+    static constexpr float kSmoothingFactor = 0.1f;
+
+    inline float Update(float gpuTimeMs, float budgetMs)
+    {
+        smoothedGpuTimeMs = smoothedGpuTimeMs > 0.0f ? std::lerp(smoothedGpuTimeMs, gpuTimeMs, kSmoothingFactor) : gpuTimeMs;
+        const float ratio = budgetMs / std::max(smoothedGpuTimeMs, 1e-3f);
+        if (std::abs(ratio - 1.0f) > kHysteresis) {
+            const float targetScale = scale * std::sqrt(ratio);
+            scale = std::clamp(targetScale, scale - kMaxScaleStep, scale + kMaxScaleStep);
+            scale = std::clamp(scale, kMinRenderScale, kMaxRenderScale);
+        }
+        return scale;
+    }
+
+private:
+    float smoothedGpuTimeMs = 0.0f;
+};
@@ -1,7 +1,16 @@
 [[vk::combinedImageSampler]] [[vk::binding(0, 0)]] SamplerState gSampler;
 [[vk::combinedImageSampler]] [[vk::binding(0, 0)]] Texture2D gTexture;
 
+struct Constants {
+    // Fraction of the texture that holds the image to upscale
+    float2 uvScale;
+    // Largest uv that doesn't filter in texels outside of the image
+    float2 maxUv;
+};
+
+[[vk::push_constant]] Constants gConsts;
+
 float4 main(float2 uv : TEXCOORD0): SV_TARGET
 {
-    return gTexture.Sample(gSampler, uv);
+    return gTexture.Sample(gSampler, min(uv * gConsts.uvScale, gConsts.maxUv));
 }
\ No newline at end of file
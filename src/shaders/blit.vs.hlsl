@@ -8,7 +8,8 @@ VSOutput main(uint vertexID : SV_VertexID)
     VSOutput output = (VSOutput)0;
     const uint u = vertexID & 1;
 	const uint v = (vertexID >> 1) & 1;
-    output.pos = float4(float(u) * 2 - 1, 1 - float(v) * 2, 0, 1);
+    // Vulkan's clip space has Y pointing down, so uv (0, 0) is the top-left corner
+    output.pos = float4(float(u) * 2 - 1, float(v) * 2 - 1, 0, 1);
     output.uv = float2(u, v);
     return output;
 }
\ No newline at end of file
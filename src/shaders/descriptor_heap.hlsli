@@ -0,0 +1,14 @@
+#ifndef DESCRIPTOR_HEAP_HLSLI
+#define DESCRIPTOR_HEAP_HLSLI
+
+// The global descriptor heap, bound to set 1 of every pipeline; see vk/descriptor_heap.h for the bindings.
+// Resources are accessed by their heap index, passed through push constants. The arrays of a binding alias,
+// so one binding holds textures of every format; index the array whose element type matches the texture's.
+[[vk::binding(0, 1)]] Texture2D<float> gTexturesFloat[];
+[[vk::binding(0, 1)]] Texture2D<float4> gTexturesFloat4[];
+[[vk::binding(1, 1)]] RWTexture2D<float> gRWTexturesFloat[];
+[[vk::binding(1, 1)]] RWTexture2D<float4> gRWTexturesFloat4[];
+// Storage buffers are untyped; Load/Store at byte offsets and reinterpret with asfloat/asuint
+[[vk::binding(2, 1)]] RWByteAddressBuffer gRWBuffers[];
+
+#endif // DESCRIPTOR_HEAP_HLSLI
@@ -0,0 +1,35 @@
+# Generates a C++ translation unit that embeds SPIR-V binaries as aligned uint32_t arrays.
+# Usage: cmake -DOUTPUT=<file.cpp> -DSPIRV_FILES=<a.spv;b.spv;...> -P embed_spirv.cmake
+
+set(ARRAYS "")
+set(TABLE "")
+foreach(SPIRV_FILE IN LISTS SPIRV_FILES)
+    get_filename_component(FILE_NAME ${SPIRV_FILE} NAME)
+    string(MAKE_C_IDENTIFIER ${FILE_NAME} IDENTIFIER)
+
+    file(READ ${SPIRV_FILE} HEX_CONTENTS HEX)
+    string(LENGTH "${HEX_CONTENTS}" HEX_LENGTH)
+    math(EXPR REMAINDER "${HEX_LENGTH} % 8")
+    if (HEX_LENGTH EQUAL 0 OR NOT REMAINDER EQUAL 0)
+        message(FATAL_ERROR "${SPIRV_FILE} is not a valid SPIR-V binary")
+    endif()
+
+    # SPIR-V is a stream of little-endian 32-bit words, so swap the bytes of every 8 hex digits
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])" "0x\\4\\3\\2\\1," WORDS "${HEX_CONTENTS}")
+    # CMake's regex has no {n} quantifier, so spell out 8 words per line
+    set(WORD "0x[0-9a-f]+,")
+    string(REGEX REPLACE "(${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD})" "\\1\n    " WORDS "${WORDS}")
+
+    string(APPEND ARRAYS "alignas(16) static constexpr uint32_t k_${IDENTIFIER}[] = {\n    ${WORDS}\n};\n\n")
+    string(APPEND TABLE "    { \"${FILE_NAME}\", k_${IDENTIFIER} },\n")
+endforeach()
+
+set(CONTENTS "// Generated by embed_spirv.cmake, do not edit.\n#include \"shaders/embedded_shaders.h\"\n\n")
+string(APPEND CONTENTS "${ARRAYS}")
+string(APPEND CONTENTS "static constexpr EmbeddedShader kEmbeddedShaders[] = {\n${TABLE}};\n\n")
+string(APPEND CONTENTS "std::span<const EmbeddedShader> GetEmbeddedShaders() { return kEmbeddedShaders; }\n")
+
+# Only touch the output if it changed, so unchanged shaders don't trigger a rebuild of the executable
+file(WRITE "${OUTPUT}.tmp" "${CONTENTS}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+
+struct EmbeddedShader {
+    std::string_view filename; // File name of the compiled shader, e.g. "ocean.vs.spv"
+    std::span<const uint32_t> code;
+};
+
+// Every shader compiled by the Shaders_SPIRV target. Defined in a translation unit generated at build time.
+std::span<const EmbeddedShader> GetEmbeddedShaders();
\ No newline at end of file
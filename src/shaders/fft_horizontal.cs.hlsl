@@ -1,10 +1,11 @@
-[[vk::binding(0, 0)]] Texture2D<float4> gInput;
-[[vk::binding(1, 0)]] RWTexture2D<float4> gOutput;
+#include "shaders/simulation.hlsli"
+#include "shaders/descriptor_heap.hlsli"
 
 // Uniform variables
 struct Params {
-    int totalCount;
     int subseqCount;
+    uint inputIndex;
+    uint outputIndex;
 };
 [[vk::push_constant]] Params gParams;
 
@@ -21,27 +22,30 @@ static inline float4 ButterflyOperation(float2 a, float2 b, float2 twiddle)
 	return float4(a + twiddleB, a - twiddleB);
 }
 
-[numthreads(256, 1, 1)]
+[numthreads(FFT_WORKGROUP_SIZE, 1, 1)]
 void main(uint3 groupId : SV_GroupID, uint3 groupThreadId : SV_GroupThreadID)
 {
-    const uint2 pixelCoord = uint2(groupThreadId.x, groupId.x);
+    const int row = int(groupId.x);
+    const int butterflyCount = kTexSize / 2;
+    const Texture2D<float4> input = gTexturesFloat4[gParams.inputIndex];
+    RWTexture2D<float4> output = gRWTexturesFloat4[gParams.outputIndex];
 
-    const int threadCount = int(gParams.totalCount * 0.5f);
-    const int threadIdx = int(pixelCoord.x);
+    // Every thread strides over the butterflies of the row; the count is a specialization constant so this unrolls
+    for (int threadIdx = int(groupThreadId.x); threadIdx < butterflyCount; threadIdx += FFT_WORKGROUP_SIZE) {
+        const int inIdx = threadIdx & (gParams.subseqCount - 1);
+        const int outIdx = ((threadIdx - inIdx) << 1) + inIdx;
 
-    const int inIdx = threadIdx & (gParams.subseqCount - 1);        
-    const int outIdx = ((threadIdx - inIdx) << 1) + inIdx;
+        const float angle = -PI * (float(inIdx) / float(gParams.subseqCount));
+        const float2 twiddle = float2(cos(angle), sin(angle));
 
-    const float angle = -PI * (float(inIdx) / float(gParams.subseqCount));
-    const float2 twiddle = float2(cos(angle), sin(angle));
+        const float4 a = input.Load(int3(threadIdx, row, 0));
+        const float4 b = input.Load(int3(threadIdx + butterflyCount, row, 0));
 
-    const float4 a = gInput.Load(int3(pixelCoord, 0));
-    const float4 b = gInput.Load(int3(pixelCoord.x + threadCount, pixelCoord.y, 0));
+        // Transforming two complex sequences independently and simultaneously
+        const float4 result0 = ButterflyOperation(a.xy, b.xy, twiddle);
+        const float4 result1 = ButterflyOperation(a.zw, b.zw, twiddle);
 
-    // Transforming two complex sequences independently and simultaneously
-    const float4 result0 = ButterflyOperation(a.xy, b.xy, twiddle);
-	const float4 result1 = ButterflyOperation(a.zw, b.zw, twiddle);
-
-    gOutput[uint2(outIdx, pixelCoord.y)] = float4(result0.xy, result1.xy);
-    gOutput[uint2(outIdx + gParams.subseqCount, pixelCoord.y)] = float4(result0.zw, result1.zw);
+        output[uint2(outIdx, row)] = float4(result0.xy, result1.xy);
+        output[uint2(outIdx + gParams.subseqCount, row)] = float4(result0.zw, result1.zw);
+    }
 }
\ No newline at end of file
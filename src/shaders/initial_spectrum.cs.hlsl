@@ -1,9 +1,9 @@
-[[vk::binding(0, 0)]] RWTexture2D<float> gOutInitialSpectrum;
+#include "shaders/simulation.hlsli"
+#include "shaders/descriptor_heap.hlsli"
 
 struct Params {
     float2 windDirection;
-    int texSize;
-    int oceanSize;
+    uint outInitialSpectrumIndex;
 };
 [[vk::push_constant]] Params gParams;
 
@@ -22,10 +22,10 @@ static inline float square(float x)
     return x * x;
 }
 
-[numthreads(32, 32, 1)]
+[numthreads(WORKGROUP_SIZE_X, WORKGROUP_SIZE_Y, 1)]
 void main(uint3 id : SV_DispatchThreadID)
 {
-    float2 waveVector = (2.0 * PI * float2(id.xy)) / gParams.oceanSize;
+    float2 waveVector = (2.0 * PI * float2(id.xy)) / kOceanSize;
     float k = length(waveVector);
 
     float U10 = length(gParams.windDirection);
@@ -59,10 +59,10 @@ void main(uint3 id : SV_DispatchThreadID)
 
     float S = (1.0 / (2.0 * PI)) * pow(k, -4.0) * (Bl + Bh) * (1.0 + Delta * (2.0 * cosPhi * cosPhi - 1.0));
 
-    float dk = 2.0 * PI / gParams.oceanSize;
+    float dk = 2.0 * PI / kOceanSize;
     float h = sqrt(S / 2.0) * dk;
 
     if (waveVector.x == 0.0 && waveVector.y == 0.0) h = 0.0f;
 
-    gOutInitialSpectrum[id.xy] = h;
+    gRWTexturesFloat[gParams.outInitialSpectrumIndex][id.xy] = h;
 }
\ No newline at end of file
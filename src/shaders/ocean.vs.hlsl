@@ -1,6 +1,9 @@
 struct VSInput {
     float3 worldPos : POSITION0;
     float2 uv       : TEXCOORD0;
+
+    // Per-instance
+    float2 tileOffset : TEXCOORD1;
 };
 
 struct VSOutput {
@@ -35,7 +38,9 @@ VSOutput main(VSInput input)
 
     // Calculate the displaced position
     const float3 displacement = gDisplacementMapTexture.SampleLevel(gDisplacementMapSampler, input.uv, 0).rgb;
-    const float3 displacedPosition = input.worldPos + gConsts.displacementScaleFactor * displacement;
+    // Tiles are offset by whole texture periods, so the displacement lookup is shared by all of them
+    const float3 worldPos = input.worldPos + float3(input.tileOffset.x, 0.0f, input.tileOffset.y);
+    const float3 displacedPosition = worldPos + gConsts.displacementScaleFactor * displacement;
 
     // Output the final position and transformed position
     output.position = mul(gConsts.worldToClip, float4(displacedPosition, 1.0f));
@@ -1,10 +1,10 @@
-[[vk::binding(0, 0)]] Texture2D<float> gPhase;
-[[vk::binding(1, 0)]] RWTexture2D<float> gOutDeltaPhase;
+#include "shaders/simulation.hlsli"
+#include "shaders/descriptor_heap.hlsli"
 
 struct Params {
     float dt;
-    int texSize;
-    int oceanSize;
+    uint phaseIndex;
+    uint outDeltaPhaseIndex;
 };
 [[vk::push_constant]] Params gParams;
 
@@ -17,11 +17,11 @@ static inline float Omega(float k)
     return sqrt(g * k * (1.0f + k * k / (KM * KM)));
 }
 
-[numthreads(32, 32, 1)]
+[numthreads(WORKGROUP_SIZE_X, WORKGROUP_SIZE_Y, 1)]
 void main(uint3 id : SV_DispatchThreadID)
 {
-    float2 waveVector = (2.0f * PI * float2(id.xy)) / gParams.oceanSize;
+    float2 waveVector = (2.0f * PI * float2(id.xy)) / kOceanSize;
     float deltaPhase = Omega(length(waveVector)) * gParams.dt;
-    float phase = gPhase.Load(int3(id.xy, 0));
-    gOutDeltaPhase[id.xy] = fmod(phase + deltaPhase, 2.0f * PI);
+    float phase = gTexturesFloat[gParams.phaseIndex].Load(int3(id.xy, 0));
+    gRWTexturesFloat[gParams.outDeltaPhaseIndex][id.xy] = fmod(phase + deltaPhase, 2.0f * PI);
 }
\ No newline at end of file
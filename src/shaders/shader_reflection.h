@@ -0,0 +1,16 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+// Layout of a shader, reflected from its SPIR-V at build time by tools/shader_reflect.cpp.
+// The generated "shaders/shader_layouts.h" has one namespace per shader (e.g. `ocean_vs`) holding its
+// `kReflection`, its binding indices (e.g. `kDisplacementMapTextureBinding`) and its `PushConstants` struct.
+struct ShaderReflection {
+    std::string_view filename; // File name of the compiled shader, e.g. "ocean.vs.spv"
+    VkShaderStageFlags stage = 0;
+    std::span<const VkDescriptorSetLayoutBinding> layoutBindings;
+    VkPushConstantRange pushConstants = {}; // Zero-sized if the shader has no push constants
+};
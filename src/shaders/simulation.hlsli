@@ -0,0 +1,23 @@
+#ifndef SIMULATION_HLSLI
+#define SIMULATION_HLSLI
+
+// Sizes of the simulation, set as specialization constants when the pipelines are created so the compiler can fold
+// the index math and unroll loops. The IDs must match `SimulationConstantId` in ocean/ocean.h.
+[[vk::constant_id(0)]] const int kTexSize = 512;    // Resolution N of the simulation textures
+[[vk::constant_id(1)]] const int kOceanSize = 1024; // World-space size of the simulated patch
+
+// DXC can't size workgroups with specialization constants, so the workgroup shape is a compile-time define instead.
+// shaders/CMakeLists.txt compiles a variant per size in kWorkGroupDims and kFFTWorkGroupSizes (see main.cpp),
+// and the WorkgroupTuner picks the fastest one at startup.
+#ifndef WORKGROUP_SIZE_X
+#define WORKGROUP_SIZE_X 32
+#endif
+#ifndef WORKGROUP_SIZE_Y
+#define WORKGROUP_SIZE_Y 32
+#endif
+// Threads per row (or column) of an FFT pass; every thread strides over the kTexSize / 2 butterflies of it
+#ifndef FFT_WORKGROUP_SIZE
+#define FFT_WORKGROUP_SIZE 256
+#endif
+
+#endif // SIMULATION_HLSLI
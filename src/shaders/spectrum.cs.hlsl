@@ -1,11 +1,11 @@
-[[vk::binding(0, 0)]] Texture2D<float> gPhase;
-[[vk::binding(1, 0)]] Texture2D<float> gInitialSpectrum;
-[[vk::binding(2, 0)]] RWTexture2D<float4> gOutSpectrum;
+#include "shaders/simulation.hlsli"
+#include "shaders/descriptor_heap.hlsli"
 
 struct Params {
-    int texSize;
-    int oceanSize;
     float choppiness;
+    uint phaseIndex;
+    uint initialSpectrumIndex;
+    uint outSpectrumIndex;
 };
 [[vk::push_constant]] Params gParams;
 
@@ -28,17 +28,18 @@ static inline float omega(float k)
     return sqrt(g * k * (1.0f + k * k / (KM * KM)));
 }
 
-[numthreads(32, 32, 1)]
+[numthreads(WORKGROUP_SIZE_X, WORKGROUP_SIZE_Y, 1)]
 void main(uint3 id : SV_DispatchThreadID)
 {
-    float2 waveVector = (2.0f * PI * float2(id.xy)) / gParams.oceanSize;
+    const Texture2D<float> initialSpectrum = gTexturesFloat[gParams.initialSpectrumIndex];
+    float2 waveVector = (2.0f * PI * float2(id.xy)) / kOceanSize;
 
-    float phase = gPhase.Load(int3(id.xy, 0));
+    float phase = gTexturesFloat[gParams.phaseIndex].Load(int3(id.xy, 0));
     float2 phaseVector = float2(cos(phase), sin(phase));
 
-    float2 h0 = float2(gInitialSpectrum.Load(int3(id.xy, 0)), 0.0f);
-    int2 h0StarIdx = int2(gParams.texSize.xx - id.xy) % int2(gParams.texSize.xx - 1);
-    float2 h0Star = float2(gInitialSpectrum.Load(int3(h0StarIdx, 0)), 0.0f);
+    float2 h0 = float2(initialSpectrum.Load(int3(id.xy, 0)), 0.0f);
+    int2 h0StarIdx = (int2(kTexSize, kTexSize) - int2(id.xy)) % (kTexSize - 1);
+    float2 h0Star = float2(initialSpectrum.Load(int3(h0StarIdx, 0)), 0.0f);
     h0Star.y *= -1.0f;
 
     float2 h = multiplyComplex(h0, phaseVector) + multiplyComplex(h0Star, float2(phaseVector.x, -phaseVector.y));
@@ -53,5 +54,5 @@ void main(uint3 id : SV_DispatchThreadID)
         hZ = float2(0.0f, 0.0f);
     }
 
-    gOutSpectrum[id.xy] = float4(hX + multiplyByI(h), hZ);
+    gRWTexturesFloat4[gParams.outSpectrumIndex][id.xy] = float4(hX + multiplyByI(h), hZ);
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "shaders/simulation.hlsli"
+#include "shaders/descriptor_heap.hlsli"
+
+// Must match kWaveQueryWorkGroupSize in ocean/wave_queries.cpp
+#define WAVE_QUERY_WORKGROUP_SIZE 64
+// Fixed-point iterations inverting the horizontal displacement; each one shrinks the error by the choppiness slope,
+// which stays well below one unless the surface folds over
+#define INVERSION_ITERATION_COUNT 4
+
+struct Params {
+    uint queryCount;
+    uint positionsIndex;        // float2 world-space XZ per query
+    uint outResultsIndex;       // float4 (height, normal) per query
+    uint displacementMapIndex;
+    uint normalMapIndex;
+    float displacementScaleFactor;
+    float uvScale;              // Texture coordinates per world unit, as sampled by ocean.vs.hlsl
+};
+[[vk::push_constant]] Params gParams;
+
+// Bilinear lookup that wraps around like the samplers of the simulation textures, which the heap doesn't have
+static float4 SampleWrapped(Texture2D<float4> map, float2 uv)
+{
+    const float2 texel = uv * kTexSize - 0.5f;
+    const int2 base = int2(floor(texel));
+    const float2 weights = texel - float2(base);
+    // The texture size is a power of two, so masking wraps negative coordinates too
+    const int mask = kTexSize - 1;
+    const float4 s00 = map.Load(int3(base & mask, 0));
+    const float4 s10 = map.Load(int3((base + int2(1, 0)) & mask, 0));
+    const float4 s01 = map.Load(int3((base + int2(0, 1)) & mask, 0));
+    const float4 s11 = map.Load(int3((base + int2(1, 1)) & mask, 0));
+    return lerp(lerp(s00, s10, weights.x), lerp(s01, s11, weights.x), weights.y);
+}
+
+[numthreads(WAVE_QUERY_WORKGROUP_SIZE, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    if (id.x >= gParams.queryCount) return;
+    const Texture2D<float4> displacementMap = gTexturesFloat4[gParams.displacementMapIndex];
+    const Texture2D<float4> normalMap = gTexturesFloat4[gParams.normalMapIndex];
+    const float2 position = asfloat(gRWBuffers[gParams.positionsIndex].Load2(id.x * 8));
+
+    // The surface point above `position` was displaced there from another point of the undisplaced grid;
+    // find it by solving gridPosition + displacement(gridPosition).xz = position
+    float2 gridPosition = position;
+    float3 displacement = float3(0.0f, 0.0f, 0.0f);
+    for (int iteration = 0; iteration < INVERSION_ITERATION_COUNT; ++iteration) {
+        displacement = gParams.displacementScaleFactor * SampleWrapped(displacementMap, gridPosition * gParams.uvScale).xyz;
+        gridPosition = position - displacement.xz;
+    }
+    displacement = gParams.displacementScaleFactor * SampleWrapped(displacementMap, gridPosition * gParams.uvScale).xyz;
+    const float3 normal = normalize(SampleWrapped(normalMap, gridPosition * gParams.uvScale).xyz);
+
+    gRWBuffers[gParams.outResultsIndex].Store4(id.x * 16, asuint(float4(displacement.y, normal)));
+}
@@ -0,0 +1,36 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    assert(threadCount > 0u);
+    mThreads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        mThreads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(mMutex);
+        mIsStopping = true;
+    }
+    mCondition.notify_all();
+    // Workers drain the remaining tasks before they exit
+    for (auto& thread : mThreads) thread.join();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mMutex);
+            mCondition.wait(lock, [this]() { return mIsStopping || !mTasks.empty(); });
+            if (mTasks.empty()) return;
+            task = std::move(mTasks.front());
+            mTasks.pop();
+        }
+        task();
+    }
+}
\ No newline at end of file
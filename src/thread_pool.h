@@ -0,0 +1,40 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <future>
+
+// Fixed set of worker threads that run submitted tasks in FIFO order
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency()));
+    ~ThreadPool();
+
+    template<typename F>
+    auto Submit(F&& task) -> std::future<std::invoke_result_t<F>>
+    {
+        // std::function needs a copyable callable, so the (move-only) packaged task is shared
+        using ResultType = std::invoke_result_t<F>;
+        auto packagedTask = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(task));
+        std::future<ResultType> future = packagedTask->get_future();
+        {
+            std::lock_guard lock(mMutex);
+            mTasks.push([packagedTask]() { (*packagedTask)(); });
+        }
+        mCondition.notify_one();
+        return future;
+    }
+
+    uint32_t GetThreadCount() const { return uint32_t(mThreads.size()); }
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> mThreads;
+    std::queue<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mIsStopping = false;
+};
\ No newline at end of file
@@ -21,6 +21,18 @@ constexpr auto enumerate(T&& iterable)
     return iterable_wrapper{ std::forward<T>(iterable) };
 }
 
+template <class T>
+inline void HashCombine(std::size_t& seed, const T& v)
+{
+    constexpr std::size_t kMul = 0x9ddfea08eb382d69ULL;
+    std::hash<T> hasher;
+    std::size_t a = (hasher(v) ^ seed) * kMul;
+    a ^= (a >> 47);
+    std::size_t b = (seed ^ a) * kMul;
+    b ^= (b >> 47);
+    seed = b * kMul;
+}
+
 static inline std::string ReadFile(const std::string_view& path)
 {
     std::ifstream file = std::ifstream(path.data());
@@ -37,12 +49,28 @@ static inline std::string ReadFile(const std::string_view& path)
 
 static inline std::string ReadSourceFile(const std::string_view& filename)
 {
-    std::ifstream file(filename.data());
-    if(!file.good()) return "";
-    // Found usable source file
-    std::stringstream source_buffer;
-    source_buffer << file.rdbuf();
-    return source_buffer.str();
+    std::ifstream file(filename.data(), std::ios::binary | std::ios::ate);
+    if (!file.good()) {
+        LOG_WARN("Could not open file '{}' (working directory: '{}')", filename, std::filesystem::current_path().string());
+        return "";
+    }
+    // Read straight into the string instead of copying through a stream buffer
+    std::string source(size_t(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(source.data(), source.size());
+    return source;
+}
+
+// Contents of a JSON string literal holding `string`
+static inline std::string EscapeJson(std::string_view string)
+{
+    std::string escaped;
+    for (char c : string) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        if (uint8_t(c) < 0x20u) escaped += fmt::format("\\u{:04x}", uint8_t(c));
+        else escaped += c;
+    }
+    return escaped;
 }
 
 template<typename T>
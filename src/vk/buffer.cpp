@@ -3,6 +3,9 @@
 #include "vk/command_list.h"
 #include "vk/common.h"
 #include "vk/descs_conversions.h"
+#include "vk/descriptor_heap.h"
+#include "vk/memory_tracker.h"
+#include "vk/deletion_queue.h"
 
 Buffer::Buffer(const Device& device, BufferDesc desc)
     : mDevice(device), mByteSize(desc.byteSize)
@@ -15,28 +18,41 @@ Buffer::Buffer(const Device& device, BufferDesc desc)
         .usage = GetVkBufferUsageFlags(desc.usage),
         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
     };
-    const VmaAllocationCreateInfo allocationCreateInfo = {
+    VmaAllocationCreateInfo allocationCreateInfo = {
         .usage = VMA_MEMORY_USAGE_AUTO,
         // This enables only sequential writes into this memory,
         // so if we end up needing random access, use VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT.
         .flags = desc.access == MemoryAccess::HOST ? VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT : 0u,
     };
+    // Reading uncached memory from the host is very slow, so readback buffers prefer cached memory
+    if (desc.access == MemoryAccess::READBACK) {
+        allocationCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+        allocationCreateInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    }
     VK_CHECK(vmaCreateBuffer(device.Allocator(), &bufferCreateInfo, &allocationCreateInfo, &mBuffer, &mAllocation, nullptr));
+    device.GetMemoryTracker().Track(mAllocation, desc.category, desc.debugName);
+    device.SetDebugName(VK_OBJECT_TYPE_BUFFER, uint64_t(mBuffer), desc.debugName);
+
+    if (IsSet(desc.usage, BufferUsageBits::STORAGE)) {
+        mStorageIndex = device.GetDescriptorHeap().AllocateBuffer(mBuffer);
+    }
 
     // Persistently mapped memory
-    if (desc.access == MemoryAccess::HOST) {
+    if (desc.access == MemoryAccess::HOST || desc.access == MemoryAccess::READBACK) {
         vmaMapMemory(device.Allocator(), mAllocation, &mMappedData);
     }
 
     if (desc.data) {
-        if (desc.access == MemoryAccess::HOST) {
+        if (mMappedData) {
             memcpy(mMappedData, desc.data, mByteSize);
         }
         else {
             const Buffer stagingBuffer = Buffer(device, {
                 .byteSize = desc.byteSize,
                 .access = MemoryAccess::HOST,
-                .data = desc.data
+                .data = desc.data,
+                .debugName = "Buffer upload",
+                .category = MemoryCategory::STAGING,
             });
             Handle<CommandList> cmdList = device.CreateCommandList();
             cmdList->Open();
@@ -47,10 +63,22 @@ Buffer::Buffer(const Device& device, BufferDesc desc)
     }
 }
 
+void Buffer::InvalidateMappedRange(uint64_t offsetBytes, uint64_t byteSize) const
+{
+    assert(mMappedData != nullptr);
+    VK_CHECK(vmaInvalidateAllocation(mDevice.Allocator(), mAllocation, offsetBytes, byteSize));
+}
+
 Buffer::~Buffer()
 {
-    if (mMappedData) {
-        vmaUnmapMemory(mDevice.Allocator(), mAllocation);
-    }
-    vmaDestroyBuffer(mDevice.Allocator(), mBuffer, mAllocation);
+    // Frames in flight may still access the buffer, also through its descriptor
+    mDevice.GetDeletionQueue().Push([&device = mDevice, buffer = mBuffer, allocation = mAllocation,
+        isMapped = mMappedData != nullptr, storageIndex = mStorageIndex]() {
+        device.GetDescriptorHeap().Free(DescriptorHeapBinding::STORAGE_BUFFER, storageIndex);
+        if (isMapped) {
+            vmaUnmapMemory(device.Allocator(), allocation);
+        }
+        device.GetMemoryTracker().Untrack(allocation);
+        vmaDestroyBuffer(device.Allocator(), buffer, allocation);
+    });
 }
\ No newline at end of file
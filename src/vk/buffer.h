@@ -8,6 +8,8 @@ struct BufferDesc {
 	MemoryAccess access = MemoryAccess::DEVICE;     // Buffer memory access.
 	BufferUsageBits usage = BufferUsageBits::NONE;  // Buffer usage flags.
 	const void* data = nullptr;                           // [Optional] Initial buffer contents.
+	const char* debugName = nullptr;                      // [Optional] Names the allocation in memory reports and debuggers.
+	MemoryCategory category = MemoryCategory::OTHER;      // What the memory is accounted to in memory reports.
 };
 
 class Device;
@@ -21,6 +23,11 @@ public:
 
     VkDeviceSize GetSizeInBytes() const { return mByteSize; }
     void* GetMappedData() const { return mMappedData; }
+    // Makes device writes to the mapped range visible to the host; only needed for READBACK buffers, whose memory
+    // may be cached but not coherent
+    void InvalidateMappedRange(uint64_t offsetBytes, uint64_t byteSize) const;
+    // Index into the descriptor heap; only valid for storage buffers
+    uint32_t GetStorageIndex() const { assert(mStorageIndex != ~0u); return mStorageIndex; }
 
 private:
     const Device& mDevice;
@@ -28,6 +35,7 @@ private:
 	VkBuffer mBuffer = VK_NULL_HANDLE;
 	VmaAllocation mAllocation = VK_NULL_HANDLE;
 	void* mMappedData = nullptr;
+	uint32_t mStorageIndex = ~0u;
 
     // ResourceStateBits mResourceMask = ResourceStateBits::COMMON;
     VkAccessFlags mAccessMask = VK_ACCESS_NONE;
@@ -7,6 +7,8 @@
 #include "vk/texture.h"
 #include "vk/pipeline.h"
 #include "vk/device.h"
+#include "vk/query_pool.h"
+#include "vk/deletion_queue.h"
 
 #include "logger.h"
 
@@ -20,7 +22,8 @@ Binding::Binding(const Texture& texture)
     imageInfo = { .sampler = texture.GetSampler(), .imageView = texture.GetView(), .imageLayout = texture.GetLayout() };
 }
 
-CommandList::CommandList(const Device& device) : mDevice(device)
+CommandList::CommandList(const Device& device, VkCommandBuffer pooledCmdBuf)
+    : mDevice(device), mCmdBuf(pooledCmdBuf), mIsPooled(pooledCmdBuf != VK_NULL_HANDLE)
 {
 }
 
@@ -43,7 +46,8 @@ void CommandList::Open()
         mCmdBuf = this->CreateCommandBuffer();
     }
     else {
-        VK_CHECK(vkResetCommandBuffer(mCmdBuf, 0u));
+        // The device's pool can't reset command buffers one by one; pooled ones are reset with their pool
+        assert(mIsPooled);
     }
     // Record commands
     const VkCommandBufferBeginInfo beginInfo = {
@@ -57,17 +61,24 @@ void CommandList::Close()
 {
     assert(mCmdBuf != VK_NULL_HANDLE);
 
+    assert(mActiveQueryCount == 0u); // Queries must end in the command buffer they began in
     this->EndRendering();
+    this->FlushBarriers(kShaderStages);
     VK_CHECK(vkEndCommandBuffer(mCmdBuf));
 }
 
 CommandList::~CommandList()
 {
-    vkFreeCommandBuffers(mDevice, mDevice.GetCommandPool(), 1, &mCmdBuf);
+    if (mCmdBuf == VK_NULL_HANDLE || mIsPooled) return;
+    // The command buffer may still be pending execution
+    mDevice.GetDeletionQueue().Push([&device = mDevice, cmdBuf = mCmdBuf]() {
+        vkFreeCommandBuffers(device, device.GetCommandPool(), 1, &cmdBuf);
+    });
 }
 
 void CommandList::CopyBuffer(Buffer* dest, uint64_t destOffsetBytes, const Buffer& src, uint64_t srcOffsetBytes, uint64_t dataSizeBytes)
 {
+    this->FlushBarriers(VK_PIPELINE_STAGE_2_NONE);
     const VkBufferCopy copyRegion = { .size = dataSizeBytes, .srcOffset = srcOffsetBytes, .dstOffset = destOffsetBytes };
     vkCmdCopyBuffer(mCmdBuf, src, *dest, 1, &copyRegion);
 }
@@ -75,8 +86,8 @@ void CommandList::CopyBuffer(Buffer* dest, uint64_t destOffsetBytes, const Buffe
 void CommandList::WriteTexture(Texture* dest, const Buffer& src)
 {
     assert(dest->GetImage() != VK_NULL_HANDLE && src.GetVkBuffer() != VK_NULL_HANDLE);
+    this->FlushBarriers(VK_PIPELINE_STAGE_2_NONE);
 
-    const auto& texState = ConvertResourceState(dest->mResourceMask);
     const glm::uvec3 texSize = dest->GetSize();
     const VkBufferImageCopy bufferCopyRegion = {
         .imageSubresource = { .aspectMask = GetAspectMask(dest->GetFormat()), .layerCount = 1 },
@@ -91,13 +102,50 @@ void CommandList::WriteTexture(Texture* dest, const Buffer& src)
     );
 }
 
+void CommandList::ReadTexture(Buffer* dest, uint64_t destOffsetBytes, const Texture& src)
+{
+    assert(src.GetImage() != VK_NULL_HANDLE && dest->GetVkBuffer() != VK_NULL_HANDLE);
+    assert(IsSet(src.mResourceMask, ResourceStateBits::COPY_SOURCE));
+    this->EndRendering();
+    this->FlushBarriers(VK_PIPELINE_STAGE_2_NONE);
+
+    const glm::uvec3 texSize = src.GetSize();
+    const VkBufferImageCopy bufferCopyRegion = {
+        .bufferOffset = destOffsetBytes,
+        .imageSubresource = { .aspectMask = GetAspectMask(src.GetFormat()), .layerCount = 1 },
+        .imageExtent = { .width = texSize.x, .height = texSize.y, .depth = texSize.z }
+    };
+    vkCmdCopyImageToBuffer(mCmdBuf, src.GetImage(), src.GetLayout(), *dest, 1, &bufferCopyRegion);
+}
+
+void CommandList::SetMemoryBarrier(VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess)
+{
+    this->EndRendering();
+    this->FlushBarriers(VK_PIPELINE_STAGE_2_NONE);
+    const VkMemoryBarrier2 memoryBarrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = srcStages,
+        .srcAccessMask = srcAccess,
+        .dstStageMask = dstStages,
+        .dstAccessMask = dstAccess,
+    };
+    const VkDependencyInfo dependencyInfo = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &memoryBarrier,
+    };
+    vkCmdPipelineBarrier2(mCmdBuf, &dependencyInfo);
+}
+
 void CommandList::Draw(const DrawArguments& args)
 {
+    assert(mPendingBarriers.empty()); // Flushed when the graphics state was set; barriers can't be recorded while rendering
     vkCmdDraw(mCmdBuf, args.vertexCount, args.instanceCount, args.startVertexLocation, args.startInstanceLocation);
 }
 
 void CommandList::DrawIndexed(const DrawArguments& args)
 {
+    assert(mPendingBarriers.empty()); // Flushed when the graphics state was set; barriers can't be recorded while rendering
     vkCmdDrawIndexed(mCmdBuf, args.vertexCount, args.instanceCount, args.startIndexLocation, args.startVertexLocation, args.startInstanceLocation);
 }
 
@@ -107,35 +155,119 @@ void CommandList::SetResourceState(Texture& texture, ResourceStateBits dstResour
 
     const auto& srcState = ConvertResourceState(texture.mResourceMask);
     const auto& dstState = ConvertResourceState(dstResourceMask);
-    const VkImageMemoryBarrier imageMemoryBarrier = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .srcAccessMask = srcState.accessMask,
-        .dstAccessMask = dstState.accessMask,
-        .oldLayout = srcState.imageLayout,
-        .newLayout = dstState.imageLayout,
-        .image = texture.mImage,
-        .subresourceRange = {
-            .aspectMask = GetAspectMask(texture.mFormat),
-            .baseMipLevel = texture.mMipIndex,
-            .levelCount = texture.mMipCount,
-            .baseArrayLayer = 0u,
-            .layerCount = 1u,
-        },
-    };
-    vkCmdPipelineBarrier(
-        mCmdBuf,
-        srcState.stageFlags,
-        dstState.stageFlags,
-        0u,
-        0u, nullptr,
-        0u, nullptr,
-        1u, &imageMemoryBarrier
-    );
+    // Reads after reads in the same layout don't need to wait, as long as the last barrier already made the texture
+    // visible to the reading stages. Otherwise the barrier below chains to that one, from the stages it covered.
+    const bool isReadAfterRead = IsReadOnlyResourceState(texture.mResourceMask) && IsReadOnlyResourceState(dstResourceMask);
+    const bool isVisibleToStages = (dstState.stageFlags & ~texture.mStageMask) == VK_PIPELINE_STAGE_2_NONE;
+    if (isReadAfterRead && srcState.imageLayout == dstState.imageLayout && isVisibleToStages) {
+        texture.mResourceMask = dstResourceMask;
+        return;
+    }
+
+    // A texture that's transitioned again before the barriers are flushed keeps its original source
+    auto pendingBarrier = std::find_if(mPendingBarriers.begin(), mPendingBarriers.end(), [&](const PendingBarrier& pending) {
+        return pending.texture == &texture;
+    });
+    if (pendingBarrier == mPendingBarriers.end()) {
+        mPendingBarriers.push_back({
+            .texture = &texture,
+            .barrier = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .srcStageMask = texture.mStageMask,
+                .srcAccessMask = srcState.accessMask | texture.mAliasAccessMask,
+                .oldLayout = srcState.imageLayout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = texture.mImage,
+                .subresourceRange = {
+                    .aspectMask = GetAspectMask(texture.mFormat),
+                    .baseMipLevel = texture.mMipIndex,
+                    .levelCount = texture.mMipCount,
+                    .baseArrayLayer = 0u,
+                    .layerCount = 1u,
+                },
+            },
+        });
+        pendingBarrier = std::prev(mPendingBarriers.end());
+        texture.mAliasAccessMask = VK_ACCESS_2_NONE;
+    }
+    pendingBarrier->barrier.dstStageMask = dstState.stageFlags;
+    pendingBarrier->barrier.dstAccessMask = dstState.accessMask;
+    pendingBarrier->barrier.newLayout = dstState.imageLayout;
     texture.mResourceMask = dstResourceMask;
 }
 
+void CommandList::AliasTexture(Texture& texture, const Texture* previousTexture)
+{
+    assert(std::none_of(mPendingBarriers.begin(), mPendingBarriers.end(), [&](const PendingBarrier& pending) {
+        return pending.texture == &texture;
+    }));
+    texture.mResourceMask = ResourceStateBits::COMMON; // Transitions from an undefined layout
+    texture.mStageMask = previousTexture != nullptr ? previousTexture->mStageMask : VK_PIPELINE_STAGE_2_NONE;
+    // Writes to the same memory through the previous alias must be made available before this one is written
+    const bool isPreviousWrite = previousTexture != nullptr && !IsReadOnlyResourceState(previousTexture->mResourceMask);
+    texture.mAliasAccessMask = isPreviousWrite ? ConvertResourceState(previousTexture->mResourceMask).accessMask : VK_ACCESS_2_NONE;
+}
+
+void CommandList::FlushBarriers(VkPipelineStageFlags2 shaderStages)
+{
+    if (mPendingBarriers.empty()) return;
+    assert(!mIsRendering);
+
+    std::vector<VkImageMemoryBarrier2> imageMemoryBarriers;
+    imageMemoryBarriers.reserve(mPendingBarriers.size());
+    for (auto& [texture, barrier] : mPendingBarriers) {
+        // Only narrow the shader stages if the resource is used by this pipeline at all, e.g. not for a copy.
+        // Read-only states keep all their stages, so later reads in other stages can skip their barrier.
+        const VkPipelineStageFlags2 usedShaderStages = barrier.dstStageMask & shaderStages;
+        if (usedShaderStages != VK_PIPELINE_STAGE_2_NONE && !IsReadOnlyResourceState(texture->mResourceMask)) {
+            barrier.dstStageMask = (barrier.dstStageMask & ~kShaderStages) | usedShaderStages;
+        }
+        texture->mStageMask = barrier.dstStageMask;
+        imageMemoryBarriers.push_back(barrier);
+    }
+    const VkDependencyInfo dependencyInfo = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .imageMemoryBarrierCount = uint32_t(imageMemoryBarriers.size()),
+        .pImageMemoryBarriers = imageMemoryBarriers.data(),
+    };
+    vkCmdPipelineBarrier2(mCmdBuf, &dependencyInfo);
+    mPendingBarriers.clear();
+}
+
+void CommandList::ResetQueries(QueryPool& queryPool, uint32_t firstQuery, uint32_t queryCount)
+{
+    this->EndRendering(); // Queries cannot be reset while we're rendering
+    vkCmdResetQueryPool(mCmdBuf, queryPool, firstQuery, queryCount);
+}
+
+void CommandList::BeginQuery(QueryPool& queryPool, uint32_t query)
+{
+    assert(queryPool.GetType() != QueryType::TIMESTAMP);
+    // Queries begin and end outside rendering, so they can span draws that each start their own rendering
+    this->EndRendering();
+    assert(!mIsRendering);
+    vkCmdBeginQuery(mCmdBuf, queryPool, query, 0u);
+    ++mActiveQueryCount;
+}
+
+void CommandList::EndQuery(QueryPool& queryPool, uint32_t query)
+{
+    assert(queryPool.GetType() != QueryType::TIMESTAMP);
+    assert(mActiveQueryCount > 0u);
+    // A query that spans several draws began outside rendering, so it must end outside too, not in the last draw's pass
+    this->EndRendering();
+    assert(!mIsRendering);
+    vkCmdEndQuery(mCmdBuf, queryPool, query);
+    --mActiveQueryCount;
+}
+
+void CommandList::WriteTimestamp(QueryPool& queryPool, uint32_t query)
+{
+    assert(queryPool.GetType() == QueryType::TIMESTAMP);
+    vkCmdWriteTimestamp(mCmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, query);
+}
+
 void CommandList::EndRendering()
 {
     if (mIsRendering) {
@@ -149,6 +281,8 @@ void CommandList::SetGraphicsState(const GraphicsState& state)
 {
     assert(state.pipeline != nullptr);
     assert(state.pipeline->GetPipelineType() == PipelineType::GRAPHICS);
+    this->EndRendering(); // Rendering can't be nested, so finish the previous pass first
+    this->FlushBarriers(VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
     mCurrentGraphicsState = state;
 
     uint32_t width = 0, height = 0;
@@ -180,6 +314,11 @@ void CommandList::SetGraphicsState(const GraphicsState& state)
         const VkDeviceSize offsets[] = { 0 };
         vkCmdBindVertexBuffers(mCmdBuf, 0, 1, vertexBuffers, offsets);
     }
+    if (state.instanceBuffer != nullptr) {
+        const VkBuffer instanceBuffers[] = { *state.instanceBuffer };
+        const VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(mCmdBuf, 1, 1, instanceBuffers, offsets);
+    }
     if (state.indexBuffer.buffer != nullptr) {
         vkCmdBindIndexBuffer(mCmdBuf,
             *state.indexBuffer.buffer,
@@ -234,7 +373,7 @@ void CommandList::SetGraphicsState(const GraphicsState& state)
     if(state.bindings.size() > 0) {
         state.pipeline->PushDescriptorSet(this, 0, (void*)state.bindings.begin());
     }
-    state.pipeline->Bind(this);
+    state.pipeline->Bind(this, state.fillMode);
 }
 
 
@@ -255,6 +394,6 @@ void CommandList::SetComputeState(const ComputeState& state)
 
 void CommandList::Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 {
+    this->FlushBarriers(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
     vkCmdDispatch(mCmdBuf, groupCountX, groupCountY, groupCountZ);
-    vkCmdPipelineBarrier(mCmdBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
 }
\ No newline at end of file
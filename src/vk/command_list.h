@@ -6,6 +6,7 @@ class Device;
 class Buffer;
 class Texture;
 class Pipeline;
+class QueryPool;
 
 struct DrawArguments {
     uint32_t vertexCount = 0;
@@ -54,6 +55,7 @@ struct IndexBuffer {
 
 struct GraphicsState {
     Handle<Pipeline> pipeline = nullptr;
+    RasterFillMode fillMode = RasterFillMode::SOLID; // Only used by pipelines with a dynamic fill mode
 
     ViewportState viewport = {};
     AttachmentList colorAttachments = {};
@@ -64,6 +66,7 @@ struct GraphicsState {
 
     IndexBuffer indexBuffer = {};
     Handle<Buffer> vertexBuffer = nullptr;
+    Handle<Buffer> instanceBuffer = nullptr; // Bound to vertex input binding 1
     Handle<Buffer> indirectParams = nullptr;
 };
 
@@ -76,7 +79,9 @@ struct ComputeState {
 
 class CommandList {
 public:
-    CommandList(const Device& device);
+    // Without a command buffer, one is allocated from the device's pool when the list is opened, and the list can
+    // only be recorded once, e.g. for uploads with Device::ExecuteCommandList; see CommandPool for lists of frames.
+    explicit CommandList(const Device& device, VkCommandBuffer pooledCmdBuf = VK_NULL_HANDLE);
     ~CommandList();
 
     void Open();
@@ -91,20 +96,46 @@ public:
     void CopyBuffer(Buffer* dest, uint64_t destOffsetBytes, const Buffer& src, uint64_t srcOffsetBytes, uint64_t dataSizeBytes);
 
     void WriteTexture(Texture* dest, const Buffer& src);
+    // Copies the whole texture into `dest` at `destOffsetBytes`, tightly packed; `src` must be in the COPY_SOURCE state
+    void ReadTexture(Buffer* dest, uint64_t destOffsetBytes, const Texture& src);
+    // Buffers don't track their state like textures, so accesses to them are ordered with global memory barriers
+    void SetMemoryBarrier(VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess);
 
     void SetGraphicsState(const GraphicsState& state);
     void SetComputeState(const ComputeState& state);
+    // Queues the transition; queued barriers are recorded together right before the next command that needs them
     void SetResourceState(Texture& texture, ResourceStateBits dstResourceMask);
+    // Starts using `texture` in the memory it shares with `previousTexture`, if any. Its contents are discarded,
+    // and its next transition waits for the last accesses of the previous texture.
+    void AliasTexture(Texture& texture, const Texture* previousTexture);
+
+    void ResetQueries(QueryPool& queryPool, uint32_t firstQuery, uint32_t queryCount);
+    // Both end the current rendering, so a query can count draws that each begin their own rendering
+    void BeginQuery(QueryPool& queryPool, uint32_t query);
+    void EndQuery(QueryPool& queryPool, uint32_t query);
+    // Writes the timestamp once all previously recorded commands have completed
+    void WriteTimestamp(QueryPool& queryPool, uint32_t query);
 
     operator VkCommandBuffer() const { return mCmdBuf; }
     VkCommandBuffer GetCommandBuffer() const { return mCmdBuf; };
 
 private:
     void EndRendering();
+    // Records all queued barriers in one go. Shader stages of the queued barriers are narrowed to `shaderStages`,
+    // the stages of the pipeline that's about to use the resources.
+    void FlushBarriers(VkPipelineStageFlags2 shaderStages);
     VkCommandBuffer CreateCommandBuffer() const;
 
     const Device& mDevice;
     VkCommandBuffer mCmdBuf = VK_NULL_HANDLE;
+    bool mIsPooled = false; // The command buffer is reset and freed by its CommandPool
     GraphicsState mCurrentGraphicsState = {};
     bool mIsRendering = false;
+    uint32_t mActiveQueryCount = 0u; // Begun and not ended yet; they're always begun and ended outside rendering
+
+    struct PendingBarrier {
+        Texture* texture = nullptr;
+        VkImageMemoryBarrier2 barrier = {};
+    };
+    std::vector<PendingBarrier> mPendingBarriers;
 };
\ No newline at end of file
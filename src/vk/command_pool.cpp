@@ -0,0 +1,48 @@
+#include "vk/command_pool.h"
+
+#include "vk/device.h"
+#include "vk/common.h"
+#include "vk/command_list.h"
+#include "vk/deletion_queue.h"
+
+CommandPool::CommandPool(const Device& device)
+    : mDevice(device)
+{
+    // Without VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, so the driver can reset the pool in bulk
+    const VkCommandPoolCreateInfo commandPoolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = device.GetSelectedQueueIndex(),
+    };
+    VK_CHECK(vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &mCommandPool));
+}
+
+CommandPool::~CommandPool()
+{
+    // Also frees the command buffers, which may still be pending execution
+    mDevice.GetDeletionQueue().Push([&device = mDevice, commandPool = mCommandPool]() {
+        vkDestroyCommandPool(device, commandPool, nullptr);
+    });
+}
+
+Handle<CommandList> CommandPool::AcquireCommandList()
+{
+    if (mAcquiredCount == mCommandLists.size()) {
+        const VkCommandBufferAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = mCommandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+        VkCommandBuffer commandBuffer;
+        VK_CHECK(vkAllocateCommandBuffers(mDevice, &allocInfo, &commandBuffer));
+        mCommandLists.push_back(CreateHandle<CommandList>(mDevice, commandBuffer));
+    }
+    return mCommandLists[mAcquiredCount++];
+}
+
+void CommandPool::Reset()
+{
+    VK_CHECK(vkResetCommandPool(mDevice, mCommandPool, 0u));
+    mAcquiredCount = 0u;
+}
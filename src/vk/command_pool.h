@@ -0,0 +1,24 @@
+#pragma once
+
+class Device;
+class CommandList;
+// Hands out the command lists of a frame and recycles all of them at once with vkResetCommandPool when the frame has
+// finished executing, instead of resetting or freeing their command buffers one by one. Command buffers are kept
+// across resets, so recording a frame allocates nothing once the pool has grown to the number of lists it uses.
+// Like the VkCommandPool it wraps, it must only be used by one thread at a time.
+class CommandPool {
+public:
+    explicit CommandPool(const Device& device);
+    ~CommandPool();
+
+    // The command list is recorded and submitted once; it's valid until the next Reset
+    Handle<CommandList> AcquireCommandList();
+    // NOTE: The command lists acquired since the last reset must have finished executing
+    void Reset();
+
+private:
+    const Device& mDevice;
+    VkCommandPool mCommandPool = VK_NULL_HANDLE;
+    std::vector<Handle<CommandList>> mCommandLists;
+    uint32_t mAcquiredCount = 0u;
+};
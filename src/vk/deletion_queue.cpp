@@ -0,0 +1,33 @@
+#include "vk/deletion_queue.h"
+
+#include "vk/frame_pacing.h"
+
+#include "cpu_profiler.h"
+
+DeletionQueue::~DeletionQueue()
+{
+    for (Entry& entry : mEntries) entry.destroy();
+}
+
+void DeletionQueue::Push(DestroyFn destroy)
+{
+    const std::scoped_lock lock(mMutex);
+    mEntries.push_back({ .frame = mFrame, .destroy = std::move(destroy) });
+}
+
+void DeletionQueue::BeginFrame()
+{
+    PROFILE_ZONE("DeletionQueue::BeginFrame");
+    std::vector<DestroyFn> destroys;
+    {
+        const std::scoped_lock lock(mMutex);
+        ++mFrame;
+        // Frames up to mFrame - kMaxFramesInFlightCount have finished executing
+        while (!mEntries.empty() && mEntries.front().frame + kMaxFramesInFlightCount <= mFrame) {
+            destroys.push_back(std::move(mEntries.front().destroy));
+            mEntries.pop_front();
+        }
+    }
+    // Outside of the lock, since destroying may release other objects
+    for (DestroyFn& destroy : destroys) destroy();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+
+// Destroys GPU objects once the frames that may still use them have finished executing, so releasing a resource
+// never has to wait for the device to be idle. Releases are tagged with the frame being recorded, which has finished
+// by the time the frame kMaxFramesInFlightCount frames later begins, see FramePacingState::WaitForFrameInFlight.
+class DeletionQueue {
+public:
+    using DestroyFn = std::function<void()>;
+
+    // Runs whatever is left; the device must be idle
+    ~DeletionQueue();
+
+    // Runs `destroy` once every frame begun so far has finished executing; can be called from any thread.
+    // `destroy` must only capture Vulkan handles and indices, not the object being released.
+    void Push(DestroyFn destroy);
+
+    // Starts a new frame and runs what was released before the oldest frame still in flight.
+    // NOTE: The frame kMaxFramesInFlightCount frames ago must have finished executing.
+    void BeginFrame();
+
+private:
+    struct Entry {
+        uint64_t frame = 0u; // Frame that was being recorded when the object was released
+        DestroyFn destroy;
+    };
+
+    std::mutex mMutex;
+    std::deque<Entry> mEntries; // In release order, so objects are destroyed in the order they were released
+    uint64_t mFrame = 0u;       // Frames begun so far
+};
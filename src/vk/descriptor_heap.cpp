@@ -0,0 +1,166 @@
+#include "vk/descriptor_heap.h"
+
+#include "vk/device.h"
+#include "vk/common.h"
+
+#include "utils.h"
+
+static VkDescriptorType GetDescriptorType(DescriptorHeapBinding binding)
+{
+    switch (binding) {
+        case DescriptorHeapBinding::SAMPLED_TEXTURE: return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        case DescriptorHeapBinding::STORAGE_TEXTURE: return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        case DescriptorHeapBinding::STORAGE_BUFFER:  return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        default:
+            assert(!"Unsupported DescriptorHeapBinding!");
+            return {};
+    }
+}
+
+// Layout the images are in whenever shaders access them, see ConvertResourceState
+static VkImageLayout GetImageLayout(DescriptorHeapBinding binding)
+{
+    return binding == DescriptorHeapBinding::STORAGE_TEXTURE ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
+static VkDescriptorPool CreateDescriptorPool(VkDevice device)
+{
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (uint32_t binding = 0; binding < uint32_t(DescriptorHeapBinding::COUNT); ++binding) {
+        poolSizes.push_back({
+            .type = GetDescriptorType(DescriptorHeapBinding(binding)),
+            .descriptorCount = kDescriptorHeapCapacities[binding],
+        });
+    }
+    const VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets = 1,
+        .poolSizeCount = uint32_t(poolSizes.size()),
+        .pPoolSizes = poolSizes.data(),
+    };
+    VkDescriptorPool descriptorPool;
+    VK_CHECK(vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &descriptorPool));
+    return descriptorPool;
+}
+
+static VkDescriptorSetLayout CreateDescriptorSetLayout(VkDevice device)
+{
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    std::vector<VkDescriptorBindingFlags> bindingFlags;
+    for (uint32_t binding = 0; binding < uint32_t(DescriptorHeapBinding::COUNT); ++binding) {
+        bindings.push_back({
+            .binding = binding,
+            .descriptorType = GetDescriptorType(DescriptorHeapBinding(binding)),
+            .descriptorCount = kDescriptorHeapCapacities[binding],
+            .stageFlags = VK_SHADER_STAGE_ALL,
+        });
+        // Unused slots are never accessed, and slots that aren't used by pending work can be (re)written
+        bindingFlags.push_back(
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT
+        );
+    }
+    const VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = uint32_t(bindingFlags.size()),
+        .pBindingFlags = bindingFlags.data(),
+    };
+    const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &bindingFlagsCreateInfo,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .bindingCount = uint32_t(bindings.size()),
+        .pBindings = bindings.data(),
+    };
+    VkDescriptorSetLayout descriptorSetLayout;
+    VK_CHECK(vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCreateInfo, nullptr, &descriptorSetLayout));
+    return descriptorSetLayout;
+}
+
+DescriptorHeap::DescriptorHeap(const Device& device)
+    : mDevice(device)
+{
+    mPool = CreateDescriptorPool(mDevice);
+    mSetLayout = CreateDescriptorSetLayout(mDevice);
+    const VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = mPool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &mSetLayout,
+    };
+    VK_CHECK(vkAllocateDescriptorSets(mDevice, &descriptorSetAllocateInfo, &mSet));
+}
+
+DescriptorHeap::~DescriptorHeap()
+{
+    vkDestroyDescriptorPool(mDevice, mPool, nullptr);
+    vkDestroyDescriptorSetLayout(mDevice, mSetLayout, nullptr);
+}
+
+uint32_t DescriptorHeap::AllocateIndex(DescriptorHeapBinding binding)
+{
+    std::lock_guard lock(mMutex);
+    auto& freeIndices = mFreeIndices[size_t(binding)];
+    if (!freeIndices.empty()) {
+        const uint32_t index = freeIndices.back();
+        freeIndices.pop_back();
+        return index;
+    }
+    uint32_t& allocatedCount = mAllocatedCounts[size_t(binding)];
+    if (allocatedCount == kDescriptorHeapCapacities[size_t(binding)]) {
+        LOG_ERROR("Descriptor heap binding {} is full", uint32_t(binding));
+        assert(0);
+    }
+    return allocatedCount++;
+}
+
+uint32_t DescriptorHeap::AllocateTexture(DescriptorHeapBinding binding, VkImageView imageView)
+{
+    assert(binding == DescriptorHeapBinding::SAMPLED_TEXTURE || binding == DescriptorHeapBinding::STORAGE_TEXTURE);
+    const uint32_t index = this->AllocateIndex(binding);
+    const VkDescriptorImageInfo imageInfo = {
+        .imageView = imageView,
+        .imageLayout = GetImageLayout(binding),
+    };
+    const VkWriteDescriptorSet writeDescriptorSet = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = mSet,
+        .dstBinding = uint32_t(binding),
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = GetDescriptorType(binding),
+        .pImageInfo = &imageInfo,
+    };
+    vkUpdateDescriptorSets(mDevice, 1, &writeDescriptorSet, 0, nullptr);
+    return index;
+}
+
+uint32_t DescriptorHeap::AllocateBuffer(VkBuffer buffer)
+{
+    const uint32_t index = this->AllocateIndex(DescriptorHeapBinding::STORAGE_BUFFER);
+    const VkDescriptorBufferInfo bufferInfo = {
+        .buffer = buffer,
+        .offset = 0,
+        .range = VK_WHOLE_SIZE,
+    };
+    const VkWriteDescriptorSet writeDescriptorSet = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = mSet,
+        .dstBinding = uint32_t(DescriptorHeapBinding::STORAGE_BUFFER),
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo = &bufferInfo,
+    };
+    vkUpdateDescriptorSets(mDevice, 1, &writeDescriptorSet, 0, nullptr);
+    return index;
+}
+
+void DescriptorHeap::Free(DescriptorHeapBinding binding, uint32_t index)
+{
+    if (index == kInvalidDescriptorIndex) return;
+    std::lock_guard lock(mMutex);
+    mFreeIndices[size_t(binding)].push_back(index);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <mutex>
+
+// Set of the global descriptor heap in every pipeline layout; set 0 holds the pipeline's push descriptors
+constexpr uint32_t kDescriptorHeapSet = 1u;
+constexpr uint32_t kInvalidDescriptorIndex = ~0u;
+
+// Bindings of the heap; must match shaders/descriptor_heap.hlsli
+enum class DescriptorHeapBinding : uint32_t {
+    SAMPLED_TEXTURE = 0,
+    STORAGE_TEXTURE = 1,
+    STORAGE_BUFFER = 2,
+    COUNT
+};
+
+// Number of descriptors of every binding of the heap
+constexpr std::array<uint32_t, size_t(DescriptorHeapBinding::COUNT)> kDescriptorHeapCapacities = { 1024u, 1024u, 1024u };
+
+class Device;
+// Global, bindless descriptor set that's bound to every pipeline. Textures and buffers get a stable index into it
+// at creation, so shaders can access them by the indices passed through push constants instead of binding them.
+// The heap is partially bound and updated after bind, so resources can be added while frames are in flight.
+class DescriptorHeap {
+public:
+    explicit DescriptorHeap(const Device& device);
+    ~DescriptorHeap();
+
+    // Write the descriptor into a free slot of the binding and return its index
+    uint32_t AllocateTexture(DescriptorHeapBinding binding, VkImageView imageView);
+    uint32_t AllocateBuffer(VkBuffer buffer);
+    // NOTE: The slot is reused right away, so the resource must no longer be in use by the GPU
+    void Free(DescriptorHeapBinding binding, uint32_t index);
+
+    VkDescriptorSetLayout GetSetLayout() const { return mSetLayout; }
+    VkDescriptorSet GetSet() const { return mSet; }
+
+private:
+    uint32_t AllocateIndex(DescriptorHeapBinding binding);
+
+    const Device& mDevice;
+    VkDescriptorPool mPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSet mSet = VK_NULL_HANDLE;
+
+    std::mutex mMutex;
+    std::array<uint32_t, size_t(DescriptorHeapBinding::COUNT)> mAllocatedCounts = {};
+    std::array<std::vector<uint32_t>, size_t(DescriptorHeapBinding::COUNT)> mFreeIndices;
+};
@@ -51,7 +51,8 @@ enum class Format : uint16_t {
 };
 
 
-enum class MemoryAccess : uint8_t { HOST, DEVICE, };
+// HOST memory is written sequentially by the host, READBACK memory is host-cached and read back by the host
+enum class MemoryAccess : uint8_t { HOST, DEVICE, READBACK };
 enum class PipelineType : uint8_t { COMPUTE, GRAPHICS };
 enum class Filter : uint8_t { POINT, BILINEAR, TRILINEAR, COUNT};
 enum class WrapMode : uint16_t { WRAP, CLAMP_TO_EDGE, CLAMP_TO_BORDER, COUNT };
@@ -59,6 +60,11 @@ enum class CullMode : uint16_t { NONE, CCW, CW, COUNT };
 enum class PrimitiveType : uint16_t { POINT_LIST, LINE_LIST, TRIANGLE_LIST, TRIANGLE_LIST_WITH_ADJACENCY, TRIANGLE_STRIP, TRIANGLE_STRIP_WITH_ADJACENCY, TRIANGLE_FAN, PATCH_LIST, COUNT };
 enum class RasterFillMode : uint16_t { SOLID, WIREFRAME, POINT, COUNT };
 enum class LoadOp : uint16_t { LOAD, CLEAR, DONT_CARE, COUNT };
+enum class QueryType : uint8_t { TIMESTAMP, PIPELINE_STATISTICS, COUNT };
+// What an allocation is used for, to break the memory usage down, see MemoryTracker
+enum class MemoryCategory : uint8_t { OTHER, SIMULATION, MESH, GUI, SWAPCHAIN, RENDER_GRAPH, STAGING, COUNT };
+// Statistics gathered by PIPELINE_STATISTICS queries, in the order they are returned
+enum class PipelineStatistic : uint8_t { VERTEX_SHADER_INVOCATIONS, FRAGMENT_SHADER_INVOCATIONS, COUNT };
 enum class CompareOp : uint16_t {
     NEVER,
     LESS,
@@ -67,6 +67,36 @@ constexpr VkFormat GetVkFormat(Format format)
     return VK_FORMAT_UNDEFINED; // Shouldn't get here
 }
 
+// Size of a texel in bytes, e.g. of a tightly packed copy of a texture into a buffer.
+// Block-compressed and combined depth-stencil formats aren't copied texel by texel and return 0.
+constexpr uint32_t GetFormatByteSize(Format format)
+{
+    switch (format) {
+        case Format::R8_UNORM: case Format::R8_UINT: case Format::R8_SRGB:
+            return 1;
+        case Format::RG8_UNORM: case Format::RG8_UINT: case Format::RG8_SRGB:
+        case Format::R16_UNORM: case Format::R16_UINT: case Format::R16_FLOAT:
+        case Format::D16_UNORM:
+            return 2;
+        case Format::RGBA8_UNORM: case Format::RGBA8_UINT: case Format::RGBA8_SRGB:
+        case Format::BGRA8_UNORM: case Format::BGRA8_UINT: case Format::BGRA8_SRGB:
+        case Format::RG16_UNORM: case Format::RG16_UINT: case Format::RG16_FLOAT:
+        case Format::R32_UINT: case Format::R32_FLOAT:
+        case Format::RGB10A2_UNORM: case Format::RGB10A2_UINT: case Format::RG11B10_UFLOAT:
+        case Format::D32_FLOAT:
+            return 4;
+        case Format::RGBA16_UNORM: case Format::RGBA16_UINT: case Format::RGBA16_FLOAT:
+        case Format::RG32_UINT: case Format::RG32_FLOAT:
+            return 8;
+        case Format::RGB32_UINT: case Format::RGB32_FLOAT:
+            return 12;
+        case Format::RGBA32_UINT: case Format::RGBA32_FLOAT:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
 static VkImageAspectFlags GetAspectMask(Format format)
 {
     return format == Format::D32_FLOAT ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
@@ -150,67 +180,82 @@ constexpr VkBufferUsageFlags GetVkBufferUsageFlags(BufferUsageBits usageMask)
 
 struct ResourceStateMapping {
     ResourceStateBits resourceStateMask;
-    VkPipelineStageFlags stageFlags;
-    VkAccessFlags accessMask;
+    VkPipelineStageFlags2 stageFlags;
+    VkAccessFlags2 accessMask;
     VkImageLayout imageLayout;
 };
 
+// Every shader stage the renderer uses; barriers narrow this down to the stages of the pipeline that accesses the
+// resource, see CommandList::FlushBarriers
+constexpr VkPipelineStageFlags2 kShaderStages =
+    VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+
 constexpr ResourceStateMapping gResourceStateMap[] =
 {
     { ResourceStateBits::COMMON,
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-        VK_ACCESS_NONE,
+        VK_PIPELINE_STAGE_2_NONE,
+        VK_ACCESS_2_NONE,
         VK_IMAGE_LAYOUT_UNDEFINED },
     { ResourceStateBits::CONSTANT_BUFFER,
-        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-        VK_ACCESS_UNIFORM_READ_BIT,
+        kShaderStages,
+        VK_ACCESS_2_UNIFORM_READ_BIT,
         VK_IMAGE_LAYOUT_UNDEFINED },
     { ResourceStateBits::VERTEX_BUFFER,
-        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+        VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT,
+        VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT,
         VK_IMAGE_LAYOUT_UNDEFINED },
     { ResourceStateBits::INDEX_BUFFER,
-        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-        VK_ACCESS_INDEX_READ_BIT,
+        VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT,
+        VK_ACCESS_2_INDEX_READ_BIT,
         VK_IMAGE_LAYOUT_UNDEFINED },
     { ResourceStateBits::INDIRECT_ARGUMENT,
-        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
-        VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+        VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+        VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
         VK_IMAGE_LAYOUT_UNDEFINED },
     { ResourceStateBits::SHADER_RESOURCE,
-        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-        VK_ACCESS_SHADER_READ_BIT,
+        kShaderStages,
+        VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
     { ResourceStateBits::UNORDERED_ACCESS,
-        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        kShaderStages,
+        VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
         VK_IMAGE_LAYOUT_GENERAL },
     { ResourceStateBits::RENDER_TARGET,
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
     { ResourceStateBits::DEPTH_WRITE,
-        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
         VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL },
     { ResourceStateBits::DEPTH_READ,
-        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
         VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL },
     { ResourceStateBits::COPY_DEST,
-        VK_PIPELINE_STAGE_TRANSFER_BIT,
-        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_COPY_BIT,
+        VK_ACCESS_2_TRANSFER_WRITE_BIT,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
     { ResourceStateBits::COPY_SOURCE,
-        VK_PIPELINE_STAGE_TRANSFER_BIT,
-        VK_ACCESS_TRANSFER_READ_BIT,
+        VK_PIPELINE_STAGE_2_COPY_BIT,
+        VK_ACCESS_2_TRANSFER_READ_BIT,
         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL },
+    // Presentation is ordered by semaphores; the stage makes the transition out of it chain with the acquire wait
     { ResourceStateBits::PRESENT,
-        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-        VK_ACCESS_MEMORY_READ_BIT,
+        VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        VK_ACCESS_2_NONE,
         VK_IMAGE_LAYOUT_PRESENT_SRC_KHR },
 };
 
+// Whether a state only reads, so moving between two such states needs no barrier when the layout stays the same
+constexpr bool IsReadOnlyResourceState(ResourceStateBits state)
+{
+    constexpr ResourceStateBits kWriteStates =
+        ResourceStateBits::UNORDERED_ACCESS | ResourceStateBits::RENDER_TARGET | ResourceStateBits::DEPTH_WRITE | ResourceStateBits::COPY_DEST;
+    return state != ResourceStateBits::COMMON && !IsSet(state, kWriteStates);
+}
+
+
 constexpr ResourceStateMapping ConvertResourceState(ResourceStateBits state)
 {
     constexpr uint16_t kNumStateBits = sizeof(gResourceStateMap) / sizeof(gResourceStateMap[0]);
@@ -291,4 +336,21 @@ constexpr VkPolygonMode GetVkPolygonMode(RasterFillMode mode)
         case RasterFillMode::COUNT:         return VK_POLYGON_MODE_MAX_ENUM;
     }
     return VK_POLYGON_MODE_MAX_ENUM; // Shouldn't get here
-}
\ No newline at end of file
+}
+
+constexpr VkQueryType GetVkQueryType(QueryType type)
+{
+    switch (type) {
+        case QueryType::TIMESTAMP:              return VK_QUERY_TYPE_TIMESTAMP;
+        case QueryType::PIPELINE_STATISTICS:    return VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        case QueryType::COUNT:                  return VK_QUERY_TYPE_MAX_ENUM;
+    }
+    return VK_QUERY_TYPE_MAX_ENUM; // Shouldn't get here
+}
+
+constexpr VkQueryPipelineStatisticFlags GetVkQueryPipelineStatisticFlags(QueryType type)
+{
+    // NOTE: Vulkan returns the statistics in bit order, which must match the order of PipelineStatistic
+    if (type != QueryType::PIPELINE_STATISTICS) return 0u;
+    return VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+}
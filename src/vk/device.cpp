@@ -1,12 +1,19 @@
 #include "vk/device.h"
 #include "vk/common.h"
 #include "vk/command_list.h"
+#include "vk/pipeline.h"
+#include "vk/shader.h"
+#include "vk/pipeline_registry.h"
+#include "vk/descriptor_heap.h"
+#include "vk/memory_tracker.h"
+#include "vk/deletion_queue.h"
 
 #include "window.h"
 #include "utils.h"
+#include "thread_pool.h"
+#include "cpu_profiler.h"
 
 const std::vector<const char*> kRequiredExtensions = {
-    VK_KHR_SWAPCHAIN_EXTENSION_NAME,
     VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME,
     VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
     VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
@@ -18,7 +25,20 @@ const std::vector<const char*> kRequiredExtensions = {
     
 const std::vector<const char*> kValidationLayers = { "VK_LAYER_KHRONOS_validation" };
 
+// Only required to present, i.e. not by a headless device
+const std::vector<const char*> kPresentExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+
 const std::vector<const char*> kInstanceExtensions = {
+#ifdef __APPLE__
+    VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif // __APPLE__
+
+#ifdef _DEBUG
+    VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif // _DEBUG
+};
+
+const std::vector<const char*> kSurfaceInstanceExtensions = {
     VK_KHR_SURFACE_EXTENSION_NAME,
 
 #ifdef _WIN32
@@ -27,16 +47,15 @@ const std::vector<const char*> kInstanceExtensions = {
     "VK_KHR_xcb_surface",
 #elif __APPLE__
     "VK_EXT_metal_surface",
-    VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
 #endif // _WIN32 __linux__ __APPLE__
-
-#ifdef _DEBUG
-    VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
-#endif // _DEBUG
 };
 
-static VkInstance CreateInstance(bool enableValidationLayers)
+static VkInstance CreateInstance(bool enableValidationLayers, bool isHeadless)
 {
+    std::vector<const char*> instanceExtensions(kInstanceExtensions);
+    if (!isHeadless) {
+        instanceExtensions.insert(instanceExtensions.end(), kSurfaceInstanceExtensions.begin(), kSurfaceInstanceExtensions.end());
+    }
 
     const VkApplicationInfo appInfo = {
         .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -53,10 +72,10 @@ static VkInstance CreateInstance(bool enableValidationLayers)
         .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
 #endif // __APPLE__
         .pApplicationInfo = &appInfo,
-        .enabledExtensionCount = uint32_t(kInstanceExtensions.size()),
-        .ppEnabledExtensionNames = kInstanceExtensions.data(),
+        .enabledExtensionCount = uint32_t(instanceExtensions.size()),
+        .ppEnabledExtensionNames = instanceExtensions.data(),
     };
-    LOG_INFO("Enabled extensions: {}", fmt::join(kInstanceExtensions, ", "));
+    LOG_INFO("Enabled extensions: {}", fmt::join(instanceExtensions, ", "));
 
     if (enableValidationLayers) {
         instanceCreateInfo.enabledLayerCount = kValidationLayers.size();
@@ -64,6 +83,7 @@ static VkInstance CreateInstance(bool enableValidationLayers)
         LOG_INFO("Enabled validation layers: {}", fmt::join(kValidationLayers, ", "));
     }
 
+#ifdef _DEBUG
     std::vector<VkValidationFeatureEnableEXT> enabledValidationFeatures = { VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT, VK_VALIDATION_FEATURE_ENABLE_DEBUG_PRINTF_EXT };
     const VkValidationFeaturesEXT validationFeatures = {
         .sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT,
@@ -120,27 +140,82 @@ static uint32_t GetGraphicsQueueFamilyIndex(VkPhysicalDevice physicalDevice)
     return ~0u;
 }
 
-static bool IsPhysicalDeviceSupported(VkPhysicalDevice physicalDevice)
+static bool IsDeviceExtensionAvailable(VkPhysicalDevice physicalDevice, const char* extensionName)
 {
     const auto& availableExtensions = GetVector<VkExtensionProperties>(vkEnumerateDeviceExtensionProperties, physicalDevice, nullptr);
-    const auto IsDeviceExtensionAvailable = [&](const char* extensionName) {
-        for (const auto& availableExtension : availableExtensions) {
-            if (strcmp(availableExtension.extensionName, extensionName) == 0) {
-                return true;
-            }
+    for (const auto& availableExtension : availableExtensions) {
+        if (strcmp(availableExtension.extensionName, extensionName) == 0) {
+            return true;
         }
-        return false;
-    };
+    }
+    return false;
+}
+
+// Prefers a family that can also draw, since all passes are recorded on a single queue
+static uint32_t GetComputeQueueFamilyIndex(VkPhysicalDevice physicalDevice)
+{
+    auto queueFamilies = GetVectorNoError<VkQueueFamilyProperties>(vkGetPhysicalDeviceQueueFamilyProperties, physicalDevice);
+    uint32_t computeQueueIndex = ~0u;
+    for (auto [idx, queueFamily] : enumerate(queueFamilies) ) {
+        if (!(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) continue;
+        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            return idx;
+        }
+        if (computeQueueIndex == ~0u) computeQueueIndex = idx;
+    }
+    return computeQueueIndex;
+}
+
+static bool IsPhysicalDeviceSupported(VkPhysicalDevice physicalDevice, bool isHeadless)
+{
     for (auto deviceExtension : kRequiredExtensions) {
-        if (!IsDeviceExtensionAvailable(deviceExtension)) {
+        if (!IsDeviceExtensionAvailable(physicalDevice, deviceExtension)) {
+            return false;
+        }
+    }
+    if (isHeadless) return true;
+    for (auto deviceExtension : kPresentExtensions) {
+        if (!IsDeviceExtensionAvailable(physicalDevice, deviceExtension)) {
             return false;
         }
     }
     return true;
 }
 
+// Whether the polygon mode can be set per draw with vkCmdSetPolygonModeEXT
+static bool IsDynamicPolygonModeSupported(VkPhysicalDevice physicalDevice)
+{
+    if (!IsDeviceExtensionAvailable(physicalDevice, VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME)) {
+        return false;
+    }
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+    };
+    VkPhysicalDeviceFeatures2 features2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &extendedDynamicState3Features,
+    };
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+    return extendedDynamicState3Features.extendedDynamicState3PolygonMode == VK_TRUE;
+}
+
+// Whether device timestamps can be sampled together with CLOCK_MONOTONIC, i.e. std::chrono::steady_clock
+static bool IsCalibratedTimestampsSupported(VkPhysicalDevice physicalDevice)
+{
+    if (!IsDeviceExtensionAvailable(physicalDevice, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)) {
+        return false;
+    }
+    const auto& timeDomains = GetVector<VkTimeDomainEXT>(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT, physicalDevice);
+    const auto isTimeDomainSupported = [&](VkTimeDomainEXT timeDomain) {
+        return std::find(timeDomains.begin(), timeDomains.end(), timeDomain) != timeDomains.end();
+    };
+    return isTimeDomainSupported(VK_TIME_DOMAIN_DEVICE_EXT) && isTimeDomainSupported(VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT);
+}
+
+// Without a surface, i.e. for a headless device, any device with a compute queue is selected
 static std::pair<VkPhysicalDevice, uint32_t> SelectPhysicalDevice(VkInstance instance, VkSurfaceKHR surface)
 {
+    const bool isHeadless = surface == VK_NULL_HANDLE;
     const auto& physicalDeviceCandidates = GetVector<VkPhysicalDevice>(vkEnumeratePhysicalDevices, instance);
     if (physicalDeviceCandidates.empty()) {
         LOG_ERROR("No physical device was found");
@@ -152,19 +227,27 @@ static std::pair<VkPhysicalDevice, uint32_t> SelectPhysicalDevice(VkInstance ins
     for (auto physicalDevice : physicalDeviceCandidates)
     {
         // TODO: currently, we only get the first available graphics queue. Should we extend the logic?
-        uint32_t queueIndex = GetGraphicsQueueFamilyIndex(physicalDevice);
+        uint32_t queueIndex = isHeadless ? GetComputeQueueFamilyIndex(physicalDevice) : GetGraphicsQueueFamilyIndex(physicalDevice);
         if (queueIndex == ~0u) continue;
 
-        VkBool32 isSurfaceSupported;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, queueIndex, surface, &isSurfaceSupported);
-        if (isSurfaceSupported == VK_FALSE) continue;
-        if (!IsPhysicalDeviceSupported(physicalDevice)) continue;
+        if (!isHeadless) {
+            VkBool32 isSurfaceSupported;
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, queueIndex, surface, &isSurfaceSupported);
+            if (isSurfaceSupported == VK_FALSE) continue;
+        }
+        if (!IsPhysicalDeviceSupported(physicalDevice, isHeadless)) continue;
 
         selectedPhysicalDevice = physicalDevice;
         selectedQueueIndex = queueIndex;
         break;
     }
     LOG_INFO("Selected queue with index {}", selectedQueueIndex);
+    if (selectedPhysicalDevice != VK_NULL_HANDLE) {
+        auto queueFamilies = GetVectorNoError<VkQueueFamilyProperties>(vkGetPhysicalDeviceQueueFamilyProperties, selectedPhysicalDevice);
+        if (!(queueFamilies[selectedQueueIndex].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+            LOG_WARN("The selected queue only supports compute; graphics passes can't be recorded");
+        }
+    }
 
     return std::make_pair(selectedPhysicalDevice, selectedQueueIndex);
 }
@@ -176,9 +259,28 @@ static VkSurfaceKHR CreateSurface(const Window& window, VkInstance instance)
     return surface;
 }
 
-static VkDevice CreateDevice(VkPhysicalDevice physicalDevice, uint32_t queueIndex)
+static VkDevice CreateDevice(
+    VkPhysicalDevice physicalDevice,
+    uint32_t queueIndex,
+    bool isHeadless,
+    bool shouldEnableDynamicPolygonMode,
+    bool shouldEnableCalibratedTimestamps,
+    bool shouldEnableMemoryBudget
+)
 {
     std::vector<const char*> deviceExtensions(kRequiredExtensions);
+    if (!isHeadless) {
+        deviceExtensions.insert(deviceExtensions.end(), kPresentExtensions.begin(), kPresentExtensions.end());
+    }
+    if (shouldEnableDynamicPolygonMode) {
+        deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+    }
+    if (shouldEnableCalibratedTimestamps) {
+        deviceExtensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+    }
+    if (shouldEnableMemoryBudget) {
+        deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
 
     float queuePriority = 1.0f;
     const VkDeviceQueueCreateInfo queueCreateInfo = {
@@ -190,7 +292,7 @@ static VkDevice CreateDevice(VkPhysicalDevice physicalDevice, uint32_t queueInde
 
     const VkPhysicalDeviceFeatures2 deviceFeatures2 = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
-        .features = { .shaderInt16 = VK_TRUE, .fillModeNonSolid = VK_TRUE }
+        .features = { .fillModeNonSolid = VK_TRUE, .pipelineStatisticsQuery = VK_TRUE, .shaderInt16 = VK_TRUE }
     };
 
     const VkPhysicalDeviceVulkan11Features deviceFeatures11 = {
@@ -207,22 +309,36 @@ static VkDevice CreateDevice(VkPhysicalDevice physicalDevice, uint32_t queueInde
         .storagePushConstant8 = VK_TRUE,
         .shaderFloat16 = VK_TRUE,
         .shaderInt8 = VK_TRUE,
+        .descriptorIndexing = VK_TRUE,
+        .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+        .descriptorBindingStorageImageUpdateAfterBind = VK_TRUE,
+        .descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE,
+        .descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
+        .descriptorBindingPartiallyBound = VK_TRUE,
+        .runtimeDescriptorArray = VK_TRUE,
         .pNext = (void*)&deviceFeatures11,
     };
 
     const VkPhysicalDeviceVulkan13Features deviceFeatures13 = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+        .synchronization2 = VK_TRUE,
         .dynamicRendering = VK_TRUE,
         .pNext = (void*)&deviceFeatures12,
     };
 
+    const VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+        .pNext = (void*)&deviceFeatures13,
+        .extendedDynamicState3PolygonMode = VK_TRUE,
+    };
+
     const VkDeviceCreateInfo deviceCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
         .queueCreateInfoCount = 1,
         .pQueueCreateInfos = &queueCreateInfo,
         .enabledExtensionCount = uint32_t(deviceExtensions.size()),
         .ppEnabledExtensionNames = deviceExtensions.data(),
-        .pNext = &deviceFeatures13,
+        .pNext = shouldEnableDynamicPolygonMode ? (void*)&extendedDynamicState3Features : (void*)&deviceFeatures13,
     };
 
     VkDevice device;
@@ -230,7 +346,7 @@ static VkDevice CreateDevice(VkPhysicalDevice physicalDevice, uint32_t queueInde
     return device;
 }
 
-static VmaAllocator CreateAllocator(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device)
+static VmaAllocator CreateAllocator(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, bool isMemoryBudgetEnabled)
 {
     const VmaVulkanFunctions volkFunctions = {
         vkGetInstanceProcAddr,
@@ -261,6 +377,8 @@ static VmaAllocator CreateAllocator(VkInstance instance, VkPhysicalDevice physic
         vkGetDeviceImageMemoryRequirements,
     };
     const VmaAllocatorCreateInfo allocatorCreateInfo = {
+        // Without the extension, VMA estimates the usage from its own blocks and the budget from the heap sizes
+        .flags = isMemoryBudgetEnabled ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0u,
         .vulkanApiVersion = volkGetInstanceVersion(),
         .instance = instance,
         .physicalDevice = physicalDevice,
@@ -272,12 +390,58 @@ static VmaAllocator CreateAllocator(VkInstance instance, VkPhysicalDevice physic
     return allocator;
 }
 
+// The cache is only valid for the exact device and driver that produced it, so they are part of its name
+static std::string GetPipelineCachePath(const VkPhysicalDeviceProperties& properties)
+{
+    std::string uuid;
+    for (uint8_t byte : properties.pipelineCacheUUID) uuid += fmt::format("{:02x}", byte);
+    return fmt::format("pipeline_cache_{:04x}_{:04x}_{}.bin", properties.vendorID, properties.deviceID, uuid);
+}
+
+// Returns an empty vector if there's no cache file, or if it was written by another device or driver
+static std::vector<uint8_t> LoadPipelineCacheData(const std::string& path, const VkPhysicalDeviceProperties& properties)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good()) return {};
+    std::vector<uint8_t> data = std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    VkPipelineCacheHeaderVersionOne header;
+    if (data.size() < sizeof(header)) {
+        LOG_WARN("Ignoring truncated pipeline cache '{}'", path);
+        return {};
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    const bool isHeaderValid =
+        header.headerSize >= sizeof(header) && header.headerSize <= data.size() &&
+        header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == properties.vendorID &&
+        header.deviceID == properties.deviceID &&
+        memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    if (!isHeaderValid) {
+        LOG_WARN("Ignoring pipeline cache '{}' with a mismatching header", path);
+        return {};
+    }
+    return data;
+}
+
+static VkPipelineCache CreatePipelineCache(VkDevice device, const std::vector<uint8_t>& initialData)
+{
+    const VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = initialData.size(),
+        .pInitialData = initialData.data(),
+    };
+    VkPipelineCache pipelineCache;
+    VK_CHECK(vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &pipelineCache));
+    return pipelineCache;
+}
+
 static VkCommandPool CreateCommandPool(VkDevice device, uint32_t queueIndex)
 {
     const VkCommandPoolCreateInfo commandPoolCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
         .queueFamilyIndex = queueIndex,
-        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, // Its command lists are recorded once, see CommandPool for frames
     };
     VkCommandPool commandPool;
     VK_CHECK(vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool));
@@ -285,33 +449,85 @@ static VkCommandPool CreateCommandPool(VkDevice device, uint32_t queueIndex)
 }
 
 Device::Device(const Window& window, bool enableValidationLayer)
+{
+    this->Initialize(&window, enableValidationLayer);
+}
+
+Device::Device(bool enableValidationLayer)
+{
+    this->Initialize(nullptr, enableValidationLayer);
+}
+
+void Device::Initialize(const Window* window, bool enableValidationLayer)
 {
     VK_CHECK(volkInitialize());
 
-    mInstance = CreateInstance(enableValidationLayer);
+    mInstance = CreateInstance(enableValidationLayer, window == nullptr);
 #ifdef _DEBUG
     mDebugMessenger = CreateDebugMessenger(mInstance, enableValidationLayer);
 #endif
-    mSurface = CreateSurface(window, mInstance);
-    
+    if (window != nullptr) {
+        mSurface = CreateSurface(*window, mInstance);
+    }
+
     const auto [physicalDevice, queueIndex] = SelectPhysicalDevice(mInstance, mSurface);
     assert(physicalDevice != VK_NULL_HANDLE && queueIndex != ~0u);
     mPhysicalDevice = physicalDevice;
     mQueueIndex = queueIndex;
-
-    mDevice = CreateDevice(mPhysicalDevice, mQueueIndex);
+    VkPhysicalDeviceIDProperties idProperties = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES };
+    VkPhysicalDeviceProperties2 properties2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &idProperties,
+    };
+    vkGetPhysicalDeviceProperties2(mPhysicalDevice, &properties2);
+    mProperties = properties2.properties;
+    std::copy(std::begin(idProperties.deviceUUID), std::end(idProperties.deviceUUID), mDeviceUUID.begin());
+    const auto queueFamilies = GetVectorNoError<VkQueueFamilyProperties>(vkGetPhysicalDeviceQueueFamilyProperties, mPhysicalDevice);
+    mTimestampValidBits = queueFamilies[mQueueIndex].timestampValidBits;
+
+    mIsDynamicPolygonModeSupported = IsDynamicPolygonModeSupported(mPhysicalDevice);
+    LOG_INFO("Dynamic polygon mode is {}supported", mIsDynamicPolygonModeSupported ? "" : "not ");
+    mIsCalibratedTimestampsSupported = IsCalibratedTimestampsSupported(mPhysicalDevice);
+    LOG_INFO("Calibrated timestamps are {}supported", mIsCalibratedTimestampsSupported ? "" : "not ");
+    mIsMemoryBudgetSupported = IsDeviceExtensionAvailable(mPhysicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    LOG_INFO("Memory budget is {}supported", mIsMemoryBudgetSupported ? "" : "not ");
+    mDevice = CreateDevice(mPhysicalDevice, mQueueIndex, this->IsHeadless(), mIsDynamicPolygonModeSupported,
+        mIsCalibratedTimestampsSupported, mIsMemoryBudgetSupported);
     vkGetDeviceQueue(mDevice, mQueueIndex, 0, &mQueue);
 
-    mAllocator = CreateAllocator(mInstance, mPhysicalDevice, mDevice);
+    mAllocator = CreateAllocator(mInstance, mPhysicalDevice, mDevice, mIsMemoryBudgetSupported);
+    mMemoryTracker = std::make_unique<MemoryTracker>(mAllocator, mIsMemoryBudgetSupported);
 
     mCommandPool = CreateCommandPool(mDevice, mQueueIndex);
+
+    mDescriptorHeap = std::make_unique<DescriptorHeap>(*this);
+    mDeletionQueue = std::make_unique<DeletionQueue>();
+
+    mPipelineCachePath = GetPipelineCachePath(mProperties);
+    const std::vector<uint8_t> pipelineCacheData = LoadPipelineCacheData(mPipelineCachePath, mProperties);
+    mHasLoadedPipelineCache = !pipelineCacheData.empty();
+    mPipelineCache = CreatePipelineCache(mDevice, pipelineCacheData);
+    LOG_INFO("Pipeline cache '{}' is {}", mPipelineCachePath, mHasLoadedPipelineCache ? "warm" : "cold");
+
+    mThreadPool = std::make_unique<ThreadPool>();
+    mPipelineRegistry = std::make_unique<PipelineRegistry>(*this);
 }
 
 Device::~Device()
 {
     LOG_INFO("Destroying Vulkan device");
+    mThreadPool.reset(); // Finish any pending work before the objects it uses are destroyed
+    mPipelineRegistry.reset();
+    // Destroys everything released since the last frames, which may still reference the heap and the allocator
+    this->WaitIdle();
+    mDeletionQueue.reset();
+    mDescriptorHeap.reset();
     vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
 
+    this->SavePipelineCache();
+    vkDestroyPipelineCache(mDevice, mPipelineCache, nullptr);
+
+    mMemoryTracker.reset();
     vmaDestroyAllocator(mAllocator);
 
     vkDestroyDevice(mDevice, nullptr);
@@ -320,7 +536,9 @@ Device::~Device()
         vkDestroyDebugUtilsMessengerEXT(mInstance, mDebugMessenger, nullptr);
     }
 
-    vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
+    if (mSurface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
+    }
     vkDestroyInstance(mInstance, nullptr);
 }
 
@@ -341,7 +559,63 @@ void Device::ExecuteCommandList(Handle<CommandList> cmdList) const
     VK_CHECK(vkQueueWaitIdle(mQueue));
 }
 
+void Device::SavePipelineCache() const
+{
+    size_t dataSize = 0;
+    VK_CHECK(vkGetPipelineCacheData(mDevice, mPipelineCache, &dataSize, nullptr));
+    std::vector<uint8_t> data(dataSize);
+    VK_CHECK(vkGetPipelineCacheData(mDevice, mPipelineCache, &dataSize, data.data()));
+
+    // Write to a temporary file first and rename it, so a crash mid-write never leaves a corrupt cache behind
+    const std::string tempPath = mPipelineCachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write((const char*)data.data(), dataSize);
+        if (!file.good()) {
+            LOG_WARN("Failed to write pipeline cache '{}'", tempPath);
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, mPipelineCachePath, error);
+    if (error) {
+        LOG_WARN("Failed to save pipeline cache '{}': {}", mPipelineCachePath, error.message());
+        std::filesystem::remove(tempPath, error);
+        return;
+    }
+    LOG_INFO("Saved {} bytes of pipeline cache to '{}'", dataSize, mPipelineCachePath);
+}
+
+std::shared_future<Handle<Pipeline>> Device::CreatePipelineAsync(PipelineDesc desc, std::vector<std::string> shaderFilenames) const
+{
+    return mThreadPool->Submit([this, desc = std::move(desc), shaderFilenames = std::move(shaderFilenames)]() mutable {
+        PROFILE_ZONE("CreatePipeline");
+        std::vector<std::unique_ptr<Shader>> shaders;
+        desc.shaders.clear();
+        for (const auto& shaderFilename : shaderFilenames) {
+            shaders.push_back(std::make_unique<Shader>(*this, shaderFilename.c_str()));
+            desc.shaders.push_back(shaders.back().get());
+        }
+        return mPipelineRegistry->GetOrCreatePipeline(desc);
+    }).share();
+}
+
 void Device::WaitIdle() const
 {
     VK_CHECK(vkDeviceWaitIdle(mDevice));
+}
+
+void Device::SetDebugName(VkObjectType objectType, uint64_t objectHandle, const char* name) const
+{
+#ifdef _DEBUG
+    // VK_EXT_debug_utils is only enabled in debug builds, see kInstanceExtensions
+    if (name == nullptr) return;
+    const VkDebugUtilsObjectNameInfoEXT nameInfo = {
+        .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT,
+        .objectType = objectType,
+        .objectHandle = objectHandle,
+        .pObjectName = name,
+    };
+    VK_CHECK(vkSetDebugUtilsObjectNameEXT(mDevice, &nameInfo));
+#endif // _DEBUG
 }
\ No newline at end of file
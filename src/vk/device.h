@@ -2,31 +2,89 @@
 
 class Window;
 class CommandList;
+class Pipeline;
+class ThreadPool;
+class PipelineRegistry;
+class DescriptorHeap;
+class MemoryTracker;
+class DeletionQueue;
+struct PipelineDesc;
 
 class Device {
 public:
     Device(const Window& window, bool enableValidationLayer=true);
+    // Headless: no surface or swapchain extensions, and any device with a compute queue is accepted.
+    // Frames are rendered into an OffscreenTarget instead of a Swapchain.
+    explicit Device(bool enableValidationLayer=true);
     ~Device();
 
+    // For one-off work like uploads; the command list is recorded once. Frames use the pools of FramePacingState.
     Handle<CommandList> CreateCommandList() const;
     void ExecuteCommandList(Handle<CommandList> cmdList) const;
 
+    // Loads the shaders and creates the pipeline on a worker thread, so independent pipelines compile concurrently.
+    // `desc.shaders` is filled in from `shaderFilenames`; the shaders only live while the pipeline is created.
+    // Goes through the PipelineRegistry, so repeating a desc returns the existing pipeline.
+    std::shared_future<Handle<Pipeline>> CreatePipelineAsync(PipelineDesc desc, std::vector<std::string> shaderFilenames) const;
+
     void WaitIdle() const;
+    // Names the object in debuggers and validation messages; only has an effect in debug builds
+    void SetDebugName(VkObjectType objectType, uint64_t objectHandle, const char* name) const;
+    // Atomically writes the pipeline cache to disk; also done when the device is destroyed
+    void SavePipelineCache() const;
 
     operator VkDevice() const { return mDevice; }
     VmaAllocator Allocator() const { return mAllocator; }
     uint32_t GetSelectedQueueIndex() const { return mQueueIndex; }
     VkQueue GetSelectedQueue() const { return mQueue; }
     VkSurfaceKHR GetSurface() const { return mSurface; }
+    bool IsHeadless() const { return mSurface == VK_NULL_HANDLE; }
     VkPhysicalDevice GetPhysicalDevice() const { return mPhysicalDevice; }
     VkCommandPool GetCommandPool() const { return mCommandPool; }
+    VkPipelineCache GetPipelineCache() const { return mPipelineCache; }
+    ThreadPool& GetThreadPool() const { return *mThreadPool; }
+    PipelineRegistry& GetPipelineRegistry() const { return *mPipelineRegistry; }
+    DescriptorHeap& GetDescriptorHeap() const { return *mDescriptorHeap; }
+    MemoryTracker& GetMemoryTracker() const { return *mMemoryTracker; }
+    // Where resources defer the destruction of their Vulkan objects to, until the GPU is done with them
+    DeletionQueue& GetDeletionQueue() const { return *mDeletionQueue; }
+    // Whether pipelines were loaded from disk, i.e. pipeline creation skips (most of) the compilation
+    bool HasLoadedPipelineCache() const { return mHasLoadedPipelineCache; }
+    const VkPhysicalDeviceProperties& GetProperties() const { return mProperties; }
+    // Identifies the physical device across instances and processes
+    const std::array<uint8_t, VK_UUID_SIZE>& GetDeviceUUID() const { return mDeviceUUID; }
+    // Number of nanoseconds it takes for a timestamp query to be incremented by 1
+    float GetTimestampPeriod() const { return mProperties.limits.timestampPeriod; }
+    // Number of meaningful bits in the timestamps written on the queue; 0 if the queue can't write timestamps
+    uint32_t GetTimestampValidBits() const { return mTimestampValidBits; }
+    // Ticks from `begin` to `end`, two timestamps of the queue. Only their valid bits count, so it holds across a wraparound.
+    uint64_t GetTimestampTicks(uint64_t begin, uint64_t end) const
+    {
+        const uint64_t validMask = mTimestampValidBits >= 64u ? ~0ull : (1ull << mTimestampValidBits) - 1ull;
+        return (end - begin) & validMask;
+    }
+    // Whether VK_EXT_extended_dynamic_state3 is enabled with support for setting the polygon mode per draw
+    bool IsDynamicPolygonModeSupported() const { return mIsDynamicPolygonModeSupported; }
+    // Whether VK_EXT_calibrated_timestamps is enabled with support for sampling the device and CLOCK_MONOTONIC together
+    bool IsCalibratedTimestampsSupported() const { return mIsCalibratedTimestampsSupported; }
+    // Whether VK_EXT_memory_budget is enabled, i.e. VMA reports the usage and budget of every heap from the driver
+    bool IsMemoryBudgetSupported() const { return mIsMemoryBudgetSupported; }
 
 private:
+    // `window` is null for a headless device
+    void Initialize(const Window* window, bool enableValidationLayer);
+
     VkDebugUtilsMessengerEXT mDebugMessenger = VK_NULL_HANDLE;
     VkSurfaceKHR mSurface = VK_NULL_HANDLE;
 
     VkInstance mInstance = VK_NULL_HANDLE;
     VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties mProperties = {};
+    std::array<uint8_t, VK_UUID_SIZE> mDeviceUUID = {};
+    uint32_t mTimestampValidBits = 0u;
+    bool mIsDynamicPolygonModeSupported = false;
+    bool mIsCalibratedTimestampsSupported = false;
+    bool mIsMemoryBudgetSupported = false;
     VkDevice mDevice = VK_NULL_HANDLE;
 
     VkQueue mQueue;
@@ -34,4 +92,14 @@ private:
 
     VmaAllocator mAllocator = VK_NULL_HANDLE;
     VkCommandPool mCommandPool = VK_NULL_HANDLE;
+
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
+    std::string mPipelineCachePath;
+    bool mHasLoadedPipelineCache = false;
+
+    std::unique_ptr<ThreadPool> mThreadPool;
+    std::unique_ptr<PipelineRegistry> mPipelineRegistry;
+    std::unique_ptr<DescriptorHeap> mDescriptorHeap;
+    std::unique_ptr<MemoryTracker> mMemoryTracker;
+    std::unique_ptr<DeletionQueue> mDeletionQueue;
 };
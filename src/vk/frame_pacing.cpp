@@ -3,6 +3,10 @@
 #include "vk/device.h"
 #include "vk/common.h"
 #include "vk/command_list.h"
+#include "vk/command_pool.h"
+#include "vk/deletion_queue.h"
+
+#include "utils.h"
 
 static inline VkSemaphore CreateSemaphore(VkDevice device)
 {
@@ -23,11 +27,12 @@ static inline VkFence CreateFence(VkDevice device)
 FramePacingState::FramePacingState(const Device& device)
     : mDevice(device)
 {
-    for (auto& state : mFrameStates) {
+    for (auto [frameIndex, state] : enumerate(mFrameStates)) {
         state.imageAvailableSemaphore = CreateSemaphore(device);
         state.renderFinishedSemaphore = CreateSemaphore(device);
         state.inFlightFence = CreateFence(device);
-        state.commandList = device.CreateCommandList();
+        mCommandPools[frameIndex] = std::make_unique<CommandPool>(device);
+        state.commandList = mCommandPools[frameIndex]->AcquireCommandList();
     }
 }
 
@@ -46,9 +51,15 @@ FrameState FramePacingState::GetFrameState(uint32_t frameIndex) const
     return mFrameStates[frameIndex];
 }
 
-void FramePacingState::WaitForFrameInFlight(uint32_t frameIndex) const
+void FramePacingState::WaitForFrameInFlight(uint32_t frameIndex)
 {
-    const auto& frameState = this->GetFrameState(frameIndex);
+    assert(frameIndex < mFrameStates.size());
+    FrameState& frameState = mFrameStates[frameIndex];
     VK_CHECK(vkWaitForFences(mDevice, 1, &frameState.inFlightFence, VK_TRUE, UINT64_MAX));
     VK_CHECK(vkResetFences(mDevice, 1, &frameState.inFlightFence));
+    // Recycles the command buffers the frame was recorded with in one go
+    mCommandPools[frameIndex]->Reset();
+    frameState.commandList = mCommandPools[frameIndex]->AcquireCommandList();
+    // The frames before this one in the same slot have finished, so what they used can be destroyed
+    mDevice.GetDeletionQueue().BeginFrame();
 }
\ No newline at end of file
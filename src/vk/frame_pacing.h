@@ -3,11 +3,12 @@
 constexpr uint32_t kMaxFramesInFlightCount = 2;
 
 class CommandList;
+class CommandPool;
 struct FrameState {
     VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
     VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
     VkFence     inFlightFence           = VK_NULL_HANDLE;
-    Handle<CommandList> commandList     = nullptr;
+    Handle<CommandList> commandList     = nullptr; // Acquired from the pool of the frame, see WaitForFrameInFlight
 };
 
 class Device;
@@ -17,8 +18,12 @@ public:
     ~FramePacingState();
 
     FrameState GetFrameState(uint32_t frameIndex) const;
-    void WaitForFrameInFlight(uint32_t frameIndex) const;
+    // Resets the command pool of the frame and acquires a new command list from it.
+    // Also starts a new frame of the device's DeletionQueue, so it must be called once per frame.
+    void WaitForFrameInFlight(uint32_t frameIndex);
 private:
     const Device& mDevice;
     std::array<FrameState, kMaxFramesInFlightCount> mFrameStates;
+    // Every frame records on one thread, so it has one pool; threads recording in parallel would need one each
+    std::array<std::unique_ptr<CommandPool>, kMaxFramesInFlightCount> mCommandPools;
 };
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "vk/gpu_profiler.h"
+
+#include "vk/device.h"
+#include "vk/common.h"
+#include "vk/command_list.h"
+
+#include "cpu_profiler.h"
+#include "utils.h"
+
+GpuProfiler::GpuProfiler(const Device& device)
+    : mDevice(device)
+{
+    for (FrameQueries& frame : mFrameQueries) {
+        frame.queryPool = std::make_unique<QueryPool>(mDevice, QueryPoolDesc{
+            .type = QueryType::TIMESTAMP,
+            .queryCount = 2 * kMaxScopeCountPerFrame,
+        });
+        frame.scopeIndices.reserve(kMaxScopeCountPerFrame);
+    }
+    mTrack = CpuProfiler::CreateTrack("GPU");
+    this->Calibrate();
+}
+
+void GpuProfiler::Calibrate()
+{
+    if (mDevice.IsCalibratedTimestampsSupported()) {
+        const std::array<VkCalibratedTimestampInfoEXT, 2> timestampInfos = {{
+            { .sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT, .timeDomain = VK_TIME_DOMAIN_DEVICE_EXT },
+            { .sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT, .timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT },
+        }};
+        std::array<uint64_t, 2> timestamps;
+        uint64_t maxDeviation;
+        VK_CHECK(vkGetCalibratedTimestampsEXT(mDevice, uint32_t(timestampInfos.size()), timestampInfos.data(), timestamps.data(), &maxDeviation));
+        mCalibrationTimestamp = timestamps[0];
+        mCalibrationTimeNs = int64_t(timestamps[1]);
+        return;
+    }
+
+    // The timestamp is written somewhat before the submission is found to be complete, so GPU events appear a little early
+    QueryPool& queryPool = *mFrameQueries[0].queryPool;
+    auto cmdList = mDevice.CreateCommandList();
+    cmdList->Open();
+    cmdList->ResetQueries(queryPool, 0, 1);
+    cmdList->WriteTimestamp(queryPool, 0);
+    cmdList->Close();
+    mDevice.ExecuteCommandList(cmdList);
+    mCalibrationTimeNs = GetProfilerTimeNs();
+    if (!queryPool.GetResults(0, 1, &mCalibrationTimestamp)) {
+        LOG_WARN("The GPU profiler couldn't calibrate its timestamps");
+    }
+}
+
+int64_t GpuProfiler::ToProfilerTimeNs(uint64_t timestamp) const
+{
+    const double elapsedTicks = double(int64_t(timestamp - mCalibrationTimestamp));
+    return mCalibrationTimeNs + int64_t(elapsedTicks * double(mDevice.GetTimestampPeriod()));
+}
+
+bool GpuProfiler::BeginFrame(CommandList& cmdList, uint32_t frameIndex)
+{
+    assert(mOpenQueries.empty() && "All scopes of the previous frame must have ended");
+    mFrameIndex = frameIndex;
+    FrameQueries& frame = mFrameQueries[frameIndex];
+
+    bool hasResults = false;
+    if (!frame.scopeIndices.empty()) {
+        std::vector<uint64_t> timestamps(2 * frame.scopeIndices.size());
+        if (frame.queryPool->GetResults(0, uint32_t(timestamps.size()), timestamps.data())) {
+            ++mCollectedFrameCount;
+            std::vector<float> frameTimesMs(mScopes.size(), 0.0f);
+            for (auto [queryPairIdx, scopeIdx] : enumerate(frame.scopeIndices)) {
+                const uint64_t ticks = mDevice.GetTimestampTicks(timestamps[2 * queryPairIdx], timestamps[2 * queryPairIdx + 1]);
+                frameTimesMs[scopeIdx] += float(ticks) * mDevice.GetTimestampPeriod() * 1e-6f;
+            }
+            for (uint32_t scopeIdx : frame.scopeIndices) {
+                ScopeHistory& scope = mScopes[scopeIdx];
+                if (scope.lastFrame == mCollectedFrameCount) continue;
+                scope.timesMs[scope.sampleCount % kHistoryLength] = frameTimesMs[scopeIdx];
+                ++scope.sampleCount;
+                scope.lastFrame = mCollectedFrameCount;
+            }
+            hasResults = true;
+
+            if (CpuProfiler::IsEnabled()) {
+                // Calibrating is cheap with the extension, and keeps the clocks from drifting apart
+                if (mDevice.IsCalibratedTimestampsSupported()) this->Calibrate();
+                for (auto [queryPairIdx, scopeIdx] : enumerate(frame.scopeIndices)) {
+                    CpuProfiler::RecordEvent(mTrack, mScopes[scopeIdx].traceName,
+                        this->ToProfilerTimeNs(timestamps[2 * queryPairIdx]), this->ToProfilerTimeNs(timestamps[2 * queryPairIdx + 1]));
+                }
+            }
+        }
+        frame.scopeIndices.clear();
+    }
+    cmdList.ResetQueries(*frame.queryPool, 0, frame.queryPool->GetQueryCount());
+    return hasResults;
+}
+
+void GpuProfiler::BeginScope(CommandList& cmdList, std::string_view name)
+{
+    FrameQueries& frame = mFrameQueries[mFrameIndex];
+    if (frame.scopeIndices.size() == kMaxScopeCountPerFrame) {
+        if (!mHasWarnedAboutFullPool) {
+            LOG_WARN("More than {} GPU profiler scopes in a frame, the others aren't timed", kMaxScopeCountPerFrame);
+            mHasWarnedAboutFullPool = true;
+        }
+        mOpenQueries.push_back(~0u);
+        return;
+    }
+
+    auto scope = std::find_if(mScopes.begin(), mScopes.end(), [&](const ScopeHistory& history) { return history.name == name; });
+    if (scope == mScopes.end()) {
+        mScopes.push_back({ .name = std::string(name), .traceName = CpuProfiler::InternName(name) });
+        scope = std::prev(mScopes.end());
+    }
+    const uint32_t query = 2 * uint32_t(frame.scopeIndices.size());
+    frame.scopeIndices.push_back(uint32_t(std::distance(mScopes.begin(), scope)));
+    mOpenQueries.push_back(query);
+    cmdList.WriteTimestamp(*frame.queryPool, query);
+}
+
+void GpuProfiler::EndScope(CommandList& cmdList)
+{
+    assert(!mOpenQueries.empty());
+    const uint32_t query = mOpenQueries.back();
+    mOpenQueries.pop_back();
+    if (query == ~0u) return;
+    cmdList.WriteTimestamp(*mFrameQueries[mFrameIndex].queryPool, query + 1);
+}
+
+std::vector<GpuScopeStats> GpuProfiler::GetStats() const
+{
+    std::vector<GpuScopeStats> stats;
+    for (const ScopeHistory& scope : mScopes) {
+        if (scope.sampleCount == 0u) continue;
+        std::vector<float> timesMs(scope.timesMs.begin(), scope.timesMs.begin() + std::min(scope.sampleCount, kHistoryLength));
+        float totalMs = 0.0f;
+        for (float timeMs : timesMs) totalMs += timeMs;
+
+        GpuScopeStats& scopeStats = stats.emplace_back(GpuScopeStats{ .name = scope.name, .averageMs = totalMs / float(timesMs.size()) });
+        const auto median = timesMs.begin() + timesMs.size() / 2;
+        std::nth_element(timesMs.begin(), median, timesMs.end());
+        scopeStats.medianMs = *median;
+        const auto p95 = timesMs.begin() + (timesMs.size() * 95) / 100;
+        std::nth_element(timesMs.begin(), p95, timesMs.end());
+        scopeStats.p95Ms = *p95;
+    }
+    return stats;
+}
+
+float GpuProfiler::GetLastTimeMs(std::string_view name) const
+{
+    for (const ScopeHistory& scope : mScopes) {
+        if (scope.name != name) continue;
+        if (scope.sampleCount == 0u || scope.lastFrame != mCollectedFrameCount) return 0.0f;
+        return scope.timesMs[(scope.sampleCount - 1) % kHistoryLength];
+    }
+    return 0.0f;
+}
+
+std::vector<std::pair<std::string_view, float>> GpuProfiler::GetLastTimesMs() const
+{
+    std::vector<std::pair<std::string_view, float>> times;
+    for (const ScopeHistory& scope : mScopes) {
+        if (scope.sampleCount == 0u || scope.lastFrame != mCollectedFrameCount) continue;
+        times.emplace_back(scope.name, scope.timesMs[(scope.sampleCount - 1) % kHistoryLength]);
+    }
+    return times;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "vk/query_pool.h"
+#include "vk/frame_pacing.h"
+
+// GPU time of a profiled scope over the last frames it was recorded in
+struct GpuScopeStats {
+    std::string name;
+    float averageMs = 0.0f;
+    float medianMs = 0.0f;
+    float p95Ms = 0.0f;
+};
+
+class CommandList;
+class Device;
+struct CpuProfilerTrack;
+// Measures the GPU time of named scopes with timestamp queries. Every frame in flight has its own query pool, which is
+// only read back once that frame has finished executing, so collecting the results never stalls.
+// Scopes with the same name in a frame are added up, e.g. to time all passes of one FFT axis together.
+// While the CpuProfiler is enabled, every scope is also recorded on its GPU track, on the timeline of the CPU events.
+class GpuProfiler {
+public:
+    static constexpr uint32_t kMaxScopeCountPerFrame = 64;
+    static constexpr uint32_t kHistoryLength = 128; // Frames the statistics of every scope are computed over
+
+    explicit GpuProfiler(const Device& device);
+
+    // Collects the results of the previous frame recorded with `frameIndex` and starts a new one; returns whether there
+    // were results. NOTE: That frame must have finished executing, see FramePacingState::WaitForFrameInFlight.
+    bool BeginFrame(CommandList& cmdList, uint32_t frameIndex);
+
+    // Scopes can be nested; they must begin and end in the same frame
+    void BeginScope(CommandList& cmdList, std::string_view name);
+    void EndScope(CommandList& cmdList);
+
+    // In the order the scopes were first recorded
+    std::vector<GpuScopeStats> GetStats() const;
+    // GPU time of the scope in the last frame whose results were collected, or 0 if it wasn't recorded in that frame
+    float GetLastTimeMs(std::string_view name) const;
+    // GPU time of every scope recorded in the last frame whose results were collected, in the order of GetStats()
+    std::vector<std::pair<std::string_view, float>> GetLastTimesMs() const;
+
+private:
+    struct FrameQueries {
+        std::unique_ptr<QueryPool> queryPool;
+        std::vector<uint32_t> scopeIndices; // Index into mScopes of every begin and end query pair
+    };
+
+    struct ScopeHistory {
+        std::string name;
+        const char* traceName = nullptr; // Interned name of the CpuProfiler events
+        std::array<float, kHistoryLength> timesMs = {};
+        uint32_t sampleCount = 0u;
+        uint64_t lastFrame = 0u; // Frame whose results were collected last when the scope was last recorded
+    };
+
+    // Samples a device timestamp and the profiler time at the same moment, to map timestamps to the profiler time.
+    // Without VK_EXT_calibrated_timestamps that moment is only approximated, by waiting for a timestamp to be written.
+    void Calibrate();
+    int64_t ToProfilerTimeNs(uint64_t timestamp) const;
+
+    const Device& mDevice;
+    std::array<FrameQueries, kMaxFramesInFlightCount> mFrameQueries;
+    CpuProfilerTrack* mTrack = nullptr;
+    uint64_t mCalibrationTimestamp = 0u;
+    int64_t mCalibrationTimeNs = 0;
+    uint32_t mFrameIndex = 0u;
+    uint64_t mCollectedFrameCount = 0u;
+    std::vector<ScopeHistory> mScopes;
+    std::vector<uint32_t> mOpenQueries; // Begin queries of the scopes that haven't ended yet
+    bool mHasWarnedAboutFullPool = false;
+};
+
+// Profiles the commands recorded during its lifetime
+class GpuProfileScope {
+public:
+    GpuProfileScope(GpuProfiler& profiler, CommandList& cmdList, std::string_view name)
+        : mProfiler(profiler), mCmdList(cmdList)
+    {
+        mProfiler.BeginScope(mCmdList, name);
+    }
+    ~GpuProfileScope() { mProfiler.EndScope(mCmdList); }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    GpuProfiler& mProfiler;
+    CommandList& mCmdList;
+};
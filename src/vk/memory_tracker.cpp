@@ -0,0 +1,106 @@
+#include "vk/memory_tracker.h"
+
+#include "utils.h"
+
+const char* GetMemoryCategoryName(MemoryCategory category)
+{
+    constexpr std::array<const char*, size_t(MemoryCategory::COUNT)> kNames = {
+        "other", "simulation", "mesh", "gui", "swapchain", "render_graph", "staging"
+    };
+    return kNames[size_t(category)];
+}
+
+MemoryTracker::MemoryTracker(VmaAllocator allocator, bool isBudgetFromDriver)
+    : mAllocator(allocator), mIsBudgetFromDriver(isBudgetFromDriver)
+{
+}
+
+void MemoryTracker::Track(VmaAllocation allocation, MemoryCategory category, const char* debugName)
+{
+    // The category is kept in the allocation, so untracking only needs the allocation
+    vmaSetAllocationUserData(mAllocator, allocation, (void*)uintptr_t(category));
+    if (debugName != nullptr) vmaSetAllocationName(mAllocator, allocation, debugName);
+
+    VmaAllocationInfo allocationInfo;
+    vmaGetAllocationInfo(mAllocator, allocation, &allocationInfo);
+    CategoryCounters& counters = mCategories[size_t(category)];
+    counters.byteSize.fetch_add(allocationInfo.size, std::memory_order_relaxed);
+    counters.allocationCount.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void MemoryTracker::Untrack(VmaAllocation allocation)
+{
+    VmaAllocationInfo allocationInfo;
+    vmaGetAllocationInfo(mAllocator, allocation, &allocationInfo);
+    const auto category = MemoryCategory(uintptr_t(allocationInfo.pUserData));
+    assert(category < MemoryCategory::COUNT);
+    CategoryCounters& counters = mCategories[size_t(category)];
+    counters.byteSize.fetch_sub(allocationInfo.size, std::memory_order_relaxed);
+    counters.allocationCount.fetch_sub(1u, std::memory_order_relaxed);
+}
+
+MemoryReport MemoryTracker::GetReport() const
+{
+    MemoryReport report = { .isBudgetFromDriver = mIsBudgetFromDriver };
+    for (auto [categoryIdx, counters] : enumerate(mCategories)) {
+        report.categories[categoryIdx] = {
+            .byteSize = counters.byteSize.load(std::memory_order_relaxed),
+            .allocationCount = counters.allocationCount.load(std::memory_order_relaxed),
+        };
+    }
+
+    const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+    vmaGetMemoryProperties(mAllocator, &memoryProperties);
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets;
+    vmaGetHeapBudgets(mAllocator, budgets.data());
+    VmaTotalStatistics statistics;
+    vmaCalculateStatistics(mAllocator, &statistics);
+
+    report.heaps.resize(memoryProperties->memoryHeapCount);
+    for (auto [heapIdx, heap] : enumerate(report.heaps)) {
+        const VmaDetailedStatistics& heapStatistics = statistics.memoryHeap[heapIdx];
+        const uint64_t unusedBytes = heapStatistics.statistics.blockBytes - heapStatistics.statistics.allocationBytes;
+        heap = {
+            .isDeviceLocal = (memoryProperties->memoryHeaps[heapIdx].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0u,
+            .usageBytes = budgets[heapIdx].usage,
+            .budgetBytes = budgets[heapIdx].budget,
+            .blockBytes = heapStatistics.statistics.blockBytes,
+            .allocationBytes = heapStatistics.statistics.allocationBytes,
+            .blockCount = heapStatistics.statistics.blockCount,
+            .allocationCount = heapStatistics.statistics.allocationCount,
+            .fragmentation = unusedBytes > 0u ? 1.0f - float(double(heapStatistics.unusedRangeSizeMax) / double(unusedBytes)) : 0.0f,
+        };
+    }
+    return report;
+}
+
+bool MemoryTracker::WriteJson(const std::string& path) const
+{
+    const MemoryReport report = this->GetReport();
+    std::string json = fmt::format("{{\n  \"budget_from_driver\": {},\n  \"categories\": {{", report.isBudgetFromDriver);
+    for (auto [categoryIdx, category] : enumerate(report.categories)) {
+        json += fmt::format("{}\n    \"{}\": {{\"bytes\": {}, \"allocations\": {}}}", categoryIdx == 0 ? "" : ",",
+            GetMemoryCategoryName(MemoryCategory(categoryIdx)), category.byteSize, category.allocationCount);
+    }
+    json += "\n  },\n  \"heaps\": [";
+    for (auto [heapIdx, heap] : enumerate(report.heaps)) {
+        json += fmt::format("{}\n    {{\"index\": {}, \"device_local\": {}, \"usage_bytes\": {}, \"budget_bytes\": {}, "
+            "\"block_bytes\": {}, \"allocation_bytes\": {}, \"blocks\": {}, \"allocations\": {}, \"fragmentation\": {:.4f}}}",
+            heapIdx == 0 ? "" : ",", heapIdx, heap.isDeviceLocal, heap.usageBytes, heap.budgetBytes,
+            heap.blockBytes, heap.allocationBytes, heap.blockCount, heap.allocationCount, heap.fragmentation);
+    }
+
+    // Already JSON, with the name and category (as user data) of every allocation
+    char* vmaStats = nullptr;
+    vmaBuildStatsString(mAllocator, &vmaStats, VK_TRUE);
+    json += fmt::format("\n  ],\n  \"vma\": {}\n}}\n", vmaStats);
+    vmaFreeStatsString(mAllocator, vmaStats);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write(json.data(), json.size())) {
+        LOG_ERROR("Failed to write the memory report to '{}'", path);
+        return false;
+    }
+    LOG_INFO("Wrote the memory report to '{}'", path);
+    return true;
+}
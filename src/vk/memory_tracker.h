@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+
+#include "vk/descs.h"
+
+struct MemoryCategoryStats {
+    uint64_t byteSize = 0u;
+    uint32_t allocationCount = 0u;
+};
+
+struct MemoryHeapStats {
+    bool isDeviceLocal = false;
+    uint64_t usageBytes = 0u;       // Used by the process, as reported by the driver with VK_EXT_memory_budget
+    uint64_t budgetBytes = 0u;      // Usage the process can grow to before allocations start failing or get slow
+    uint64_t blockBytes = 0u;       // Of the memory blocks allocated by VMA
+    uint64_t allocationBytes = 0u;  // Of the allocations placed in those blocks
+    uint32_t blockCount = 0u;
+    uint32_t allocationCount = 0u;
+    // Fraction of the unused memory of the blocks that's not part of their largest free range, i.e. 0 if all of it
+    // could be handed out to a single allocation
+    float fragmentation = 0.0f;
+};
+
+struct MemoryReport {
+    bool isBudgetFromDriver = false; // Otherwise usage and budget are estimated by VMA
+    std::array<MemoryCategoryStats, size_t(MemoryCategory::COUNT)> categories = {};
+    std::vector<MemoryHeapStats> heaps;
+};
+
+const char* GetMemoryCategoryName(MemoryCategory category);
+
+// Accounts every VMA allocation to a MemoryCategory and reports the usage of each category next to the budget and
+// fragmentation of every memory heap. Memory the driver allocates for the swapchain images isn't seen by VMA.
+class MemoryTracker {
+public:
+    MemoryTracker(VmaAllocator allocator, bool isBudgetFromDriver);
+
+    // Names the allocation and adds its size to the category; can be called from any thread
+    void Track(VmaAllocation allocation, MemoryCategory category, const char* debugName);
+    // Must be called before the allocation is freed
+    void Untrack(VmaAllocation allocation);
+
+    // NOTE: Walks all of VMA's blocks, so it's meant to be called a few times per second at most
+    MemoryReport GetReport() const;
+    // The report, followed by VMA's detailed map of every block and named allocation
+    bool WriteJson(const std::string& path) const;
+
+private:
+    struct CategoryCounters {
+        std::atomic<uint64_t> byteSize = 0u;
+        std::atomic<uint32_t> allocationCount = 0u;
+    };
+
+    VmaAllocator mAllocator = VK_NULL_HANDLE;
+    bool mIsBudgetFromDriver = false;
+    std::array<CategoryCounters, size_t(MemoryCategory::COUNT)> mCategories;
+};
@@ -0,0 +1,69 @@
+#include "vk/offscreen_target.h"
+
+#include "vk/device.h"
+#include "vk/common.h"
+#include "vk/command_list.h"
+#include "vk/texture.h"
+
+#include "logger.h"
+
+OffscreenTarget::OffscreenTarget(const Device& device, OffscreenTargetDesc desc)
+    : mDevice(device), mWidth(desc.width), mHeight(desc.height), mFormat(Format::BGRA8_UNORM), mDepthFormat(Format::D32_FLOAT)
+{
+    assert(desc.width > 0 && desc.height > 0 && desc.imageCount > 0);
+    Handle<CommandList> cmdList = device.CreateCommandList();
+    cmdList->Open();
+    // Same format as the swapchain images, so pipelines are interchangeable between both
+    for (uint32_t imageIdx = 0; imageIdx < desc.imageCount; ++imageIdx) {
+        mTextures.push_back(CreateHandle<Texture>(device, TextureDesc{
+            .dimensions = { mWidth, mHeight, 1u },
+            .format = mFormat,
+            .usage = TextureUsageBits::RENDER_TARGET | TextureUsageBits::SAMPLED,
+            .debugName = "Offscreen target",
+            .category = MemoryCategory::SWAPCHAIN,
+        }));
+        cmdList->SetResourceState(*mTextures.back(), ResourceStateBits::SHADER_RESOURCE);
+    }
+    mDepthTexture = CreateHandle<Texture>(device, TextureDesc{
+        .dimensions = { mWidth, mHeight, 1u },
+        .format = mDepthFormat,
+        .usage = TextureUsageBits::DEPTH_STENCIL,
+        .debugName = "Offscreen depth",
+        .category = MemoryCategory::SWAPCHAIN,
+    });
+    cmdList->SetResourceState(*mDepthTexture, ResourceStateBits::DEPTH_WRITE);
+    cmdList->Close();
+    device.ExecuteCommandList(cmdList);
+}
+
+OffscreenTarget::~OffscreenTarget()
+{
+    LOG_INFO("Deleting offscreen target...");
+    mTextures.clear();
+    mDepthTexture = nullptr;
+}
+
+void OffscreenTarget::Submit(Handle<CommandList> cmdList, FrameState frameState)
+{
+    const VkCommandBuffer cmdBuf = cmdList->GetCommandBuffer();
+    const VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1u,
+        .pCommandBuffers = &cmdBuf,
+    };
+    VK_CHECK(vkQueueSubmit(mDevice.GetSelectedQueue(), 1, &submitInfo, frameState.inFlightFence));
+}
+
+uint32_t OffscreenTarget::AcquireNextImage()
+{
+    // The image was last rendered to by the frame this one replaces, which FramePacingState already waited for
+    const uint32_t imageIndex = mNextImageIndex;
+    mNextImageIndex = (mNextImageIndex + 1) % uint32_t(mTextures.size());
+    return imageIndex;
+}
+
+Texture* OffscreenTarget::GetTexture(uint32_t imageIndex)
+{
+    assert(imageIndex < mTextures.size());
+    return mTextures[imageIndex].get();
+}
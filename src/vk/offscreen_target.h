@@ -0,0 +1,41 @@
+#pragma once
+
+#include "descs.h"
+#include "vk/frame_pacing.h"
+
+struct OffscreenTargetDesc {
+    uint32_t width = 0u;                            // Width of the images.
+    uint32_t height = 0u;                           // Height of the images.
+    uint32_t imageCount = kMaxFramesInFlightCount;  // Number of images cycled through, like swapchain images.
+};
+
+class Device;
+class Texture;
+class CommandList;
+// Stands in for the Swapchain when there's no surface to present to, e.g. on a headless Device.
+// Frames are rendered into a ring of images and submitted without presenting; the images start, and are expected
+// to be left, in the SHADER_RESOURCE state so they can be read back once their frame has finished executing.
+class OffscreenTarget {
+public:
+    OffscreenTarget(const Device& device, OffscreenTargetDesc desc);
+    ~OffscreenTarget();
+    // Only signals the in-flight fence of the frame; there are no semaphores to wait on or signal
+    void Submit(Handle<CommandList> cmdList, FrameState frameState);
+
+    uint32_t AcquireNextImage();
+    Texture* GetTexture(uint32_t imageIndex);
+
+    Format GetFormat() const { return mFormat; }
+    Format GetDepthFormat() const { return mDepthFormat; }
+    Texture* GetDepthTexture() const { return mDepthTexture.get(); }
+    Viewport GetViewport() const { return Viewport(float(mWidth), float(mHeight)); }
+private:
+    const Device& mDevice;
+    uint32_t mWidth = 0u;
+    uint32_t mHeight = 0u;
+    Format mFormat = Format::NONE;
+    std::vector<Handle<Texture>> mTextures = {};
+    uint32_t mNextImageIndex = 0u;
+    Format mDepthFormat = Format::NONE;
+    Handle<Texture> mDepthTexture = nullptr; // Shared by all images since only one frame renders at a time
+};
@@ -7,11 +7,15 @@
 #include "vk/texture.h"
 #include "vk/descs_conversions.h"
 #include "vk/command_list.h"
+#include "vk/pipeline_registry.h"
+#include "vk/descriptor_heap.h"
+#include "vk/deletion_queue.h"
 
 #include "logger.h"
 #include "utils.h"
 
 #include <unordered_map>
+#include <future>
 
 static bool UpdateBindingStageFlags(std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutBinding binding)
 {
@@ -78,12 +82,20 @@ static VkDescriptorSetLayout CreateDescriptorSetLayout(VkDevice device, const st
     return descriptorSetLayout;
 }
 
-static VkPipelineLayout CreatePipelineLayout(VkDevice device, VkDescriptorSetLayout setLayout, VkPushConstantRange pushConstants)
+// Set 0 holds the pipeline's push descriptors and set `kDescriptorHeapSet` the global descriptor heap
+static VkPipelineLayout CreatePipelineLayout(
+    VkDevice device,
+    VkDescriptorSetLayout setLayout,
+    VkDescriptorSetLayout heapSetLayout,
+    VkPushConstantRange pushConstants
+)
 {
+    static_assert(kDescriptorHeapSet == 1u);
+    const std::array<VkDescriptorSetLayout, 2> setLayouts = { setLayout, heapSetLayout };
     const VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 1,
-        .pSetLayouts = &setLayout,
+        .setLayoutCount = uint32_t(setLayouts.size()),
+        .pSetLayouts = setLayouts.data(),
         .pushConstantRangeCount = pushConstants.stageFlags != 0 ? 1u : 0u,
         .pPushConstantRanges = pushConstants.stageFlags != 0 ? &pushConstants : nullptr,
     };
@@ -125,14 +137,51 @@ static VkDescriptorUpdateTemplate CreateDescriptorUpdateTemplate(
     return descriptorUpdateTemplate;
 }
 
-static VkPipeline CreateComputePipeline(VkDevice device, VkPipelineLayout pipelineLayout, const Shader& shader)
+// NOTE: The entries point into `constants`, which therefore must outlive the pipeline creation
+static std::vector<VkSpecializationMapEntry> GetSpecializationMapEntries(const std::vector<SpecializationConstant>& constants)
+{
+    std::vector<VkSpecializationMapEntry> entries;
+    entries.reserve(constants.size());
+    for (auto [idx, constant] : enumerate(constants)) {
+        entries.push_back({
+            .constantID = constant.id,
+            .offset = uint32_t(idx * sizeof(SpecializationConstant) + offsetof(SpecializationConstant, value)),
+            .size = sizeof(SpecializationConstant::value),
+        });
+    }
+    return entries;
+}
+
+static VkSpecializationInfo GetSpecializationInfo(
+    const std::vector<SpecializationConstant>& constants,
+    const std::vector<VkSpecializationMapEntry>& entries
+)
+{
+    return {
+        .mapEntryCount = uint32_t(entries.size()),
+        .pMapEntries = entries.data(),
+        .dataSize = constants.size() * sizeof(SpecializationConstant),
+        .pData = constants.data(),
+    };
+}
+
+static VkPipeline CreateComputePipeline(
+    VkDevice device,
+    VkPipelineCache pipelineCache,
+    VkPipelineLayout pipelineLayout,
+    const Shader& shader,
+    const std::vector<SpecializationConstant>& specializationConstants
+)
 {
     assert(shader.GetStage() == VK_SHADER_STAGE_COMPUTE_BIT);
+    const auto specializationMapEntries = GetSpecializationMapEntries(specializationConstants);
+    const VkSpecializationInfo specializationInfo = GetSpecializationInfo(specializationConstants, specializationMapEntries);
     const VkPipelineShaderStageCreateInfo shaderStageCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
         .stage = VK_SHADER_STAGE_COMPUTE_BIT,
         .module = shader.GetShaderModule(),
         .pName = shader.GetEntrypoint(),
+        .pSpecializationInfo = specializationConstants.empty() ? nullptr : &specializationInfo,
     };
     const VkComputePipelineCreateInfo computePipelineCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
@@ -140,7 +189,7 @@ static VkPipeline CreateComputePipeline(VkDevice device, VkPipelineLayout pipeli
         .layout = pipelineLayout,
     };
     VkPipeline computePipeline;
-    VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &computePipeline));
+    VK_CHECK(vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &computePipeline));
     return computePipeline;
 }
 
@@ -149,7 +198,7 @@ struct InputLayout {
     std::vector<VkVertexInputAttributeDescription> attributeDesc;
 };
 
-static InputLayout CreateInputLayout(const std::initializer_list<VertexAttributeDesc> attributeDescs)
+static InputLayout CreateInputLayout(const std::vector<VertexAttributeDesc>& attributeDescs)
 {
     InputLayout layout;
     std::unordered_map<uint32_t, VkVertexInputBindingDescription> bindingMap;
@@ -179,8 +228,17 @@ static InputLayout CreateInputLayout(const std::initializer_list<VertexAttribute
     return layout;
 }
 
-static VkPipeline CreateGraphicsPipeline(VkDevice device, VkPipelineLayout pipelineLayout, const PipelineDesc& desc)
+static VkPipeline CreateGraphicsPipeline(
+    VkDevice device,
+    VkPipelineCache pipelineCache,
+    VkPipelineLayout pipelineLayout,
+    const PipelineDesc& desc,
+    RasterFillMode fillMode,
+    bool isPolygonModeDynamic
+)
 {
+    const auto specializationMapEntries = GetSpecializationMapEntries(desc.specializationConstants);
+    const VkSpecializationInfo specializationInfo = GetSpecializationInfo(desc.specializationConstants, specializationMapEntries);
     std::vector<VkPipelineShaderStageCreateInfo> shaderStageCreateInfos;
     shaderStageCreateInfos.reserve(desc.shaders.size());
     for (const auto& shader : desc.shaders) {
@@ -189,6 +247,7 @@ static VkPipeline CreateGraphicsPipeline(VkDevice device, VkPipelineLayout pipel
             .stage = VkShaderStageFlagBits(shader->GetStage()),
             .module = shader->GetShaderModule(),
             .pName = shader->GetEntrypoint(),
+            .pSpecializationInfo = desc.specializationConstants.empty() ? nullptr : &specializationInfo,
         });
     }
 
@@ -217,7 +276,7 @@ static VkPipeline CreateGraphicsPipeline(VkDevice device, VkPipelineLayout pipel
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
         .depthClampEnable = VK_FALSE,
         .rasterizerDiscardEnable = VK_FALSE,
-        .polygonMode = GetVkPolygonMode(desc.rasterization.fillMode),
+        .polygonMode = GetVkPolygonMode(fillMode),
         .lineWidth = 1.0f,
         .cullMode = GetVkCullModeFlags(desc.rasterization.cullMode),
         .frontFace = GetVkFrontFace(desc.rasterization.cullMode),
@@ -261,10 +320,11 @@ static VkPipeline CreateGraphicsPipeline(VkDevice device, VkPipelineLayout pipel
         .pAttachments = colorBlendAttachments.data(),
     };
 
-    const std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    if (isPolygonModeDynamic) dynamicStates.push_back(VK_DYNAMIC_STATE_POLYGON_MODE_EXT);
     const VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-        .dynamicStateCount = dynamicStates.size(),
+        .dynamicStateCount = uint32_t(dynamicStates.size()),
         .pDynamicStates = dynamicStates.data(),
     };
 
@@ -300,27 +360,64 @@ static VkPipeline CreateGraphicsPipeline(VkDevice device, VkPipelineLayout pipel
         .basePipelineHandle = VK_NULL_HANDLE,
     };
     VkPipeline graphicsPipeline;
-    VK_CHECK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &graphicsPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &graphicsPipeline));
     return graphicsPipeline;
 }
 
-Pipeline::Pipeline(const Device& device, const PipelineDesc& desc)
-    : mDevice(device), mDesc(desc), mBindPoint(GetPipelineBindPoint(desc.type)), mPushConstants(MergePushConstants(desc.shaders))
+PipelineLayout::PipelineLayout(
+    const Device& device,
+    VkPipelineBindPoint bindPoint,
+    const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+    VkPushConstantRange pushConstants
+)
+    : mDevice(device), mPushConstants(pushConstants)
 {
-    const std::vector<VkDescriptorSetLayoutBinding> layoutBindings = MergeSetLayoutBindings(desc.shaders);
-    mSetLayout = CreateDescriptorSetLayout(mDevice, layoutBindings);
-    mPipelineLayout = CreatePipelineLayout(mDevice, mSetLayout, mPushConstants);
-    if (layoutBindings.size() > 0) {
-        mUpdateTemplate = CreateDescriptorUpdateTemplate(mDevice, mSetLayout, mPipelineLayout, mBindPoint, layoutBindings);
+    mSetLayout = CreateDescriptorSetLayout(mDevice, bindings);
+    mPipelineLayout = CreatePipelineLayout(mDevice, mSetLayout, device.GetDescriptorHeap().GetSetLayout(), mPushConstants);
+    if (bindings.size() > 0) {
+        mUpdateTemplate = CreateDescriptorUpdateTemplate(mDevice, mSetLayout, mPipelineLayout, bindPoint, bindings);
     }
+}
+
+PipelineLayout::~PipelineLayout()
+{
+    vkDestroyDescriptorUpdateTemplate(mDevice, mUpdateTemplate, nullptr);
+    vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(mDevice, mSetLayout, nullptr);
+}
+
+Pipeline::Pipeline(const Device& device, const PipelineDesc& desc)
+    : mDevice(device), mType(desc.type), mBindPoint(GetPipelineBindPoint(desc.type))
+{
+    mLayout = device.GetPipelineRegistry().GetOrCreateLayout(mBindPoint, MergeSetLayoutBindings(desc.shaders), MergePushConstants(desc.shaders));
+    const VkPipelineLayout pipelineLayout = *mLayout;
 
     if (desc.type == PipelineType::COMPUTE) {
         assert(desc.shaders.size() == 1);
         const auto& shader = *desc.shaders[0];
-        mPipeline = CreateComputePipeline(mDevice, mPipelineLayout, shader);
+        mPipeline = CreateComputePipeline(mDevice, device.GetPipelineCache(), pipelineLayout, shader, desc.specializationConstants);
     }
     else if (desc.type == PipelineType::GRAPHICS) {
-        mPipeline = CreateGraphicsPipeline(mDevice, mPipelineLayout, desc);
+        const RasterFillMode fillMode = desc.rasterization.fillMode;
+        mIsPolygonModeDynamic = desc.rasterization.isFillModeDynamic && device.IsDynamicPolygonModeSupported();
+        if (desc.rasterization.isFillModeDynamic && !mIsPolygonModeDynamic) {
+            // Build the other fill modes on worker threads while this one builds the requested one,
+            // so switching the fill mode later never has to wait for a pipeline to compile
+            std::array<std::future<VkPipeline>, size_t(RasterFillMode::COUNT)> variants;
+            for (uint32_t mode = 0; mode < uint32_t(RasterFillMode::COUNT); ++mode) {
+                if (RasterFillMode(mode) == fillMode) continue;
+                variants[mode] = std::async(std::launch::async, CreateGraphicsPipeline,
+                    (VkDevice)mDevice, device.GetPipelineCache(), pipelineLayout, std::cref(desc), RasterFillMode(mode), false
+                );
+            }
+            mPipeline = CreateGraphicsPipeline(mDevice, device.GetPipelineCache(), pipelineLayout, desc, fillMode, false);
+            for (auto [mode, variant] : enumerate(variants)) {
+                if (variant.valid()) mFillModeVariants[mode] = variant.get();
+            }
+        }
+        else {
+            mPipeline = CreateGraphicsPipeline(mDevice, device.GetPipelineCache(), pipelineLayout, desc, fillMode, mIsPolygonModeDynamic);
+        }
     }
     else {
         LOG_ERROR("Unknown pipeline type '{}' provided", uint32_t(desc.type));
@@ -330,23 +427,32 @@ Pipeline::Pipeline(const Device& device, const PipelineDesc& desc)
 
 Pipeline::~Pipeline()
 {
-    vkDestroyPipeline(mDevice, mPipeline, nullptr);
-    vkDestroyDescriptorUpdateTemplate(mDevice, mUpdateTemplate, nullptr);
-    vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
-    vkDestroyDescriptorSetLayout(mDevice, mSetLayout, nullptr);
+    // Frames in flight may still be using the pipeline; they also keep its layout alive
+    mDevice.GetDeletionQueue().Push([&device = mDevice, pipeline = mPipeline, variants = mFillModeVariants, layout = mLayout]() {
+        vkDestroyPipeline(device, pipeline, nullptr);
+        for (VkPipeline variant : variants) {
+            vkDestroyPipeline(device, variant, nullptr);
+        }
+    });
 }
 
-void Pipeline::Bind(CommandList* cmdList) const
+void Pipeline::Bind(CommandList* cmdList, RasterFillMode fillMode) const
 {
-    vkCmdBindPipeline(*cmdList, mBindPoint, mPipeline);
+    const VkPipeline variant = mFillModeVariants[size_t(fillMode)];
+    vkCmdBindPipeline(*cmdList, mBindPoint, variant != VK_NULL_HANDLE ? variant : mPipeline);
+    if (mIsPolygonModeDynamic) {
+        vkCmdSetPolygonModeEXT(*cmdList, GetVkPolygonMode(fillMode));
+    }
+    const VkDescriptorSet heapSet = mDevice.GetDescriptorHeap().GetSet();
+    vkCmdBindDescriptorSets(*cmdList, mBindPoint, *mLayout, kDescriptorHeapSet, 1, &heapSet, 0, nullptr);
 }
 
 void Pipeline::PushConstants(CommandList* cmdList, uint32_t byteSize, void* data) const
 {
-    vkCmdPushConstants(*cmdList, mPipelineLayout, mPushConstants.stageFlags, 0u, byteSize, data);
+    vkCmdPushConstants(*cmdList, *mLayout, mLayout->GetPushConstants().stageFlags, 0u, byteSize, data);
 }
 
 void Pipeline::PushDescriptorSet(CommandList* cmdList, uint32_t set, void* bindingData) const
 {
-    vkCmdPushDescriptorSetWithTemplateKHR(*cmdList, mUpdateTemplate, mPipelineLayout, set, bindingData);
+    vkCmdPushDescriptorSetWithTemplateKHR(*cmdList, mLayout->GetUpdateTemplate(), *mLayout, set, bindingData);
 }
\ No newline at end of file
@@ -6,6 +6,9 @@ struct RasterizationDesc {
     CullMode cullMode = CullMode::CCW;
     PrimitiveType primitiveType = PrimitiveType::TRIANGLE_LIST;
     RasterFillMode fillMode = RasterFillMode::SOLID;
+    // Allow switching the fill mode per draw through `GraphicsState::fillMode`. Uses dynamic state if the device
+    // supports it, otherwise a variant is prebuilt for every fill mode.
+    bool isFillModeDynamic = false;
 };
 
 struct DepthStencilDesc {
@@ -20,7 +23,7 @@ struct ColorAttachmentDesc {
 };
 
 struct AttachmentLayout {
-    std::initializer_list<ColorAttachmentDesc> colorAttachments;
+    std::vector<ColorAttachmentDesc> colorAttachments;
     Format depthStencilFormat = Format::NONE;
 };
 
@@ -33,6 +36,12 @@ struct VertexAttributeDesc {
     bool isInstanced = false;
 };
 
+// Value of a `[[vk::constant_id(id)]]` shader constant, fixed when the pipeline is created
+struct SpecializationConstant {
+    uint32_t id = 0;
+    uint32_t value = 0; // 32-bit scalar; bit-cast floats with std::bit_cast
+};
+
 class Shader;
 class Device;
 class Buffer;
@@ -41,30 +50,59 @@ class CommandList;
 struct PipelineDesc {
     PipelineType type;
     std::vector<Shader*> shaders;                                    // Pipeline shaders.
+    std::vector<SpecializationConstant> specializationConstants = {};  // Applied to every shader stage.
     // NOTE: The parameters below are only used by *graphics* pipelines
     AttachmentLayout attachmentLayout = {};                          // Render target layout.
     RasterizationDesc rasterization = {};                            // Rasterization descriptor.
     DepthStencilDesc depthStencil = {};                              // Depth stencil descriptor.
-    std::initializer_list<VertexAttributeDesc> attributeDescs = {};  // (Input) Attribute descriptions
+    std::vector<VertexAttributeDesc> attributeDescs = {};            // (Input) Attribute descriptions
 };
 
+// Descriptor set layout, pipeline layout and push descriptor template of a pipeline.
+// Pipelines with identical reflected layouts share one through the PipelineRegistry.
+class PipelineLayout {
+public:
+    PipelineLayout(
+        const Device& device,
+        VkPipelineBindPoint bindPoint,
+        const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+        VkPushConstantRange pushConstants
+    );
+    ~PipelineLayout();
+
+    VkDescriptorSetLayout GetSetLayout() const { return mSetLayout; }
+    VkDescriptorUpdateTemplate GetUpdateTemplate() const { return mUpdateTemplate; }
+    VkPushConstantRange GetPushConstants() const { return mPushConstants; }
+    operator VkPipelineLayout() const { return mPipelineLayout; }
+
+private:
+    const Device& mDevice;
+    VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorUpdateTemplate mUpdateTemplate = VK_NULL_HANDLE;
+    VkPushConstantRange mPushConstants = {};
+};
+
+// NOTE: Prefer `PipelineRegistry::GetOrCreatePipeline`, which returns the existing pipeline for a repeated desc
 class Pipeline {
 public:
     Pipeline(const Device& device, const PipelineDesc& desc);
     ~Pipeline();
 
-    PipelineType GetPipelineType() const { return mDesc.type; }
+    PipelineType GetPipelineType() const { return mType; }
 
-    void Bind(CommandList* cmdList) const;
+    // NOTE: `fillMode` is ignored unless the pipeline was created with a dynamic fill mode
+    void Bind(CommandList* cmdList, RasterFillMode fillMode = RasterFillMode::SOLID) const;
     void PushConstants(CommandList* cmdList, uint32_t byteSize, void* data) const;
     void PushDescriptorSet(CommandList* cmdList, uint32_t set, void* bindingData) const;
 private:
     const Device& mDevice;
-    PipelineDesc mDesc;
+    // Not the whole desc: its shaders only live while the pipeline is created
+    PipelineType mType;
     VkPipelineBindPoint mBindPoint = VK_PIPELINE_BIND_POINT_MAX_ENUM;
-    VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
-    VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
-    VkDescriptorUpdateTemplate mUpdateTemplate = VK_NULL_HANDLE;
+    Handle<PipelineLayout> mLayout;
     VkPipeline mPipeline = VK_NULL_HANDLE;
-    VkPushConstantRange mPushConstants = {};
+    // Prebuilt variants for a dynamic fill mode without dynamic state support; the desc's own fill mode is `mPipeline`
+    std::array<VkPipeline, size_t(RasterFillMode::COUNT)> mFillModeVariants = {};
+    bool mIsPolygonModeDynamic = false;
 };
\ No newline at end of file
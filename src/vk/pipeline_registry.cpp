@@ -0,0 +1,161 @@
+#include "vk/pipeline_registry.h"
+
+#include "vk/device.h"
+#include "vk/common.h"
+#include "vk/pipeline.h"
+#include "vk/shader.h"
+
+#include "utils.h"
+
+// Appends the bytes of a scalar, enum or handle to a registry key
+template<typename T>
+static void AppendToKey(std::string& key, const T& value)
+{
+    static_assert(std::is_scalar_v<T>, "Only scalars are appended, since the padding of structs isn't initialized");
+    key.append((const char*)&value, sizeof(T));
+}
+
+// Strings are prefixed by their length, so consecutive strings can't run into each other
+static void AppendToKey(std::string& key, std::string_view string)
+{
+    AppendToKey(key, string.size());
+    key.append(string);
+}
+
+static std::string GetPipelineKey(const PipelineDesc& desc)
+{
+    std::string key;
+    AppendToKey(key, desc.type);
+    AppendToKey(key, desc.shaders.size());
+    for (const Shader* shader : desc.shaders) {
+        // Shader modules are deduplicated by their bytecode, so the module stands for it
+        AppendToKey(key, shader->GetShaderModule());
+        AppendToKey(key, std::string_view(shader->GetEntrypoint()));
+    }
+    AppendToKey(key, desc.specializationConstants.size());
+    for (const SpecializationConstant& constant : desc.specializationConstants) {
+        AppendToKey(key, constant.id);
+        AppendToKey(key, constant.value);
+    }
+    AppendToKey(key, desc.attachmentLayout.colorAttachments.size());
+    for (const ColorAttachmentDesc& colorAttachment : desc.attachmentLayout.colorAttachments) {
+        AppendToKey(key, colorAttachment.format);
+        AppendToKey(key, colorAttachment.shouldEnableBlend);
+    }
+    AppendToKey(key, desc.attachmentLayout.depthStencilFormat);
+    AppendToKey(key, desc.rasterization.cullMode);
+    AppendToKey(key, desc.rasterization.primitiveType);
+    AppendToKey(key, desc.rasterization.fillMode);
+    AppendToKey(key, desc.rasterization.isFillModeDynamic);
+    AppendToKey(key, desc.depthStencil.shouldEnableDepthTesting);
+    AppendToKey(key, desc.depthStencil.shouldEnableDepthWrite);
+    AppendToKey(key, desc.depthStencil.depthCompareOp);
+    AppendToKey(key, desc.attributeDescs.size());
+    for (const VertexAttributeDesc& attributeDesc : desc.attributeDescs) {
+        AppendToKey(key, std::string_view(attributeDesc.name));
+        AppendToKey(key, attributeDesc.format);
+        AppendToKey(key, attributeDesc.binding);
+        AppendToKey(key, attributeDesc.offset);
+        AppendToKey(key, attributeDesc.stride);
+        AppendToKey(key, attributeDesc.isInstanced);
+    }
+    return key;
+}
+
+static std::string GetLayoutKey(
+    VkPipelineBindPoint bindPoint,
+    const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+    VkPushConstantRange pushConstants
+)
+{
+    std::string key;
+    AppendToKey(key, bindPoint);
+    AppendToKey(key, bindings.size());
+    for (const VkDescriptorSetLayoutBinding& binding : bindings) {
+        AppendToKey(key, binding.binding);
+        AppendToKey(key, binding.descriptorType);
+        AppendToKey(key, binding.descriptorCount);
+        AppendToKey(key, binding.stageFlags);
+    }
+    AppendToKey(key, pushConstants.stageFlags);
+    AppendToKey(key, pushConstants.offset);
+    AppendToKey(key, pushConstants.size);
+    return key;
+}
+
+// Drops the entries of objects that were destroyed, so the maps only hold what's alive
+template<typename T>
+static void EraseExpired(std::unordered_map<std::string, std::weak_ptr<T>>& registry)
+{
+    std::erase_if(registry, [](const auto& entry) { return entry.second.expired(); });
+}
+
+PipelineRegistry::PipelineRegistry(const Device& device)
+    : mDevice(device)
+{
+}
+
+PipelineRegistry::~PipelineRegistry()
+{
+    for (const auto& [spirv, shaderModule] : mShaderModules) {
+        vkDestroyShaderModule(mDevice, shaderModule, nullptr);
+    }
+}
+
+Handle<Pipeline> PipelineRegistry::GetOrCreatePipeline(const PipelineDesc& desc)
+{
+    const std::string key = GetPipelineKey(desc);
+    {
+        std::lock_guard lock(mMutex);
+        if (auto it = mPipelines.find(key); it != mPipelines.end()) {
+            if (Handle<Pipeline> pipeline = it->second.lock()) return pipeline;
+        }
+    }
+
+    // Compile without holding the lock, so different pipelines still compile concurrently
+    Handle<Pipeline> pipeline = CreateHandle<Pipeline>(mDevice, desc);
+
+    std::lock_guard lock(mMutex);
+    // Another thread may have created the same pipeline in the meantime, in which case ours is dropped
+    if (auto it = mPipelines.find(key); it != mPipelines.end()) {
+        if (Handle<Pipeline> existingPipeline = it->second.lock()) return existingPipeline;
+    }
+    EraseExpired(mPipelines);
+    mPipelines[key] = pipeline;
+    return pipeline;
+}
+
+Handle<PipelineLayout> PipelineRegistry::GetOrCreateLayout(
+    VkPipelineBindPoint bindPoint,
+    const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+    VkPushConstantRange pushConstants
+)
+{
+    std::string key = GetLayoutKey(bindPoint, bindings, pushConstants);
+    std::lock_guard lock(mMutex);
+    if (auto it = mLayouts.find(key); it != mLayouts.end()) {
+        if (Handle<PipelineLayout> layout = it->second.lock()) return layout;
+    }
+
+    auto layout = CreateHandle<PipelineLayout>(mDevice, bindPoint, bindings, pushConstants);
+    EraseExpired(mLayouts);
+    mLayouts[std::move(key)] = layout;
+    return layout;
+}
+
+VkShaderModule PipelineRegistry::GetOrCreateShaderModule(std::span<const uint32_t> spirv)
+{
+    std::string key = std::string((const char*)spirv.data(), spirv.size_bytes());
+    std::lock_guard lock(mMutex);
+    if (auto it = mShaderModules.find(key); it != mShaderModules.end()) return it->second;
+
+    const VkShaderModuleCreateInfo shaderModuleCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = spirv.size_bytes(),
+        .pCode = spirv.data(),
+    };
+    VkShaderModule shaderModule;
+    VK_CHECK(vkCreateShaderModule(mDevice, &shaderModuleCreateInfo, nullptr, &shaderModule));
+    mShaderModules[std::move(key)] = shaderModule;
+    return shaderModule;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <mutex>
+#include <span>
+#include <unordered_map>
+
+class Device;
+class Pipeline;
+class PipelineLayout;
+struct PipelineDesc;
+// Deduplicates pipelines, pipeline layouts and shader modules by their contents, so requesting one that already
+// exists only costs a lookup. Every object is keyed by the bytes of everything it's created from, so a hash
+// collision can't return the wrong one. Thread-safe, since pipelines are created concurrently.
+// Pipelines and layouts stay registered while they're in use; shader modules live as long as the device.
+class PipelineRegistry {
+public:
+    explicit PipelineRegistry(const Device& device);
+    ~PipelineRegistry();
+
+    // Returns the existing pipeline for a repeat of the desc; its shaders are compared by their bytecode
+    Handle<Pipeline> GetOrCreatePipeline(const PipelineDesc& desc);
+    Handle<PipelineLayout> GetOrCreateLayout(
+        VkPipelineBindPoint bindPoint,
+        const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+        VkPushConstantRange pushConstants
+    );
+    VkShaderModule GetOrCreateShaderModule(std::span<const uint32_t> spirv);
+
+private:
+    const Device& mDevice;
+    std::mutex mMutex;
+    // Keyed by the serialized desc, layout or bytecode
+    std::unordered_map<std::string, std::weak_ptr<Pipeline>> mPipelines;
+    std::unordered_map<std::string, std::weak_ptr<PipelineLayout>> mLayouts;
+    std::unordered_map<std::string, VkShaderModule> mShaderModules;
+};
@@ -0,0 +1,44 @@
+#include "vk/query_pool.h"
+
+#include "vk/device.h"
+#include "vk/common.h"
+#include "vk/descs_conversions.h"
+
+QueryPool::QueryPool(const Device& device, QueryPoolDesc desc)
+    : mDevice(device), mType(desc.type), mQueryCount(desc.queryCount)
+{
+    assert(mQueryCount > 0u);
+
+    const VkQueryPoolCreateInfo queryPoolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = GetVkQueryType(desc.type),
+        .queryCount = desc.queryCount,
+        .pipelineStatistics = GetVkQueryPipelineStatisticFlags(desc.type),
+    };
+    VK_CHECK(vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &mQueryPool));
+}
+
+QueryPool::~QueryPool()
+{
+    vkDestroyQueryPool(mDevice, mQueryPool, nullptr);
+}
+
+uint32_t QueryPool::GetResultCountPerQuery() const
+{
+    return mType == QueryType::PIPELINE_STATISTICS ? uint32_t(PipelineStatistic::COUNT) : 1u;
+}
+
+bool QueryPool::GetResults(uint32_t firstQuery, uint32_t queryCount, uint64_t* results) const
+{
+    assert(firstQuery + queryCount <= mQueryCount);
+    const VkDeviceSize stride = this->GetResultCountPerQuery() * sizeof(uint64_t);
+    const VkResult result = vkGetQueryPoolResults(
+        mDevice, mQueryPool,
+        firstQuery, queryCount,
+        queryCount * stride, results, stride,
+        VK_QUERY_RESULT_64_BIT
+    );
+    if (result == VK_NOT_READY) return false;
+    VK_CHECK(result);
+    return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "descs.h"
+
+struct QueryPoolDesc {
+    QueryType type = QueryType::TIMESTAMP;  // Type of the queries in the pool.
+    uint32_t queryCount = 0u;               // Number of queries in the pool.
+};
+
+class Device;
+class QueryPool {
+public:
+    QueryPool(const Device& device, QueryPoolDesc desc);
+    ~QueryPool();
+
+    // Doesn't block; returns false if any of the queries haven't completed yet.
+    // `results` must hold GetResultCountPerQuery() values per query.
+    bool GetResults(uint32_t firstQuery, uint32_t queryCount, uint64_t* results) const;
+
+    QueryType GetType() const { return mType; }
+    uint32_t GetQueryCount() const { return mQueryCount; }
+    uint32_t GetResultCountPerQuery() const;
+
+    operator VkQueryPool() const { return mQueryPool; }
+
+private:
+    const Device& mDevice;
+    VkQueryPool mQueryPool = VK_NULL_HANDLE;
+    QueryType mType = QueryType::TIMESTAMP;
+    uint32_t mQueryCount = 0u;
+};
@@ -0,0 +1,107 @@
+#include "vk/readback_queue.h"
+
+#include "vk/device.h"
+#include "vk/common.h"
+#include "vk/buffer.h"
+#include "vk/texture.h"
+#include "vk/command_list.h"
+#include "vk/descs_conversions.h"
+
+#include "cpu_profiler.h"
+
+// Satisfies the offset alignment of image copies for every format, and keeps readbacks on separate cache lines
+constexpr uint64_t kReadbackAlignment = 64u;
+
+ReadbackQueue::ReadbackQueue(const Device& device, uint64_t byteSizePerFrame)
+    : mDevice(device), mByteSizePerFrame(byteSizePerFrame)
+{
+    for (StagingFrame& frame : mStagingFrames) {
+        frame.buffer = std::make_unique<Buffer>(mDevice, BufferDesc{
+            .byteSize = byteSizePerFrame,
+            .access = MemoryAccess::READBACK,
+            .debugName = "Readback staging",
+            .category = MemoryCategory::STAGING,
+        });
+    }
+}
+
+ReadbackQueue::~ReadbackQueue() = default;
+
+void ReadbackQueue::BeginFrame()
+{
+    PROFILE_ZONE("ReadbackQueue::BeginFrame");
+    ++mFrame;
+    if (mFrame > kMaxFramesInFlightCount) {
+        StagingFrame& completedFrame = mStagingFrames[(mFrame - kMaxFramesInFlightCount) % kStagingBufferCount];
+        if (completedFrame.usedByteSize > 0u) {
+            completedFrame.buffer->InvalidateMappedRange(0u, completedFrame.usedByteSize);
+        }
+        const std::byte* mappedData = (const std::byte*)completedFrame.buffer->GetMappedData();
+        for (const PendingReadback& readback : completedFrame.readbacks) {
+            if (readback.callback) readback.callback({ mappedData + readback.offsetBytes, readback.byteSize });
+        }
+        completedFrame.readbacks.clear();
+    }
+
+    // The staging buffer of the new frame was last read back during the previous frame
+    StagingFrame& frame = mStagingFrames[mFrame % kStagingBufferCount];
+    frame.usedByteSize = 0u;
+    frame.readbacks.clear();
+}
+
+ReadbackTicket ReadbackQueue::Allocate(uint64_t byteSize, ReadbackFn callback)
+{
+    assert(mFrame > 0u && "BeginFrame must be called before recording readbacks");
+    StagingFrame& frame = mStagingFrames[mFrame % kStagingBufferCount];
+    const uint64_t offsetBytes = (frame.usedByteSize + kReadbackAlignment - 1) / kReadbackAlignment * kReadbackAlignment;
+    if (byteSize == 0u || offsetBytes + byteSize > mByteSizePerFrame) {
+        if (!mHasWarnedAboutFullBuffer) {
+            LOG_WARN("Readback of {} bytes doesn't fit into the {} bytes of staging memory per frame; it's dropped", byteSize, mByteSizePerFrame);
+            mHasWarnedAboutFullBuffer = true;
+        }
+        return {};
+    }
+    frame.usedByteSize = offsetBytes + byteSize;
+    frame.readbacks.push_back({ .offsetBytes = offsetBytes, .byteSize = byteSize, .callback = std::move(callback) });
+    return { .frame = mFrame, .offsetBytes = offsetBytes, .byteSize = byteSize };
+}
+
+ReadbackTicket ReadbackQueue::ReadTexture(CommandList& cmdList, Texture& texture, ReadbackFn callback)
+{
+    const uint32_t texelByteSize = GetFormatByteSize(texture.GetFormat());
+    assert(texelByteSize > 0u && "Only uncompressed, single-aspect formats can be read back");
+    const glm::uvec3 size = texture.GetSize();
+    const ReadbackTicket ticket = this->Allocate(uint64_t(size.x) * size.y * size.z * texelByteSize, std::move(callback));
+    if (!ticket.IsValid()) return ticket;
+
+    Buffer& stagingBuffer = *mStagingFrames[mFrame % kStagingBufferCount].buffer;
+    cmdList.SetResourceState(texture, ResourceStateBits::COPY_SOURCE);
+    cmdList.ReadTexture(&stagingBuffer, ticket.offsetBytes, texture);
+    cmdList.SetMemoryBarrier(VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+    return ticket;
+}
+
+ReadbackTicket ReadbackQueue::ReadBuffer(CommandList& cmdList, const Buffer& buffer, uint64_t offsetBytes, uint64_t byteSize, ReadbackFn callback)
+{
+    assert(offsetBytes + byteSize <= buffer.GetSizeInBytes());
+    const ReadbackTicket ticket = this->Allocate(byteSize, std::move(callback));
+    if (!ticket.IsValid()) return ticket;
+
+    Buffer& stagingBuffer = *mStagingFrames[mFrame % kStagingBufferCount].buffer;
+    cmdList.SetMemoryBarrier(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_WRITE_BIT, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+    cmdList.CopyBuffer(&stagingBuffer, ticket.offsetBytes, buffer, offsetBytes, byteSize);
+    cmdList.SetMemoryBarrier(VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+    return ticket;
+}
+
+bool ReadbackQueue::IsReady(const ReadbackTicket& ticket) const
+{
+    return ticket.IsValid() && ticket.frame + kMaxFramesInFlightCount == mFrame;
+}
+
+std::span<const std::byte> ReadbackQueue::GetData(const ReadbackTicket& ticket) const
+{
+    assert(this->IsReady(ticket));
+    const StagingFrame& frame = mStagingFrames[ticket.frame % kStagingBufferCount];
+    return { (const std::byte*)frame.buffer->GetMappedData() + ticket.offsetBytes, ticket.byteSize };
+}
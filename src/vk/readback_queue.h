@@ -0,0 +1,69 @@
+#pragma once
+
+#include <span>
+
+#include "vk/frame_pacing.h"
+
+// Identifies a readback; default-constructed tickets are invalid, e.g. when the staging buffer of the frame was full
+struct ReadbackTicket {
+    uint64_t frame = 0u;        // Frame the copy was recorded in, see ReadbackQueue::BeginFrame
+    uint64_t offsetBytes = 0u;  // Into the staging buffer of that frame
+    uint64_t byteSize = 0u;
+
+    bool IsValid() const { return frame != 0u; }
+};
+
+// Receives the data once the copy has completed; the span points into mapped memory and is only valid during the call
+using ReadbackFn = std::function<void(std::span<const std::byte> data)>;
+
+class Device;
+class Buffer;
+class Texture;
+class CommandList;
+// Reads textures and buffers back to the host without ever waiting for the GPU. Every frame copies into its own
+// persistently mapped, host-cached staging buffer, which is only read once that frame has finished executing, i.e.
+// kMaxFramesInFlightCount frames later. Results are delivered to callbacks or can be polled with their ticket.
+class ReadbackQueue {
+public:
+    // One staging buffer more than frames in flight, so the results of a frame stay valid while the next one records
+    static constexpr uint32_t kStagingBufferCount = kMaxFramesInFlightCount + 1;
+
+    ReadbackQueue(const Device& device, uint64_t byteSizePerFrame);
+    ~ReadbackQueue();
+
+    // Delivers the readbacks of the frame recorded kMaxFramesInFlightCount frames ago and starts a new frame.
+    // NOTE: That frame must have finished executing, see FramePacingState::WaitForFrameInFlight.
+    void BeginFrame();
+
+    // Transitions `texture` to COPY_SOURCE and copies it, tightly packed
+    ReadbackTicket ReadTexture(CommandList& cmdList, Texture& texture, ReadbackFn callback = nullptr);
+    // Waits for all previous writes to `buffer`, e.g. by compute shaders, before copying its range
+    ReadbackTicket ReadBuffer(CommandList& cmdList, const Buffer& buffer, uint64_t offsetBytes, uint64_t byteSize, ReadbackFn callback = nullptr);
+
+    // Whether the data of the readback can be read, which is only the case during the frame its results arrived in
+    bool IsReady(const ReadbackTicket& ticket) const;
+    // NOTE: Only valid until the next BeginFrame
+    std::span<const std::byte> GetData(const ReadbackTicket& ticket) const;
+
+private:
+    struct PendingReadback {
+        uint64_t offsetBytes = 0u;
+        uint64_t byteSize = 0u;
+        ReadbackFn callback;
+    };
+
+    struct StagingFrame {
+        std::unique_ptr<Buffer> buffer;
+        uint64_t usedByteSize = 0u;
+        std::vector<PendingReadback> readbacks;
+    };
+
+    // Reserves a range of the staging buffer of the current frame; returns an invalid ticket if it doesn't fit
+    ReadbackTicket Allocate(uint64_t byteSize, ReadbackFn callback);
+
+    const Device& mDevice;
+    uint64_t mByteSizePerFrame = 0u;
+    std::array<StagingFrame, kStagingBufferCount> mStagingFrames;
+    uint64_t mFrame = 0u; // Frames begun so far; the current frame copies into mStagingFrames[mFrame % kStagingBufferCount]
+    bool mHasWarnedAboutFullBuffer = false;
+};
@@ -2,8 +2,13 @@
 
 #include "vk/device.h"
 #include "vk/common.h"
+#include "vk/pipeline_registry.h"
+#include "vk/descriptor_heap.h"
 
 #include "utils.h"
+#include "mapped_file.h"
+#include "shaders/embedded_shaders.h"
+#include "shaders/shader_layouts.h"
 
 #include <spirv_reflect.h>
 
@@ -41,24 +46,73 @@ static VkDescriptorType GetDescriptorType(SpvReflectDescriptorType reflectDescri
     }
 }
 
+static std::span<const uint32_t> FindEmbeddedShader(std::string_view filename)
+{
+    for (const auto& embeddedShader : GetEmbeddedShaders()) {
+        if (embeddedShader.filename == filename) return embeddedShader.code;
+    }
+    return {};
+}
+
+static const ShaderReflection* FindShaderReflection(std::string_view filename)
+{
+    for (const ShaderReflection* reflection : kShaderReflections) {
+        if (reflection->filename == filename) return reflection;
+    }
+    return nullptr;
+}
+
 Shader::Shader(const Device& device, const char* filename, const char* entrypoint)
     : mDevice(device), mEntrypoint(entrypoint)
 {
-    LOG_INFO("Loading shader '{}' with entrypoint '{}'", filename, entrypoint);
-    std::string spvSource = ReadSourceFile(filename);
+    if (const char* shaderDir = std::getenv("WAVES_SHADER_DIR")) {
+        const std::string path = std::string(shaderDir) + '/' + filename;
+        const MappedFile file = MappedFile(path);
+        if (file.IsValid()) {
+            LOG_INFO("Loading shader '{}' with entrypoint '{}'", path, entrypoint);
+            this->Create(file.GetData<uint32_t>());
+            return;
+        }
+        LOG_WARN("Could not map shader '{}', falling back to the embedded one", path);
+    }
 
-    const VkShaderModuleCreateInfo shaderModuleCreateInfo = {
-        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .codeSize = uint32_t(spvSource.size()),
-        .pCode = (uint32_t*)spvSource.data(),
-    };
-    VK_CHECK(vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr, &mShaderModule));
+    const std::span<const uint32_t> spirv = FindEmbeddedShader(filename);
+    if (spirv.empty()) {
+        LOG_ERROR("Shader '{}' isn't embedded into the executable", filename);
+        // Fatal in release builds too, since an empty shader module is invalid
+        throw std::runtime_error(fmt::format("Shader '{}' isn't embedded into the executable", filename));
+    }
+    LOG_INFO("Loading embedded shader '{}' with entrypoint '{}'", filename, entrypoint);
+    // Embedded shaders were reflected at build time, so skip the runtime reflection
+    const ShaderReflection* reflection = FindShaderReflection(filename);
+    assert(reflection != nullptr);
+    this->Create(spirv, reflection);
+}
+
+Shader::Shader(const Device& device, std::span<const uint32_t> spirv, const char* entrypoint)
+    : mDevice(device), mEntrypoint(entrypoint)
+{
+    this->Create(spirv);
+}
+
+void Shader::Create(std::span<const uint32_t> spirv, const ShaderReflection* reflection)
+{
+    assert(!spirv.empty());
+    mShaderModule = mDevice.GetPipelineRegistry().GetOrCreateShaderModule(spirv);
+
+    if (reflection != nullptr) {
+        mStage = reflection->stage;
+        mPushConstants = reflection->pushConstants;
+        mLayoutBindings.assign(reflection->layoutBindings.begin(), reflection->layoutBindings.end());
+        return;
+    }
 
     SpvReflectShaderModule spvModule;
-    SPV_REFLECT_CALL(spvReflectCreateShaderModule(shaderModuleCreateInfo.codeSize, shaderModuleCreateInfo.pCode, &spvModule));
-    // NOTE: We assume *at most*: 1 entrypoint, 1 descriptor set, 1 push constant block
+    SPV_REFLECT_CALL(spvReflectCreateShaderModule(spirv.size_bytes(), spirv.data(), &spvModule));
+    // NOTE: We assume *at most*: 1 entrypoint, 1 push constant block and 2 descriptor sets,
+    // set 0 for push descriptors and set `kDescriptorHeapSet` for the descriptor heap
     assert(spvModule.entry_point_count == 1);
-    assert(spvModule.descriptor_set_count <= 1);
+    assert(spvModule.descriptor_set_count <= 2);
     assert(spvModule.push_constant_block_count <= 1);
     mStage = GetShaderStage(spvModule.shader_stage);
 
@@ -77,6 +131,9 @@ Shader::Shader(const Device& device, const char* filename, const char* entrypoin
 
     mLayoutBindings.reserve(spvBindingCount);
     for (int bindingIndex = 0; bindingIndex < spvBindingCount; ++bindingIndex) {
+        // The descriptor heap's layout is shared by all pipelines rather than reflected
+        if (spvBindings[bindingIndex]->set == kDescriptorHeapSet) continue;
+        assert(spvBindings[bindingIndex]->set == 0);
         mLayoutBindings.push_back({
             .binding = spvBindings[bindingIndex]->binding,
             .descriptorCount = 1,
@@ -87,8 +144,3 @@ Shader::Shader(const Device& device, const char* filename, const char* entrypoin
     }
     spvReflectDestroyShaderModule(&spvModule);
 }
-
-Shader::~Shader()
-{
-    vkDestroyShaderModule(mDevice, mShaderModule, nullptr);
-}
\ No newline at end of file
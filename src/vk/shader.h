@@ -1,20 +1,29 @@
 #pragma once
 
+#include <span>
+
+struct ShaderReflection;
 class Device;
 class Shader {
 public:
+    // Uses the SPIR-V embedded into the executable, unless the WAVES_SHADER_DIR environment variable is set.
+    // In that case, the file is memory-mapped from that directory instead so shaders can be swapped without rebuilding.
+    // Embedded shaders use the layout reflected at build time, other SPIR-V is reflected when it's loaded.
     Shader(const Device& device, const char* filename, const char* entrypoint = "main");
-    ~Shader();
+    Shader(const Device& device, std::span<const uint32_t> spirv, const char* entrypoint = "main");
 
     std::vector<VkDescriptorSetLayoutBinding> GetLayoutBindings() const { return mLayoutBindings; }
     VkPushConstantRange GetPushConstants() const { return mPushConstants; }
     const char* GetEntrypoint() const { return mEntrypoint; }
+    // Identical bytecode shares the same shader module, so the module identifies the bytecode
     VkShaderModule GetShaderModule() const { return mShaderModule; }
     VkShaderStageFlags GetStage() const { return mStage; }
 
 private:
+    void Create(std::span<const uint32_t> spirv, const ShaderReflection* reflection = nullptr);
+
     const Device& mDevice;
-    VkShaderModule mShaderModule = VK_NULL_HANDLE;
+    VkShaderModule mShaderModule = VK_NULL_HANDLE; // Owned by the PipelineRegistry
     VkShaderStageFlags mStage = VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM;
     const char* mEntrypoint = "main";
     std::vector<VkDescriptorSetLayoutBinding> mLayoutBindings = {};
@@ -84,7 +84,7 @@ static VkSwapchainKHR CreateSwapchain(
 }
 
 Swapchain::Swapchain(const Device& device, SwapchainDesc desc)
-    : mDevice(device), mFormat(Format::BGRA8_UNORM)
+    : mDevice(device), mFormat(Format::BGRA8_UNORM), mDepthFormat(Format::D32_FLOAT)
 {
     const VkSurfaceFormatKHR surfaceFormat = SelectSwapchainSurfaceFormat(device);
     const VkPresentModeKHR presentMode = SelectSwapchainPresentMode(device, desc.shouldEnableVsync);
@@ -107,10 +107,20 @@ Swapchain::Swapchain(const Device& device, SwapchainDesc desc)
         mTextures.emplace_back(device, TextureDesc{
             .dimensions = { mExtent.width, mExtent.height, 1u },
             .format = mFormat,
-            .resource = swapchainImage
+            .resource = swapchainImage,
+            .debugName = "Swapchain image",
+            .category = MemoryCategory::SWAPCHAIN,
         });
         cmdList->SetResourceState(mTextures.back(), ResourceStateBits::PRESENT);
     }
+    mDepthTexture = CreateHandle<Texture>(device, TextureDesc{
+        .dimensions = { mExtent.width, mExtent.height, 1u },
+        .format = mDepthFormat,
+        .usage = TextureUsageBits::DEPTH_STENCIL,
+        .debugName = "Swapchain depth",
+        .category = MemoryCategory::SWAPCHAIN,
+    });
+    cmdList->SetResourceState(*mDepthTexture, ResourceStateBits::DEPTH_WRITE);
     cmdList->Close();
     device.ExecuteCommandList(cmdList);
 }
@@ -119,6 +129,7 @@ Swapchain::~Swapchain()
 {
     LOG_INFO("Deleting swapchain...");
     mTextures.clear();
+    mDepthTexture = nullptr;
     vkDestroySwapchainKHR(mDevice, mSwapchain, nullptr);
 }
 
@@ -25,6 +25,8 @@ public:
     Texture* GetTexture(uint32_t imageIndex);
 
     Format GetFormat() const { return mFormat; }
+    Format GetDepthFormat() const { return mDepthFormat; }
+    Texture* GetDepthTexture() const { return mDepthTexture.get(); }
     Viewport GetViewport() const { return Viewport(mExtent.width, mExtent.height); }
 private:
     const Device& mDevice;
@@ -32,4 +34,6 @@ private:
     VkExtent2D mExtent = {};
     Format mFormat = Format::NONE;
     std::vector<Texture> mTextures = {};
+    Format mDepthFormat = Format::NONE;
+    Handle<Texture> mDepthTexture = nullptr; // Shared by all swapchain images since only one frame renders at a time
 };
\ No newline at end of file
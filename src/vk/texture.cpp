@@ -3,6 +3,11 @@
 #include "vk/device.h"
 #include "vk/common.h"
 #include "vk/descs_conversions.h"
+#include "vk/descriptor_heap.h"
+#include "vk/memory_tracker.h"
+#include "vk/deletion_queue.h"
+
+#include "utils.h"
 
 #include <map>
 
@@ -12,18 +17,6 @@ struct GlobalSamplerState {
 };
 static std::map<std::size_t, GlobalSamplerState> gSamplerStateCache;
 
-template <class T>
-inline void HashCombine(std::size_t& seed, const T& v)
-{
-    constexpr std::size_t kMul = 0x9ddfea08eb382d69ULL;
-    std::hash<T> hasher;
-    std::size_t a = (hasher(v) ^ seed) * kMul;
-    a ^= (a >> 47);
-    std::size_t b = (seed ^ a) * kMul;
-    b ^= (b >> 47);
-    seed = b * kMul;
-}
-
 static std::size_t CalculateSamplerHash(SamplerDesc desc)
 {
     std::size_t hash = 0;
@@ -86,6 +79,39 @@ static VkImageView CreateImageView(
     return imageView;
 }
 
+static VkImageCreateInfo GetImageCreateInfo(const TextureDesc& desc)
+{
+    return {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = GetVkFormat(desc.format),
+        .extent = {
+            .width = desc.dimensions.x,
+            .height = desc.dimensions.y,
+            .depth = desc.dimensions.z,
+        },
+        .mipLevels = desc.mipCount,
+        .arrayLayers = 1u,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = GetVkImageUsageFlags(desc.usage),
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+}
+
+VkMemoryRequirements Texture::GetMemoryRequirements(const Device& device, const TextureDesc& desc)
+{
+    const VkImageCreateInfo imageCreateInfo = GetImageCreateInfo(desc);
+    const VkDeviceImageMemoryRequirements imageMemoryRequirements = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+        .pCreateInfo = &imageCreateInfo,
+    };
+    VkMemoryRequirements2 memoryRequirements = { .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+    vkGetDeviceImageMemoryRequirements(device, &imageMemoryRequirements, &memoryRequirements);
+    return memoryRequirements.memoryRequirements;
+}
+
 Texture::Texture(const Device& device, TextureDesc desc)
     : mDevice(device), mDimensions(desc.dimensions), mMipIndex(0), mMipCount(desc.mipCount),
       mFormat(desc.format), mImage((VkImage)desc.resource), mFromExistingResource(desc.resource != nullptr)
@@ -97,53 +123,64 @@ Texture::Texture(const Device& device, TextureDesc desc)
     if (!mFromExistingResource) {
         assert(desc.usage != TextureUsageBits::NONE);
 
-        const VkImageCreateInfo imageCreateInfo = {
-            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-            .imageType = VK_IMAGE_TYPE_2D,
-            .format = GetVkFormat(desc.format),
-            .extent = {
-                .width = desc.dimensions.x,
-                .height = desc.dimensions.y,
-                .depth = desc.dimensions.z,
-            },
-            .mipLevels = desc.mipCount,
-            .arrayLayers = 1u,
-            .samples = VK_SAMPLE_COUNT_1_BIT,
-            .tiling = VK_IMAGE_TILING_OPTIMAL,
-            .usage = GetVkImageUsageFlags(desc.usage),
-            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        };
-
-        const VmaAllocationCreateInfo allocationCreateInfo = {
-            .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
-        };
-
-        VK_CHECK(
-            vmaCreateImage(device.Allocator(), &imageCreateInfo,
-                &allocationCreateInfo, &mImage, &mAllocation, nullptr
-            )
-        );
+        const VkImageCreateInfo imageCreateInfo = GetImageCreateInfo(desc);
+        if (desc.aliasedMemory != VK_NULL_HANDLE) {
+            // The memory is owned by whoever aliases it, so only the image is created and destroyed here
+            VK_CHECK(vkCreateImage(device, &imageCreateInfo, nullptr, &mImage));
+            VK_CHECK(vmaBindImageMemory(device.Allocator(), desc.aliasedMemory, mImage));
+        }
+        else {
+            const VmaAllocationCreateInfo allocationCreateInfo = {
+                .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+            };
+
+            VK_CHECK(
+                vmaCreateImage(device.Allocator(), &imageCreateInfo,
+                    &allocationCreateInfo, &mImage, &mAllocation, nullptr
+                )
+            );
+            device.GetMemoryTracker().Track(mAllocation, desc.category, desc.debugName);
+        }
     }
+    device.SetDebugName(VK_OBJECT_TYPE_IMAGE, uint64_t(mImage), desc.debugName);
     mSamplerState = CreateOrGetSamplerState(device, desc.sampler);
     mImageView = CreateImageView(device, mImage, desc.format, 0u, desc.mipCount);
+
+    DescriptorHeap& descriptorHeap = device.GetDescriptorHeap();
+    if (IsSet(desc.usage, TextureUsageBits::SAMPLED)) {
+        mSampledIndex = descriptorHeap.AllocateTexture(DescriptorHeapBinding::SAMPLED_TEXTURE, mImageView);
+    }
+    if (IsSet(desc.usage, TextureUsageBits::STORAGE)) {
+        mStorageIndex = descriptorHeap.AllocateTexture(DescriptorHeapBinding::STORAGE_TEXTURE, mImageView);
+    }
 }
 
 Texture::~Texture()
 {
-    vkDestroyImageView(mDevice, mImageView, nullptr);
-
-    // Destroy sampler
-    GlobalSamplerState& samplerState = gSamplerStateCache[mSamplerState.hash];
-    assert(samplerState.sampler == mSamplerState.sampler);
-    assert(samplerState.count > 0u);
-    if (samplerState.count-- == 1u) {
-        vkDestroySampler(mDevice, samplerState.sampler, nullptr);
-    }
+    // Frames in flight may still access the image through its view and descriptors
+    const VkImage image = mFromExistingResource ? VK_NULL_HANDLE : mImage;
+    mDevice.GetDeletionQueue().Push([&device = mDevice, image, allocation = mAllocation, imageView = mImageView,
+        samplerState = mSamplerState, sampledIndex = mSampledIndex, storageIndex = mStorageIndex]() {
+        device.GetDescriptorHeap().Free(DescriptorHeapBinding::SAMPLED_TEXTURE, sampledIndex);
+        device.GetDescriptorHeap().Free(DescriptorHeapBinding::STORAGE_TEXTURE, storageIndex);
+        vkDestroyImageView(device, imageView, nullptr);
+
+        // Destroy sampler
+        auto cachedSamplerState = gSamplerStateCache.find(samplerState.hash);
+        assert(cachedSamplerState != gSamplerStateCache.end() && cachedSamplerState->second.sampler == samplerState.sampler);
+        assert(cachedSamplerState->second.count > 0u);
+        if (cachedSamplerState->second.count-- == 1u) {
+            vkDestroySampler(device, samplerState.sampler, nullptr);
+            gSamplerStateCache.erase(cachedSamplerState);
+        }
 
-    if (!mFromExistingResource) {
-        vmaDestroyImage(mDevice.Allocator(), mImage, mAllocation);
-    }
+        if (allocation != VK_NULL_HANDLE) {
+            device.GetMemoryTracker().Untrack(allocation);
+        }
+        if (image != VK_NULL_HANDLE) {
+            vmaDestroyImage(device.Allocator(), image, allocation); // Only destroys the image of aliased memory
+        }
+    });
 }
 
 VkImageLayout Texture::GetLayout() const
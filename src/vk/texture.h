@@ -14,6 +14,9 @@ struct TextureDesc {
     TextureUsageBits usage = TextureUsageBits::NONE;   // Texture usage flags.
     SamplerDesc sampler = {};                          // Sampler descriptor.
     void* resource = nullptr;                          // [Optional] Usually used for swapchain images.
+    VmaAllocation aliasedMemory = VK_NULL_HANDLE;      // [Optional] Memory shared with other textures to place it in.
+    const char* debugName = nullptr;                   // [Optional] Names the image, and its allocation in memory reports.
+    MemoryCategory category = MemoryCategory::OTHER;   // What the memory is accounted to in memory reports.
 };
 
 class Device;
@@ -30,11 +33,18 @@ public:
     Texture(const Device& device, TextureDesc desc);
     ~Texture();
 
+    // Memory a texture with this desc needs, e.g. to size memory that's aliased by several textures
+    static VkMemoryRequirements GetMemoryRequirements(const Device& device, const TextureDesc& desc);
+
     VkImageView GetView() const { return mImageView; }
     VkImage GetImage() const { return mImage; }
     VkSampler GetSampler() const { return mSamplerState.sampler; }
     Format GetFormat() const { return mFormat; }
     VkImageLayout GetLayout() const;
+    // Index into the descriptor heap, for accessing the texture by index in shaders;
+    // only valid if the texture was created with the matching usage
+    uint32_t GetSampledIndex() const { assert(mSampledIndex != ~0u); return mSampledIndex; }
+    uint32_t GetStorageIndex() const { assert(mStorageIndex != ~0u); return mStorageIndex; }
 
     glm::uvec3 GetSize() const { return mDimensions; }
     uint32_t GetWidth() const { return mDimensions.x; }
@@ -53,6 +63,10 @@ private:
     VkImage mImage = VK_NULL_HANDLE;
     VmaAllocation mAllocation = VK_NULL_HANDLE;
     bool mFromExistingResource = false;
+    uint32_t mSampledIndex = ~0u;
+    uint32_t mStorageIndex = ~0u;
 
     ResourceStateBits mResourceMask = ResourceStateBits::COMMON;
+    VkPipelineStageFlags2 mStageMask = VK_PIPELINE_STAGE_2_NONE; // Stages that last accessed the texture
+    VkAccessFlags2 mAliasAccessMask = VK_ACCESS_2_NONE; // Writes of the previous alias of the memory, made available by the next barrier
 };
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "workgroup_tuner.h"
+
+#include "vk/device.h"
+#include "vk/command_list.h"
+#include "vk/query_pool.h"
+
+#include "utils.h"
+
+// Dispatches recorded before timing, so caches and clocks have warmed up
+constexpr uint32_t kWarmupDispatchCount = 2u;
+constexpr uint32_t kTimedDispatchCount = 8u;
+
+static std::string GetTuningCachePath(const Device& device)
+{
+    std::string uuid;
+    for (uint8_t byte : device.GetDeviceUUID()) uuid += fmt::format("{:02x}", byte);
+    const VkPhysicalDeviceProperties& properties = device.GetProperties();
+    return fmt::format("workgroup_tuning_{:04x}_{:04x}_{}.txt", properties.vendorID, properties.deviceID, uuid);
+}
+
+// Every line of the cache holds a kernel name and the shader filename of its fastest variant
+WorkgroupPicks WorkgroupTuner::LoadPicks(const std::string& path)
+{
+    WorkgroupPicks picks;
+    std::ifstream file(path);
+    std::string name, shaderFilename;
+    while (file >> name >> shaderFilename) picks[name] = shaderFilename;
+    return picks;
+}
+
+WorkgroupTuner::WorkgroupTuner(const Device& device, PipelineDesc desc, const WorkgroupPicks* pinnedPicks)
+    : mDevice(device), mDesc(std::move(desc)), mCachePath(GetTuningCachePath(device))
+{
+    if (pinnedPicks != nullptr) {
+        mPicks = *pinnedPicks;
+        mArePicksPinned = true;
+        return;
+    }
+    if (std::getenv("WAVES_RETUNE_WORKGROUPS") != nullptr) {
+        LOG_INFO("Ignoring the workgroup tuning cache '{}'", mCachePath);
+        return;
+    }
+    mPicks = LoadPicks(mCachePath);
+}
+
+WorkgroupTuner::~WorkgroupTuner()
+{
+    this->Save();
+}
+
+void WorkgroupTuner::AddKernel(const std::string& name, std::vector<KernelVariant> variants)
+{
+    assert(!variants.empty() && !mKernels.contains(name));
+    Kernel& kernel = mKernels[name];
+    kernel.variants = std::move(variants);
+
+    // Only compile the cached pick, unless the variants changed since it was made
+    if (const auto pick = mPicks.find(name); pick != mPicks.end()) {
+        const auto variant = std::find_if(kernel.variants.begin(), kernel.variants.end(), [&](const KernelVariant& variant) {
+            return variant.shaderFilename == pick->second;
+        });
+        if (variant != kernel.variants.end()) {
+            kernel.variants = { *variant };
+            kernel.isCached = true;
+        }
+    }
+    if (mArePicksPinned && !kernel.isCached) {
+        LOG_WARN("No pinned variant of kernel '{}' exists, so it's tuned", name);
+    }
+    for (const KernelVariant& variant : kernel.variants) {
+        kernel.pipelines.push_back(mDevice.CreatePipelineAsync(mDesc, { variant.shaderFilename }));
+    }
+}
+
+TunedKernel WorkgroupTuner::Resolve(const std::string& name, const RecordDispatchFn& recordDispatch)
+{
+    assert(mKernels.contains(name));
+    const Kernel& kernel = mKernels.at(name);
+    if (kernel.isCached) {
+        return { .pipeline = kernel.pipelines[0].get(), .workGroupSize = kernel.variants[0].workGroupSize };
+    }
+    if (mDevice.GetTimestampValidBits() == 0u) {
+        // Nothing to time with; the first variant is used, but not cached, since it wasn't measured
+        LOG_WARN("The queue doesn't support timestamps, so kernel '{}' uses '{}' untuned", name, kernel.variants[0].shaderFilename);
+        return { .pipeline = kernel.pipelines[0].get(), .workGroupSize = kernel.variants[0].workGroupSize };
+    }
+
+    QueryPool timestampQueryPool = QueryPool(mDevice, { .type = QueryType::TIMESTAMP, .queryCount = 2 });
+    TunedKernel fastestKernel = {};
+    float fastestTimeMs = std::numeric_limits<float>::max();
+    for (auto [idx, variant] : enumerate(kernel.variants)) {
+        const TunedKernel candidate = { .pipeline = kernel.pipelines[idx].get(), .workGroupSize = variant.workGroupSize };
+
+        auto cmdList = mDevice.CreateCommandList();
+        cmdList->Open();
+        cmdList->ResetQueries(timestampQueryPool, 0, 2);
+        for (uint32_t i = 0; i < kWarmupDispatchCount; ++i) recordDispatch(*cmdList, candidate);
+        cmdList->WriteTimestamp(timestampQueryPool, 0);
+        for (uint32_t i = 0; i < kTimedDispatchCount; ++i) recordDispatch(*cmdList, candidate);
+        cmdList->WriteTimestamp(timestampQueryPool, 1);
+        cmdList->Close();
+        mDevice.ExecuteCommandList(cmdList);
+
+        std::array<uint64_t, 2> timestamps;
+        const bool hasResults = timestampQueryPool.GetResults(0, 2, timestamps.data());
+        assert(hasResults); // The queue is idle after ExecuteCommandList
+        const float timeMs = float(mDevice.GetTimestampTicks(timestamps[0], timestamps[1])) * mDevice.GetTimestampPeriod() * 1e-6f / kTimedDispatchCount;
+        LOG_INFO("Kernel '{}' takes {:.3f} ms with '{}'", name, timeMs, variant.shaderFilename);
+        if (timeMs < fastestTimeMs) {
+            fastestTimeMs = timeMs;
+            fastestKernel = candidate;
+            mPicks[name] = variant.shaderFilename;
+        }
+    }
+    LOG_INFO("Picked '{}' for kernel '{}'", mPicks[name], name);
+    mHasNewPicks = true;
+    return fastestKernel;
+}
+
+void WorkgroupTuner::Save()
+{
+    if (!mHasNewPicks || mArePicksPinned) return;
+    std::ofstream file(mCachePath, std::ios::trunc);
+    for (const auto& [name, shaderFilename] : mPicks) file << name << ' ' << shaderFilename << '\n';
+    if (!file.good()) {
+        LOG_WARN("Failed to save the workgroup tuning cache '{}'", mCachePath);
+        return;
+    }
+    LOG_INFO("Saved the workgroup tuning cache to '{}'", mCachePath);
+    mHasNewPicks = false;
+}
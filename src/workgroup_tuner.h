@@ -0,0 +1,63 @@
+#pragma once
+
+#include "vk/pipeline.h"
+
+#include <unordered_map>
+
+// One build of a compute kernel, e.g. with a different workgroup shape
+struct KernelVariant {
+    std::string shaderFilename;  // Compiled shader, e.g. "phase.cs.wg16.spv"
+    uint32_t workGroupSize = 0u; // Size of the workgroup along every dimension the kernel is dispatched in
+};
+
+// Kernel name -> shader filename of its fastest variant
+using WorkgroupPicks = std::unordered_map<std::string, std::string>;
+
+struct TunedKernel {
+    Handle<Pipeline> pipeline;
+    uint32_t workGroupSize = 0u;
+};
+
+class CommandList;
+class Device;
+// Picks the fastest variant of every compute kernel by timing them with GPU timestamps.
+// The picks are cached per device, so later launches only compile the picked variants. Set the
+// WAVES_RETUNE_WORKGROUPS environment variable to ignore the cache and time every variant again.
+// Pinned picks replace the cache, e.g. so benchmarks run the same variants whatever the timings.
+class WorkgroupTuner {
+public:
+    // Records one representative dispatch of a variant; it's recorded several times in a row to time it
+    using RecordDispatchFn = std::function<void(CommandList& cmdList, const TunedKernel& kernel)>;
+
+    // `desc` is shared by the pipelines of all kernels; its shaders are filled in per variant.
+    // Kernels with a pinned pick use it; the cache is then neither read nor written.
+    WorkgroupTuner(const Device& device, PipelineDesc desc, const WorkgroupPicks* pinnedPicks = nullptr);
+
+    // Starts creating the pipeline of the cached pick in the background, or those of all variants if there's none
+    void AddKernel(const std::string& name, std::vector<KernelVariant> variants);
+    // Joins the kernel's pipelines, times them with `recordDispatch` unless the pick is cached, and returns the fastest.
+    // NOTE: Blocks until the GPU is idle when timing.
+    TunedKernel Resolve(const std::string& name, const RecordDispatchFn& recordDispatch);
+
+    // Writes the picks to disk if any were made since the last save; also done when the tuner is destroyed
+    void Save();
+    const WorkgroupPicks& GetPicks() const { return mPicks; }
+    // Reads picks in the format of the cache, e.g. to pin them; empty if the file couldn't be read
+    static WorkgroupPicks LoadPicks(const std::string& path);
+    ~WorkgroupTuner();
+
+private:
+    struct Kernel {
+        std::vector<KernelVariant> variants;
+        std::vector<std::shared_future<Handle<Pipeline>>> pipelines; // One per variant; only the picked one if cached
+        bool isCached = false;
+    };
+
+    const Device& mDevice;
+    PipelineDesc mDesc;
+    std::string mCachePath;
+    std::unordered_map<std::string, Kernel> mKernels;
+    WorkgroupPicks mPicks;
+    bool mHasNewPicks = false;
+    bool mArePicksPinned = false;
+};
@@ -0,0 +1,209 @@
+// Reflects compiled SPIR-V shaders at build time and generates a C++ header with their descriptor set layouts,
+// binding indices and push constant structs, so the application doesn't need to reflect shaders at runtime.
+// Usage: shader_reflect <output.h> <shader.spv>...
+
+#include <spirv_reflect.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+[[noreturn]] static void Fail(const std::string& message)
+{
+    fprintf(stderr, "shader_reflect: error: %s\n", message.c_str());
+    exit(1);
+}
+
+static std::vector<uint32_t> ReadSpirv(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.good()) Fail("could not open '" + path.string() + "'");
+    const size_t byteSize = size_t(file.tellg());
+    if (byteSize == 0 || byteSize % sizeof(uint32_t) != 0) Fail("'" + path.string() + "' is not a valid SPIR-V binary");
+    std::vector<uint32_t> code(byteSize / sizeof(uint32_t));
+    file.seekg(0);
+    file.read((char*)code.data(), byteSize);
+    return code;
+}
+
+// "ocean.vs.spv" -> "ocean_vs"
+static std::string GetNamespaceName(const std::filesystem::path& path)
+{
+    std::string name = path.stem().string();
+    for (char& c : name) {
+        if (!isalnum(c)) c = '_';
+    }
+    return name;
+}
+
+// "gOutNormalMap" -> "OutNormalMap"
+static std::string GetConstantName(std::string name)
+{
+    if (name.size() > 1 && name[0] == 'g' && isupper(name[1])) name.erase(0, 1);
+    if (!name.empty()) name[0] = toupper(name[0]);
+    return name;
+}
+
+static const char* GetVkShaderStageName(SpvReflectShaderStageFlagBits stage)
+{
+    switch (stage) {
+        case SPV_REFLECT_SHADER_STAGE_COMPUTE_BIT:  return "VK_SHADER_STAGE_COMPUTE_BIT";
+        case SPV_REFLECT_SHADER_STAGE_VERTEX_BIT:   return "VK_SHADER_STAGE_VERTEX_BIT";
+        case SPV_REFLECT_SHADER_STAGE_FRAGMENT_BIT: return "VK_SHADER_STAGE_FRAGMENT_BIT";
+        default: Fail("unsupported shader stage");
+    }
+}
+
+static const char* GetVkDescriptorTypeName(SpvReflectDescriptorType type)
+{
+    switch (type) {
+        case SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_BUFFER:         return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER";
+        case SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: return "VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER";
+        case SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_IMAGE:          return "VK_DESCRIPTOR_TYPE_STORAGE_IMAGE";
+        case SPV_REFLECT_DESCRIPTOR_TYPE_SAMPLED_IMAGE:          return "VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE";
+        default: Fail("unsupported descriptor type");
+    }
+}
+
+struct MemberType {
+    std::string name;
+    uint32_t byteSize;
+};
+
+// Maps a push constant member to the C++ type with the same memory layout
+static MemberType GetMemberType(const SpvReflectBlockVariable& member)
+{
+    const SpvReflectTypeDescription& type = *member.type_description;
+    const SpvReflectTypeFlags flags = type.type_flags;
+    if (flags & (SPV_REFLECT_TYPE_FLAG_STRUCT | SPV_REFLECT_TYPE_FLAG_ARRAY)) {
+        Fail(std::string("push constant member '") + member.name + "' is a struct or array, which isn't supported");
+    }
+    if (type.traits.numeric.scalar.width != 32) {
+        Fail(std::string("push constant member '") + member.name + "' isn't 32-bit, which isn't supported");
+    }
+
+    const bool isFloat = flags & SPV_REFLECT_TYPE_FLAG_FLOAT;
+    const bool isSigned = type.traits.numeric.scalar.signedness != 0;
+    if (flags & SPV_REFLECT_TYPE_FLAG_MATRIX) {
+        const uint32_t columnCount = type.traits.numeric.matrix.column_count;
+        const uint32_t rowCount = type.traits.numeric.matrix.row_count;
+        if (!isFloat || columnCount != rowCount) Fail(std::string("push constant member '") + member.name + "' isn't a square float matrix");
+        return { "glm::mat" + std::to_string(columnCount), columnCount * rowCount * 4u };
+    }
+    if (flags & SPV_REFLECT_TYPE_FLAG_VECTOR) {
+        const uint32_t componentCount = type.traits.numeric.vector.component_count;
+        const std::string prefix = isFloat ? "glm::vec" : (isSigned ? "glm::ivec" : "glm::uvec");
+        return { prefix + std::to_string(componentCount), componentCount * 4u };
+    }
+    return { isFloat ? "float" : (isSigned ? "int32_t" : "uint32_t"), 4u };
+}
+
+static void GenerateShaderLayout(std::ostream& out, const std::filesystem::path& path)
+{
+    const std::vector<uint32_t> code = ReadSpirv(path);
+    SpvReflectShaderModule module;
+    if (spvReflectCreateShaderModule(code.size() * sizeof(uint32_t), code.data(), &module) != SPV_REFLECT_RESULT_SUCCESS) {
+        Fail("could not reflect '" + path.string() + "'");
+    }
+    // NOTE: Like the runtime reflection, we assume *at most*: 1 entrypoint, 1 push constant block and 2 descriptor sets,
+    // the pipeline's own set 0 and the global descriptor heap in set 1, whose layout is created by the application
+    if (module.entry_point_count != 1 || module.descriptor_set_count > 2 || module.push_constant_block_count > 1) {
+        Fail("'" + path.string() + "' has more than one entrypoint or push constant block, or more than two descriptor sets");
+    }
+
+    const std::string namespaceName = GetNamespaceName(path);
+    const char* stageName = GetVkShaderStageName(module.shader_stage);
+    out << "namespace " << namespaceName << " {\n";
+
+    uint32_t bindingCount = 0;
+    spvReflectEnumerateDescriptorBindings(&module, &bindingCount, nullptr);
+    std::vector<SpvReflectDescriptorBinding*> bindings(bindingCount);
+    spvReflectEnumerateDescriptorBindings(&module, &bindingCount, bindings.data());
+    std::erase_if(bindings, [](const SpvReflectDescriptorBinding* binding) { return binding->set != 0; });
+    for (const SpvReflectDescriptorBinding* binding : bindings) {
+        out << "    constexpr uint32_t k" << GetConstantName(binding->name) << "Binding = " << binding->binding << ";\n";
+    }
+    if (!bindings.empty()) out << "\n";
+
+    // NOTE: std::array rather than a C array, since shaders without bindings would make it zero-sized
+    out << "    constexpr std::array<VkDescriptorSetLayoutBinding, " << bindings.size() << "> kLayoutBindings = {{\n";
+    for (const SpvReflectDescriptorBinding* binding : bindings) {
+        out << "        { .binding = " << binding->binding
+            << ", .descriptorType = " << GetVkDescriptorTypeName(binding->descriptor_type)
+            << ", .descriptorCount = 1, .stageFlags = " << stageName << " },\n";
+    }
+    out << "    }};\n\n";
+
+    const SpvReflectBlockVariable* pushConstants = module.push_constant_block_count > 0 ? module.push_constant_blocks : nullptr;
+    if (pushConstants != nullptr) {
+        std::ostringstream asserts;
+        out << "    struct PushConstants {\n";
+        uint32_t offset = 0, paddingCount = 0;
+        for (uint32_t memberIdx = 0; memberIdx < pushConstants->member_count; ++memberIdx) {
+            const SpvReflectBlockVariable& member = pushConstants->members[memberIdx];
+            if (member.offset < offset) Fail(std::string("push constant member '") + member.name + "' overlaps the previous one");
+            if (member.offset > offset) {
+                out << "        uint8_t _padding" << paddingCount++ << "[" << member.offset - offset << "];\n";
+            }
+            const MemberType memberType = GetMemberType(member);
+            out << "        " << memberType.name << " " << member.name << ";\n";
+            asserts << "    static_assert(offsetof(PushConstants, " << member.name << ") == " << member.offset << ");\n";
+            offset = member.offset + memberType.byteSize;
+        }
+        out << "    };\n";
+        out << asserts.str();
+        out << "    static_assert(sizeof(PushConstants) == " << offset << ");\n\n";
+    }
+
+    out << "    constexpr ShaderReflection kReflection = {\n";
+    out << "        .filename = \"" << path.filename().string() << "\",\n";
+    out << "        .stage = " << stageName << ",\n";
+    out << "        .layoutBindings = kLayoutBindings,\n";
+    if (pushConstants != nullptr) {
+        out << "        .pushConstants = { .stageFlags = " << stageName << ", .offset = " << pushConstants->offset
+            << ", .size = " << pushConstants->size << " },\n";
+    }
+    out << "    };\n";
+    out << "} // namespace " << namespaceName << "\n\n";
+
+    spvReflectDestroyShaderModule(&module);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) Fail("usage: shader_reflect <output.h> <shader.spv>...");
+    const std::filesystem::path outputPath = argv[1];
+
+    std::ostringstream out;
+    out << "// Generated by shader_reflect, do not edit.\n";
+    out << "#pragma once\n\n";
+    out << "#include \"shaders/shader_reflection.h\"\n\n";
+    std::vector<std::string> namespaceNames;
+    for (int argIdx = 2; argIdx < argc; ++argIdx) {
+        GenerateShaderLayout(out, argv[argIdx]);
+        namespaceNames.push_back(GetNamespaceName(argv[argIdx]));
+    }
+    out << "constexpr const ShaderReflection* kShaderReflections[] = {\n";
+    for (const std::string& namespaceName : namespaceNames) {
+        out << "    &" << namespaceName << "::kReflection,\n";
+    }
+    out << "};\n";
+
+    // Only touch the output if it changed, so unchanged shaders don't trigger a rebuild of its includers
+    std::ifstream previousFile(outputPath, std::ios::binary);
+    const std::string previousContents = std::string(std::istreambuf_iterator<char>(previousFile), std::istreambuf_iterator<char>());
+    if (previousContents != out.str()) {
+        std::filesystem::create_directories(outputPath.parent_path());
+        std::ofstream outputFile(outputPath, std::ios::binary | std::ios::trunc);
+        outputFile << out.str();
+        if (!outputFile.good()) Fail("could not write '" + outputPath.string() + "'");
+    }
+    return 0;
+}
@@ -0,0 +1,292 @@
+// Renders the full frame, simulation and ocean, on a headless device for a fixed number of frames per scenario and
+// writes the CPU frame times and GPU pass times with their percentiles as JSON. Every scenario scripts its camera path
+// and parameters, and the simulation advances by a fixed time step from seeded phases, so runs are comparable across
+// commits and machines, including ones without a display (e.g. with lavapipe). The simulation kernels are tuned once,
+// or their variants pinned with --workgroups, and all scenarios run the same variants.
+// Usage: waves_bench [--frames <count>] [--warmup <count>] [--width <px>] [--height <px>] [--scenario <name>] [--output <path>]
+//                    [--workgroups <path>]
+
+#include "camera.h"
+#include "timer.h"
+#include "gui.h"
+#include "utils.h"
+#include "logger.h"
+#include "thread_pool.h"
+#include "headless_frames.h"
+
+#include "vk/command_list.h"
+#include "vk/device.h"
+#include "vk/common.h"
+#include "vk/texture.h"
+#include "vk/frame_pacing.h"
+#include "vk/offscreen_target.h"
+#include "vk/gpu_profiler.h"
+
+#include "ocean/ocean_renderer.h"
+
+#include <map>
+
+constexpr float kDt = 1.0f / 60.0f;
+constexpr uint32_t kPhaseSeed = 1234u;
+
+struct CameraPose {
+    glm::vec3 position;
+    glm::vec3 target;
+};
+
+struct BenchScenario {
+    std::string name;
+    GUIParams params;
+    std::function<CameraPose(float time)> cameraPath; // `time` is the simulated time in seconds
+    uint32_t waveQueryCount = 0u;                      // Wave height queries per frame, e.g. by floating objects
+};
+
+struct BenchArgs {
+    uint32_t frameCount = 600u;
+    uint32_t warmupFrameCount = 60u;  // Not measured; covers transient allocations and the first GPU results
+    uint32_t width = 1280u;
+    uint32_t height = 720u;
+    std::string scenario;             // Runs all scenarios if empty
+    std::string outputPath = "waves_bench.json";
+    std::string workgroupsPath;       // Workgroup tuning cache whose picks are pinned; otherwise the first scenario tunes
+};
+
+// Percentiles of the samples of one metric
+struct BenchMetric {
+    float meanMs = 0.0f;
+    float p50Ms = 0.0f;
+    float p95Ms = 0.0f;
+    float p99Ms = 0.0f;
+};
+
+struct BenchResult {
+    std::string name;
+    BenchMetric cpuFrame;                   // Whole frame, including waiting for the frame in flight
+    BenchMetric cpuRecord;                  // Recording and submitting the frame only
+    std::map<std::string, BenchMetric> gpuPasses;
+    std::map<std::string, uint32_t> workGroupSizes; // Of the simulation kernels
+    // Throughput of the CPU wave evaluator over the wave query positions, on one core and on all of them
+    uint32_t waveEvaluatorComponentCount = 0u;
+    float waveEvaluatorMPointsPerSecond = 0.0f;
+    float waveEvaluatorThreadedMPointsPerSecond = 0.0f;
+};
+
+[[noreturn]] static void Fail(const std::string& message)
+{
+    fprintf(stderr, "waves_bench: error: %s\n", message.c_str());
+    exit(1);
+}
+
+static std::vector<BenchScenario> GetScenarios()
+{
+    // No dynamic resolution: the work per frame must not depend on the measured timings
+    const GUIParams defaultParams = { .isDynamicResolutionEnabled = false };
+    GUIParams stormParams = defaultParams;
+    stormParams.windMagnitude = 40.0f;
+    stormParams.choppiness = 2.0f;
+    GUIParams boundedParams = defaultParams;
+    boundedParams.isOceanUnbounded = false;
+    boundedParams.windMagnitude = 10.0f;
+    GUIParams halfResolutionParams = defaultParams;
+    halfResolutionParams.renderScale = 0.5f;
+
+    return {
+        { "static", defaultParams, [](float) { return CameraPose{ glm::vec3(0.f, 10.f, 0.f), glm::vec3(100.f, 0.f, 0.f) }; } },
+        { "flyover", defaultParams, [](float time) {
+            const glm::vec3 position = glm::vec3(20.f * time, 15.f, 0.f);
+            return CameraPose{ position, position + glm::vec3(100.f, -10.f, 0.f) };
+        }},
+        { "orbit_storm", stormParams, [](float time) {
+            const float angle = 0.2f * time;
+            return CameraPose{ glm::vec3(300.f * glm::cos(angle), 120.f, 300.f * glm::sin(angle)), glm::vec3(0.f) };
+        }},
+        { "bounded_calm", boundedParams, [](float) { return CameraPose{ glm::vec3(512.f, 40.f, -400.f), glm::vec3(512.f, 0.f, 512.f) }; } },
+        { "half_resolution", halfResolutionParams, [](float) { return CameraPose{ glm::vec3(0.f, 10.f, 0.f), glm::vec3(100.f, 0.f, 0.f) }; } },
+        { "wave_queries", defaultParams, [](float) { return CameraPose{ glm::vec3(0.f, 10.f, 0.f), glm::vec3(100.f, 0.f, 0.f) }; }, 100'000u },
+    };
+}
+
+static BenchArgs ParseArgs(int argc, char** argv)
+{
+    BenchArgs args;
+    for (int argIdx = 1; argIdx < argc; ++argIdx) {
+        const std::string arg = argv[argIdx];
+        if (argIdx + 1 == argc) Fail("missing value of '" + arg + "'");
+        const std::string value = argv[++argIdx];
+        if (arg == "--frames") args.frameCount = uint32_t(std::stoul(value));
+        else if (arg == "--warmup") args.warmupFrameCount = uint32_t(std::stoul(value));
+        else if (arg == "--width") args.width = uint32_t(std::stoul(value));
+        else if (arg == "--height") args.height = uint32_t(std::stoul(value));
+        else if (arg == "--scenario") args.scenario = value;
+        else if (arg == "--output") args.outputPath = value;
+        else if (arg == "--workgroups") args.workgroupsPath = value;
+        else Fail("unknown argument '" + arg + "'");
+    }
+    if (args.frameCount == 0 || args.width == 0 || args.height == 0) Fail("the frame count and size must be positive");
+    return args;
+}
+
+// Nearest-rank percentiles
+static BenchMetric ComputeMetric(std::vector<float> samplesMs)
+{
+    if (samplesMs.empty()) return {};
+    std::sort(samplesMs.begin(), samplesMs.end());
+    const auto percentile = [&](uint32_t p) {
+        const size_t rank = (p * samplesMs.size() + 99) / 100;
+        return samplesMs[std::clamp<size_t>(rank, 1, samplesMs.size()) - 1];
+    };
+    float totalMs = 0.0f;
+    for (float sampleMs : samplesMs) totalMs += sampleMs;
+    return {
+        .meanMs = totalMs / float(samplesMs.size()),
+        .p50Ms = percentile(50),
+        .p95Ms = percentile(95),
+        .p99Ms = percentile(99),
+    };
+}
+
+// The first scenario picks the workgroup variants, unless they're pinned, and `workgroupPicks` pins them for the others
+static BenchResult RunScenario(const Device& device, const BenchScenario& scenario, const BenchArgs& args, WorkgroupPicks& workgroupPicks)
+{
+    LOG_INFO("Running scenario '{}'", scenario.name);
+    FramePacingState framePacingState = FramePacingState(device);
+    OffscreenTarget offscreenTarget = OffscreenTarget(device, { .width = args.width, .height = args.height });
+    // A renderer per scenario, so every scenario starts from the same phases whichever ones run before it
+    OceanRenderer oceanRenderer = OceanRenderer(device, OceanRendererDesc{
+        .colorFormat = offscreenTarget.GetFormat(),
+        .depthFormat = offscreenTarget.GetDepthFormat(),
+        .params = scenario.params,
+        .phaseSeed = kPhaseSeed,
+        .workgroupPicks = workgroupPicks.empty() ? nullptr : &workgroupPicks,
+    });
+    if (workgroupPicks.empty()) workgroupPicks = oceanRenderer.GetWorkgroupPicks();
+    GpuProfiler gpuProfiler = GpuProfiler(device);
+    const float aspectRatio = float(args.width) / float(args.height);
+
+    // The queries are spread over a square kilometer around the origin
+    std::vector<glm::vec2> waveQueryPositions(scenario.waveQueryCount);
+    const uint32_t waveQueryRowSize = uint32_t(std::ceil(std::sqrt(float(scenario.waveQueryCount))));
+    for (auto [queryIdx, position] : enumerate(waveQueryPositions)) {
+        position = (glm::vec2(queryIdx % waveQueryRowSize, queryIdx / waveQueryRowSize) / float(waveQueryRowSize) - 0.5f) * 1000.0f;
+    }
+
+    std::vector<float> cpuFrameTimesMs, cpuRecordTimesMs;
+    std::map<std::string, std::vector<float>> gpuPassTimesMs;
+    const auto isFrameMeasured = [&](uint32_t frameIdx) { return frameIdx >= args.warmupFrameCount; };
+    RunHeadlessFrames(device, framePacingState, offscreenTarget, gpuProfiler, nullptr, {
+        .frameCount = args.warmupFrameCount + args.frameCount,
+        .recordFrame = [&](const HeadlessFrame& frame) {
+            const float time = float(frame.frameIdx) * kDt;
+            const CameraPose pose = scenario.cameraPath(time);
+            const Camera camera = Camera(pose.position);
+            if (!waveQueryPositions.empty()) oceanRenderer.GetWaveQueries().Query(waveQueryPositions, nullptr);
+            oceanRenderer.RecordFrame(*frame.cmdList, OceanFrameDesc{
+                .frameIndex = frame.frameIndex,
+                .dt = kDt,
+                .renderScale = scenario.params.renderScale,
+                .worldToClip = camera.GetProjectionMatrix(aspectRatio) * glm::lookAt(pose.position, pose.target, UP_DIRECTION),
+                .cameraPosition = pose.position,
+                .params = scenario.params,
+                .colorTarget = frame.target,
+                .depthTarget = offscreenTarget.GetDepthTexture(),
+            }, &gpuProfiler);
+        },
+        .onGpuTimesCollected = [&](uint32_t frameIdx) {
+            if (!isFrameMeasured(frameIdx)) return;
+            for (const auto& [name, timeMs] : gpuProfiler.GetLastTimesMs()) gpuPassTimesMs[std::string(name)].push_back(timeMs);
+        },
+        .onFrameSubmitted = [&](uint32_t frameIdx, float frameMs, float recordMs) {
+            if (!isFrameMeasured(frameIdx)) return;
+            cpuFrameTimesMs.push_back(frameMs);
+            cpuRecordTimesMs.push_back(recordMs);
+        },
+    });
+
+    BenchResult result = {
+        .name = scenario.name,
+        .cpuFrame = ComputeMetric(cpuFrameTimesMs),
+        .cpuRecord = ComputeMetric(cpuRecordTimesMs),
+        .workGroupSizes = oceanRenderer.GetWorkGroupSizes(),
+    };
+    for (auto& [name, timesMs] : gpuPassTimesMs) result.gpuPasses[name] = ComputeMetric(std::move(timesMs));
+    if (!waveQueryPositions.empty()) {
+        const WaveEvaluator waveEvaluator = oceanRenderer.CreateWaveEvaluator(scenario.params);
+        ThreadPool threadPool;
+        std::vector<float> heights(waveQueryPositions.size());
+        const auto measureMPointsPerSecond = [&](ThreadPool* pool) {
+            const Timer timer;
+            waveEvaluator.EvaluateHeights(waveQueryPositions, oceanRenderer.GetSimulatedTime(), heights, pool);
+            return float(waveQueryPositions.size()) / (1000.0f * timer.Elapsed());
+        };
+        result.waveEvaluatorComponentCount = waveEvaluator.GetComponentCount();
+        result.waveEvaluatorMPointsPerSecond = measureMPointsPerSecond(nullptr);
+        result.waveEvaluatorThreadedMPointsPerSecond = measureMPointsPerSecond(&threadPool);
+    }
+    LOG_INFO("  CPU frame p50 {:.3f} ms, p99 {:.3f} ms", result.cpuFrame.p50Ms, result.cpuFrame.p99Ms);
+    return result;
+}
+
+static std::string ToJson(const BenchMetric& metric)
+{
+    return fmt::format("{{\"mean\": {:.4f}, \"p50\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}}}",
+        metric.meanMs, metric.p50Ms, metric.p95Ms, metric.p99Ms);
+}
+
+static std::string ToJson(const Device& device, const BenchArgs& args, const std::vector<BenchResult>& results)
+{
+    std::string json = "{\n";
+    json += fmt::format("  \"device\": \"{}\",\n", EscapeJson(device.GetProperties().deviceName));
+    json += fmt::format("  \"frames\": {},\n  \"warmup_frames\": {},\n", args.frameCount, args.warmupFrameCount);
+    json += fmt::format("  \"width\": {},\n  \"height\": {},\n  \"dt\": {:.6f},\n", args.width, args.height, kDt);
+    // Every scenario runs the same kernel variants
+    json += "  \"workgroup_sizes\": {";
+    for (auto [kernelIdx, kernel] : enumerate(results.front().workGroupSizes)) {
+        json += fmt::format("{}\"{}\": {}", kernelIdx == 0 ? "" : ", ", EscapeJson(kernel.first), kernel.second);
+    }
+    json += "},\n";
+    json += "  \"unit\": \"ms\",\n  \"scenarios\": [\n";
+    for (auto [resultIdx, result] : enumerate(results)) {
+        json += fmt::format("    {{\n      \"name\": \"{}\",\n", EscapeJson(result.name));
+        json += fmt::format("      \"cpu_frame\": {},\n", ToJson(result.cpuFrame));
+        json += fmt::format("      \"cpu_record\": {},\n", ToJson(result.cpuRecord));
+        if (result.waveEvaluatorComponentCount > 0u) {
+            json += fmt::format("      \"cpu_wave_evaluator\": {{\"waves\": {}, \"mpoints_per_s\": {:.3f}, \"mpoints_per_s_threaded\": {:.3f}}},\n",
+                result.waveEvaluatorComponentCount, result.waveEvaluatorMPointsPerSecond, result.waveEvaluatorThreadedMPointsPerSecond);
+        }
+        json += "      \"gpu_passes\": {";
+        for (auto [passIdx, pass] : enumerate(result.gpuPasses)) {
+            json += fmt::format("{}\n        \"{}\": {}", passIdx == 0 ? "" : ",", EscapeJson(pass.first), ToJson(pass.second));
+        }
+        json += result.gpuPasses.empty() ? "}\n" : "\n      }\n";
+        json += resultIdx + 1 == results.size() ? "    }\n" : "    },\n";
+    }
+    json += "  ]\n}\n";
+    return json;
+}
+
+int main(int argc, char** argv)
+{
+    const BenchArgs args = ParseArgs(argc, argv);
+    std::vector<BenchScenario> scenarios = GetScenarios();
+    if (!args.scenario.empty()) {
+        std::erase_if(scenarios, [&](const BenchScenario& scenario) { return scenario.name != args.scenario; });
+        if (scenarios.empty()) Fail("unknown scenario '" + args.scenario + "'");
+    }
+
+    Device device = Device(false);
+    WorkgroupPicks workgroupPicks;
+    if (!args.workgroupsPath.empty()) {
+        workgroupPicks = WorkgroupTuner::LoadPicks(args.workgroupsPath);
+        if (workgroupPicks.empty()) Fail("no workgroup picks in '" + args.workgroupsPath + "'");
+    }
+    std::vector<BenchResult> results;
+    for (const BenchScenario& scenario : scenarios) {
+        results.push_back(RunScenario(device, scenario, args, workgroupPicks));
+    }
+
+    const std::string json = ToJson(device, args, results);
+    std::ofstream file(args.outputPath, std::ios::binary);
+    if (!file.write(json.data(), json.size())) Fail("could not write '" + args.outputPath + "'");
+    LOG_INFO("Wrote the results of {} scenarios to '{}'", results.size(), args.outputPath);
+    return 0;
+}